@@ -0,0 +1,293 @@
+//
+//  CFGSimplifier.cpp
+//  uscc
+//
+//  Implements CFGSimplifier class
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "CFGSimplifier.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/Analysis/CFG.h>
+#include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/ADT/SmallVector.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace uscc
+{
+namespace opt
+{
+
+bool CFGSimplifier::simplify()
+{
+	bool changed = false;
+	while (true)
+	{
+		// Each of these can open up more work for the others
+		// (folding a branch can leave a block unreachable, deleting
+		// a block can leave its successor with one predecessor...)
+		bool iterChanged = foldConstantBranches();
+		iterChanged |= removeUnreachableBlocks();
+		iterChanged |= mergeIntoPredecessors();
+		iterChanged |= bypassEmptyBlocks();
+		if (!iterChanged)
+		{
+			break;
+		}
+		changed = true;
+	}
+
+	return changed;
+}
+
+bool CFGSimplifier::foldConstantBranches()
+{
+	bool changed = false;
+	for (BasicBlock& block : mFunc)
+	{
+		BranchInst* br = dyn_cast<BranchInst>(block.getTerminator());
+		if (br == nullptr || br->isUnconditional())
+		{
+			continue;
+		}
+
+		BasicBlock* trueBlock = br->getSuccessor(0);
+		BasicBlock* falseBlock = br->getSuccessor(1);
+		BasicBlock* dest = nullptr;
+		if (ConstantInt* cond = dyn_cast<ConstantInt>(br->getCondition()))
+		{
+			dest = cond->isZero() ? falseBlock : trueBlock;
+		}
+		else if (trueBlock == falseBlock)
+		{
+			dest = trueBlock;
+		}
+		else
+		{
+			continue;
+		}
+
+		// Either way, one of the two edges goes away. If both went to
+		// dest, this removes one of its two (equal) incoming values.
+		BasicBlock* notTaken = (dest == trueBlock) ? falseBlock : trueBlock;
+		notTaken->removePredecessor(&block);
+
+		// The condition is dead if this was its only use
+		Instruction* cond = dyn_cast<Instruction>(br->getCondition());
+		BranchInst::Create(dest, br);
+		br->eraseFromParent();
+		if (cond != nullptr && cond->use_empty())
+		{
+			cond->eraseFromParent();
+		}
+		changed = true;
+	}
+
+	return changed;
+}
+
+bool CFGSimplifier::removeUnreachableBlocks()
+{
+	SmallPtrSet<BasicBlock*, 32> reachable;
+	BasicBlock* entry = &mFunc.getEntryBlock();
+	for (df_iterator<BasicBlock*> iter = df_begin(entry), end = df_end(entry);
+		 iter != end; ++iter)
+	{
+		reachable.insert(*iter);
+	}
+
+	std::vector<BasicBlock*> deadBlocks;
+	for (BasicBlock& block : mFunc)
+	{
+		if (!reachable.count(&block))
+		{
+			deadBlocks.push_back(&block);
+		}
+	}
+
+	// The dead blocks can branch to (and use values from) each other,
+	// so every reference is dropped before any of them are deleted
+	for (BasicBlock* block : deadBlocks)
+	{
+		for (succ_iterator succ = succ_begin(block); succ != succ_end(block); ++succ)
+		{
+			if (reachable.count(*succ))
+			{
+				(*succ)->removePredecessor(block);
+			}
+		}
+		block->dropAllReferences();
+	}
+	for (BasicBlock* block : deadBlocks)
+	{
+		block->eraseFromParent();
+	}
+
+	return !deadBlocks.empty();
+}
+
+bool CFGSimplifier::mergeIntoPredecessors()
+{
+	bool changed = false;
+	Function::iterator iter = mFunc.begin();
+	// The entry block can't be merged into anything
+	++iter;
+	while (iter != mFunc.end())
+	{
+		BasicBlock* block = &*iter;
+		++iter;
+
+		BasicBlock* pred = block->getSinglePredecessor();
+		if (pred == nullptr || pred == block)
+		{
+			continue;
+		}
+		BranchInst* br = dyn_cast<BranchInst>(pred->getTerminator());
+		if (br == nullptr || br->isConditional())
+		{
+			continue;
+		}
+
+		// With one predecessor, each phi only has one value
+		while (PHINode* phi = dyn_cast<PHINode>(&*block->begin()))
+		{
+			phi->replaceAllUsesWith(phi->getIncomingValue(0));
+			phi->eraseFromParent();
+		}
+
+		// Make the phis in the successors refer to pred instead (which
+		// finds them through the terminator), then move everything over
+		br->eraseFromParent();
+		block->replaceAllUsesWith(pred);
+		pred->getInstList().splice(pred->end(), block->getInstList());
+		block->eraseFromParent();
+		changed = true;
+	}
+
+	return changed;
+}
+
+bool CFGSimplifier::bypassEmptyBlocks()
+{
+	SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 8> backEdges;
+	FindFunctionBackedges(mFunc, backEdges);
+	mBackEdges.clear();
+	mLoopHeaders.clear();
+	for (auto& edge : backEdges)
+	{
+		mBackEdges.insert(edge);
+		mLoopHeaders.insert(edge.second);
+	}
+
+	bool changed = false;
+	Function::iterator iter = mFunc.begin();
+	++iter;
+	while (iter != mFunc.end())
+	{
+		BasicBlock* block = &*iter;
+		++iter;
+
+		BranchInst* br = dyn_cast<BranchInst>(&*block->begin());
+		if (br == nullptr || br->isConditional() || br->getSuccessor(0) == block)
+		{
+			continue;
+		}
+		BasicBlock* succ = br->getSuccessor(0);
+
+		SmallVector<BasicBlock*, 4> preds;
+		for (pred_iterator pred = pred_begin(block); pred != pred_end(block); ++pred)
+		{
+			if (std::find(preds.begin(), preds.end(), *pred) == preds.end())
+			{
+				preds.push_back(*pred);
+			}
+		}
+
+		for (BasicBlock* pred : preds)
+		{
+			if (!canBypass(block, pred, succ))
+			{
+				continue;
+			}
+
+			// Each edge to block becomes an edge to succ, with the
+			// same value in the phis as the edge from block
+			TerminatorInst* term = pred->getTerminator();
+			for (unsigned i = 0; i < term->getNumSuccessors(); i++)
+			{
+				if (term->getSuccessor(i) != block)
+				{
+					continue;
+				}
+				term->setSuccessor(i, succ);
+				for (BasicBlock::iterator phiIter = succ->begin();
+					 PHINode* phi = dyn_cast<PHINode>(&*phiIter); ++phiIter)
+				{
+					phi->addIncoming(phi->getIncomingValueForBlock(block), pred);
+				}
+			}
+			changed = true;
+		}
+
+		if (pred_begin(block) == pred_end(block))
+		{
+			succ->removePredecessor(block);
+			block->eraseFromParent();
+		}
+	}
+
+	return changed;
+}
+
+bool CFGSimplifier::canBypass(BasicBlock* block, BasicBlock* pred,
+							  BasicBlock* succ)
+{
+	// If succ is a loop header that block branches to from outside
+	// the loop, pred would take block's place as the preheader, so
+	// it can't branch anywhere else
+	if (mLoopHeaders.count(succ) && !mBackEdges.count(std::make_pair(block, succ)) &&
+		pred->getTerminator()->getNumSuccessors() != 1)
+	{
+		return false;
+	}
+
+	// If pred already branches to succ, both edges have
+	// to give succ's phis the same values
+	for (succ_iterator other = succ_begin(pred); other != succ_end(pred); ++other)
+	{
+		if (*other != succ)
+		{
+			continue;
+		}
+
+		for (BasicBlock::iterator phiIter = succ->begin();
+			 PHINode* phi = dyn_cast<PHINode>(&*phiIter); ++phiIter)
+		{
+			if (phi->getIncomingValueForBlock(block) != phi->getIncomingValueForBlock(pred))
+			{
+				return false;
+			}
+		}
+		break;
+	}
+
+	return true;
+}
+
+} // opt
+} // uscc
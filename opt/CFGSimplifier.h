@@ -0,0 +1,81 @@
+//
+//  CFGSimplifier.h
+//  uscc
+//
+//  Declares CFGSimplifier, which cleans up the CFG of a
+//  function. It's shared by the ConstantBranch and
+//  DeadBlocks passes.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#pragma once
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/ADT/SmallPtrSet.h>
+#pragma clang diagnostic pop
+#include <set>
+#include <utility>
+
+// LLVM forward-declarations
+namespace llvm
+{
+	class BasicBlock;
+	class Function;
+}
+
+namespace uscc
+{
+namespace opt
+{
+
+class CFGSimplifier
+{
+public:
+	CFGSimplifier(llvm::Function& F)
+	: mFunc(F)
+	{ }
+
+	// Applies all of the simplifications below until none of
+	// them change anything. Returns true if anything changed.
+	bool simplify();
+
+	// Converts conditional branches on a constant (or with the same
+	// block on both sides) into unconditional branches, and removes
+	// the incoming values of the edge that's no longer there from phis
+	bool foldConstantBranches();
+
+	// Deletes the blocks that can't be reached from the entry block
+	bool removeUnreachableBlocks();
+
+	// Merges each block into its predecessor, if that's its only
+	// predecessor and it's the predecessor's only successor
+	bool mergeIntoPredecessors();
+
+	// Redirects the predecessors of blocks that only contain an
+	// unconditional branch to the block it branches to
+	bool bypassEmptyBlocks();
+private:
+	// Returns true if pred can branch straight to succ instead of
+	// through block, without two different values for the same
+	// edge in one of succ's phis
+	bool canBypass(llvm::BasicBlock* block, llvm::BasicBlock* pred,
+				   llvm::BasicBlock* succ);
+
+	llvm::Function& mFunc;
+
+	// The back edges of the CFG, and the loop headers they go to.
+	// Bypassing the block that enters a loop can leave the loop
+	// without a preheader, which stops LICM from hoisting into it.
+	std::set<std::pair<const llvm::BasicBlock*, const llvm::BasicBlock*>> mBackEdges;
+	llvm::SmallPtrSet<const llvm::BasicBlock*, 8> mLoopHeaders;
+};
+
+} // opt
+} // uscc
@@ -14,13 +14,11 @@
 //  See LICENSE.TXT for details.
 //---------------------------------------------------------
 #include "Passes.h"
+#include "CFGSimplifier.h"
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
 #include <llvm/IR/Function.h>
-#include <llvm/IR/Instructions.h>
-#include <llvm/IR/Constants.h>
 #pragma clang diagnostic pop
-#include <set>
 
 using namespace llvm;
 
@@ -31,16 +29,14 @@ namespace opt
 	
 bool ConstantBranch::runOnFunction(Function& F)
 {
-	bool changed = false;
-	
-	// PA6: Implement
-	
-	return changed;
+	CFGSimplifier simplifier(F);
+	return simplifier.foldConstantBranches();
 }
 
 void ConstantBranch::getAnalysisUsage(AnalysisUsage& Info) const
 {
-	// PA6: Implement
+	// Removing edges changes the dominator tree and can break up
+	// loops, so no analysis is preserved
 }
 	
 } // opt
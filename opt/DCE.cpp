@@ -8,6 +8,8 @@
 
 #include "Passes.h"
 #include "Liveness.h"
+#include <llvm/ADT/SmallPtrSet.h>
+#include <vector>
 
 using namespace llvm;
 namespace 
@@ -20,7 +22,7 @@ public:
     virtual bool runOnFunction(llvm::Function &F) override;
     void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
 private:
-    void findDeadDefinitions(Instruction *inst, std::set<Instruction *> &dead);
+    void eraseDeadInst(Instruction *inst, std::vector<Instruction *> &worklist);
 };
 }
 char DeadCodeElimination::ID = 0;
@@ -39,19 +41,26 @@ void DeadCodeElimination::getAnalysisUsage(llvm::AnalysisUsage &AU) const
     AU.setPreservesCFG();
 }
 
-void DeadCodeElimination::findDeadDefinitions(llvm::Instruction *inst,
-                                              std::set<Instruction *> &dead) 
+// Erases inst, and queues the instructions computing its operands that are left
+// without uses (and have no side effects) since they're dead now too.
+void DeadCodeElimination::eraseDeadInst(llvm::Instruction *inst,
+                                        std::vector<Instruction *> &worklist)
 {
-    for (unsigned i = 0, e = inst->getNumOperands(); i < e; ++i) 
+    SmallPtrSet<Instruction *, 4> operands;
+    for (unsigned i = 0, e = inst->getNumOperands(); i < e; ++i)
     {
-        Value *val = inst->getOperand(i);
-        Instruction *src;
-        if ((src = dyn_cast_or_null<Instruction>(val)) != nullptr &&
-            src->hasOneUse() && src->getOpcode() != Instruction::Call) 
-        {
-            dead.insert(src);
-            findDeadDefinitions(src, dead);
-        }
+        Instruction *src = dyn_cast_or_null<Instruction>(inst->getOperand(i));
+        // Unused allocas are removed at the end.
+        if (src && !isa<AllocaInst>(src))
+            operands.insert(src);
+    }
+
+    inst->eraseFromParent();
+
+    for (auto src : operands)
+    {
+        if (src->use_empty() && !src->mayHaveSideEffects())
+            worklist.push_back(src);
     }
 }
 
@@ -64,41 +73,32 @@ bool DeadCodeElimination::runOnFunction(llvm::Function &F)
 
     // PA4
     // Step #1: get a set of dead instructions and remove them.
+    // The worklist starts with the dead stores of every block. Whenever a load/store
+    // is deleted, only the liveness of the blocks it affects is updated, and only
+    // those blocks are scanned again for stores that are now dead.
     bool changed = false;
-    while (true)
+    std::vector<Instruction *> worklist;
+    for (auto & BB : F)
+        lv.findDeadStores(BB, worklist);
+
+    std::vector<BasicBlock *> rescan;
+    while (!worklist.empty())
     {
-        std::set<Instruction*> dead;
-        for (auto & BB : F)
-        {
-            for (auto & ins : BB)
-            {
-                if (ins.getOpcode() == Instruction::Store)
-                {
-                    if (lv.isDead(ins))
-                    {
-                        dead.insert(&ins);
-                        auto sourceInst = dyn_cast_or_null<Instruction>(ins.getOperand(0));
-                        if (sourceInst)
-                        {
-                            dead.insert(sourceInst);
-                            findDeadDefinitions(&ins, dead);
-                        }
-                    }
-                }
-            }
-        }
-        if (!dead.empty())
+        SmallPtrSet<BasicBlock *, 16> touched;
+        while (!worklist.empty())
         {
+            Instruction *inst = worklist.back();
+            worklist.pop_back();
+            if (isa<LoadInst>(inst) || isa<StoreInst>(inst))
+                touched.insert(inst->getParent());
+            eraseDeadInst(inst, worklist);
             changed = true;
-            for (auto ins : dead)
-            {
-                ins->replaceAllUsesWith(llvm::UndefValue::get(ins->getType()));
-                ins->eraseFromParent();
-            }
         }
-        else  
-            break;
-        lv.runOnFunction(F);
+
+        rescan.clear();
+        lv.update(touched, rescan);
+        for (auto bb : rescan)
+            lv.findDeadStores(*bb, worklist);
     }
 
     // Step #2: remove the Alloca instructions having no uses.
@@ -3,7 +3,8 @@
 //  uscc
 //
 //  Implements Dead Block Removal optimization pass.
-//  This removes blocks from the CFG which are unreachable.
+//  This removes blocks from the CFG which are unreachable,
+//  and cleans up the blocks left behind (see CFGSimplifier).
 //
 //---------------------------------------------------------
 //  Copyright (c) 2014, Sanjay Madhav
@@ -13,13 +14,11 @@
 //  See LICENSE.TXT for details.
 //---------------------------------------------------------
 #include "Passes.h"
+#include "CFGSimplifier.h"
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
 #include <llvm/IR/Function.h>
-#include <llvm/IR/CFG.h>
-#include <llvm/ADT/DepthFirstIterator.h>
 #pragma clang diagnostic pop
-#include <set>
 
 using namespace llvm;
 
@@ -30,16 +29,15 @@ namespace opt
 	
 bool DeadBlocks::runOnFunction(Function& F)
 {
-	bool changed = false;
-	
-	// PA6: Implement
-	
-	return changed;
+	// Deleting blocks can leave others with a single predecessor or
+	// make them empty, so this keeps going until the CFG stops changing
+	CFGSimplifier simplifier(F);
+	return simplifier.simplify();
 }
 	
 void DeadBlocks::getAnalysisUsage(AnalysisUsage& Info) const
 {
-	// PA6: Implement
+	// Blocks are deleted and merged, so no analysis is preserved
 }
 
 } // opt
@@ -0,0 +1,286 @@
+//
+//  GVN.cpp
+//  uscc
+//
+//  Implements global value numbering --
+//  Walks the dominator tree, and replaces each pure instruction
+//  that computes the same value as one that dominates it (such
+//  as the address of array[i], computed again for every use of
+//  array[i]) with that instruction
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// What an instruction computes. Two instructions with the same
+// Expression always compute the same value.
+struct Expression
+{
+	unsigned mOpcode;
+	Type* mType;
+	// The predicate of a compare, whether a GEP is inbounds,
+	// or the block of a phi
+	uintptr_t mExtra;
+	std::vector<Value*> mOperands;
+
+	bool operator<(const Expression& other) const
+	{
+		return std::tie(mOpcode, mType, mExtra, mOperands) <
+			std::tie(other.mOpcode, other.mType, other.mExtra, other.mOperands);
+	}
+};
+
+class GVNScope
+{
+public:
+	GVNScope()
+	: mChanged(false)
+	{ }
+
+	// Numbers the instructions in each block of the dominator tree,
+	// parents before children. Whatever's found in a block is only
+	// available to the blocks it dominates, so it's forgotten once
+	// they're done. The walk keeps an explicit stack rather than
+	// recursing, so deep dominator trees can't overflow the native stack.
+	void processTree(DomTreeNode* root);
+
+	bool changed() const
+	{
+		return mChanged;
+	}
+private:
+	// One block of the dominator tree whose children are being walked
+	struct ScopeFrame
+	{
+		DomTreeNode* mNode;
+		// Next child to walk
+		DomTreeNode::iterator mChild;
+		// Expressions made available by this block
+		std::vector<Expression> mAdded;
+	};
+
+	// Numbers the instructions in node's block, adding the
+	// Expressions it makes available to added
+	void processNode(DomTreeNode* node, std::vector<Expression>& added);
+
+	// Gets the Expression for instr, or returns false if it
+	// has side effects (or depends on memory)
+	bool getExpression(Instruction* instr, Expression& expr);
+
+	// A phi where every incoming value is the same value (or the phi
+	// itself) is that value, which has to dominate the phi's block
+	Value* getTrivialPhiValue(PHINode* phi);
+
+	void replace(Instruction* instr, Value* value);
+
+	// The instruction available for each Expression
+	std::map<Expression, Instruction*> mAvailable;
+
+	bool mChanged;
+};
+
+void GVNScope::processTree(DomTreeNode* root)
+{
+	std::vector<ScopeFrame> stack;
+	stack.push_back(ScopeFrame());
+	stack.back().mNode = root;
+	stack.back().mChild = root->begin();
+	processNode(root, stack.back().mAdded);
+	while (!stack.empty())
+	{
+		ScopeFrame& frame = stack.back();
+		if (frame.mChild != frame.mNode->end())
+		{
+			DomTreeNode* child = *frame.mChild;
+			++frame.mChild;
+			stack.push_back(ScopeFrame());
+			stack.back().mNode = child;
+			stack.back().mChild = child->begin();
+			processNode(child, stack.back().mAdded);
+		}
+		else
+		{
+			for (const Expression& expr : frame.mAdded)
+			{
+				mAvailable.erase(expr);
+			}
+			stack.pop_back();
+		}
+	}
+}
+
+void GVNScope::processNode(DomTreeNode* node, std::vector<Expression>& added)
+{
+	BasicBlock* block = node->getBlock();
+	BasicBlock::iterator iter = block->begin();
+	while (iter != block->end())
+	{
+		Instruction* instr = &*iter;
+		++iter;
+
+		if (PHINode* phi = dyn_cast<PHINode>(instr))
+		{
+			if (Value* value = getTrivialPhiValue(phi))
+			{
+				replace(phi, value);
+				continue;
+			}
+		}
+
+		// Operands were already replaced by the instructions
+		// available for them, so congruent values have the
+		// same operands by the time they're looked up
+		Expression expr;
+		if (!getExpression(instr, expr))
+		{
+			continue;
+		}
+
+		auto found = mAvailable.find(expr);
+		if (found != mAvailable.end())
+		{
+			replace(instr, found->second);
+		}
+		else
+		{
+			mAvailable.emplace(expr, instr);
+			added.push_back(expr);
+		}
+	}
+}
+
+bool GVNScope::getExpression(Instruction* instr, Expression& expr)
+{
+	expr.mOpcode = instr->getOpcode();
+	expr.mType = instr->getType();
+	expr.mExtra = 0;
+
+	if (PHINode* phi = dyn_cast<PHINode>(instr))
+	{
+		// Phis are only congruent if they're in the same block
+		// and get the same value from each predecessor
+		expr.mExtra = reinterpret_cast<uintptr_t>(phi->getParent());
+		std::vector<std::pair<BasicBlock*, Value*>> incoming;
+		for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+		{
+			incoming.push_back(std::make_pair(phi->getIncomingBlock(i),
+											  phi->getIncomingValue(i)));
+		}
+		std::sort(incoming.begin(), incoming.end());
+		for (auto& value : incoming)
+		{
+			expr.mOperands.push_back(value.first);
+			expr.mOperands.push_back(value.second);
+		}
+		return true;
+	}
+	else if (isa<BinaryOperator>(instr) || isa<CastInst>(instr) ||
+			 isa<SelectInst>(instr))
+	{
+		// Division by 0 isn't a problem, since the instruction it's
+		// replaced by would have already divided by 0
+		expr.mOperands.assign(instr->op_begin(), instr->op_end());
+		if (instr->isCommutative() && expr.mOperands[1] < expr.mOperands[0])
+		{
+			std::swap(expr.mOperands[0], expr.mOperands[1]);
+		}
+		return true;
+	}
+	else if (CmpInst* cmp = dyn_cast<CmpInst>(instr))
+	{
+		// a > b is the same as b < a
+		expr.mOperands.assign(instr->op_begin(), instr->op_end());
+		CmpInst::Predicate pred = cmp->getPredicate();
+		if (expr.mOperands[1] < expr.mOperands[0])
+		{
+			std::swap(expr.mOperands[0], expr.mOperands[1]);
+			pred = cmp->getSwappedPredicate();
+		}
+		expr.mExtra = pred;
+		return true;
+	}
+	else if (GetElementPtrInst* gep = dyn_cast<GetElementPtrInst>(instr))
+	{
+		expr.mOperands.assign(instr->op_begin(), instr->op_end());
+		expr.mExtra = gep->isInBounds();
+		return true;
+	}
+
+	return false;
+}
+
+Value* GVNScope::getTrivialPhiValue(PHINode* phi)
+{
+	Value* same = nullptr;
+	for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+	{
+		Value* value = phi->getIncomingValue(i);
+		if (value == phi || value == same)
+		{
+			continue;
+		}
+		else if (same != nullptr)
+		{
+			return nullptr;
+		}
+		same = value;
+	}
+
+	return same;
+}
+
+void GVNScope::replace(Instruction* instr, Value* value)
+{
+	instr->replaceAllUsesWith(value);
+	instr->eraseFromParent();
+	mChanged = true;
+}
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool GVN::runOnFunction(Function& F)
+{
+	DominatorTree& domTree = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+	GVNScope scope;
+	scope.processTree(domTree.getRootNode());
+	return scope.changed();
+}
+
+void GVN::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// Instructions are only removed, so the CFG doesn't change
+	Info.setPreservesCFG();
+	Info.addRequired<DominatorTreeWrapperPass>();
+	Info.addPreserved<DominatorTreeWrapperPass>();
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::GVN::ID = 0;
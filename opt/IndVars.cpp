@@ -0,0 +1,284 @@
+//
+//  IndVars.cpp
+//  uscc
+//
+//  Implements induction variable strength reduction --
+//  Finds the counters of a loop (the header phis that go up or
+//  down by a constant each iteration), and replaces the array
+//  addresses indexed by them (array[i], array[2 * i + 1]...)
+//  with pointers that go up by a constant each iteration. That
+//  way, the loop body no longer has to sign extend the index
+//  and multiply it by the element size for every access.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Transforms/Utils/Local.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// An index that's scale * iv + offset
+struct AffineIndex
+{
+	int64_t mScale;
+	int64_t mOffset;
+};
+
+// If value is iv (or a constant) combined with constants by adds,
+// subs and muls that can't overflow, sets index to what it is in
+// terms of iv and returns true
+bool getAffineIndex(Value* value, PHINode* iv, AffineIndex& index)
+{
+	if (value == iv)
+	{
+		index.mScale = 1;
+		index.mOffset = 0;
+		return true;
+	}
+	else if (ConstantInt* constant = dyn_cast<ConstantInt>(value))
+	{
+		index.mScale = 0;
+		index.mOffset = constant->getSExtValue();
+		return true;
+	}
+
+	// If anything wrapped, the address it's used for would be
+	// different from what the pointer increments would get to
+	BinaryOperator* binOp = dyn_cast<BinaryOperator>(value);
+	if (binOp == nullptr || !binOp->hasNoSignedWrap())
+	{
+		return false;
+	}
+
+	AffineIndex lhs;
+	AffineIndex rhs;
+	if (!getAffineIndex(binOp->getOperand(0), iv, lhs) ||
+		!getAffineIndex(binOp->getOperand(1), iv, rhs))
+	{
+		return false;
+	}
+
+	switch (binOp->getOpcode())
+	{
+	case Instruction::Add:
+		index.mScale = lhs.mScale + rhs.mScale;
+		index.mOffset = lhs.mOffset + rhs.mOffset;
+		return true;
+	case Instruction::Sub:
+		index.mScale = lhs.mScale - rhs.mScale;
+		index.mOffset = lhs.mOffset - rhs.mOffset;
+		return true;
+	case Instruction::Mul:
+		// Only a constant times iv is still affine
+		if (lhs.mScale != 0 && rhs.mScale != 0)
+		{
+			return false;
+		}
+		index.mScale = lhs.mScale * rhs.mOffset + rhs.mScale * lhs.mOffset;
+		index.mOffset = lhs.mOffset * rhs.mOffset;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// The addresses of one array indexed by the same multiple of an
+// induction variable, and what's added to that multiple for each
+struct PointerGroup
+{
+	Value* mBase;
+	int64_t mScale;
+	std::vector<std::pair<GetElementPtrInst*, int64_t>> mAddresses;
+};
+
+// Returns how much phi goes up by each iteration, or 0 if it
+// isn't a counter that goes up (or down) by a constant
+int64_t getStep(PHINode* phi, BasicBlock* latch)
+{
+	if (!phi->getType()->isIntegerTy())
+	{
+		return 0;
+	}
+
+	AffineIndex next;
+	if (!getAffineIndex(phi->getIncomingValueForBlock(latch), phi, next) ||
+		next.mScale != 1)
+	{
+		return 0;
+	}
+	return next.mOffset;
+}
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool IndVars::runOnLoop(llvm::Loop* L, llvm::LPPassManager& LPM)
+{
+	// The pointers start out in the preheader, and go
+	// up at the end of each iteration in the latch
+	BasicBlock* preheader = L->getLoopPreheader();
+	BasicBlock* latch = L->getLoopLatch();
+	if (preheader == nullptr || latch == nullptr)
+	{
+		return false;
+	}
+
+	std::vector<PHINode*> ivs;
+	BasicBlock* header = L->getHeader();
+	for (BasicBlock::iterator iter = header->begin(); isa<PHINode>(iter); ++iter)
+	{
+		PHINode* phi = cast<PHINode>(iter);
+		if (getStep(phi, latch) != 0)
+		{
+			ivs.push_back(phi);
+		}
+	}
+
+	bool changed = false;
+	for (PHINode* iv : ivs)
+	{
+		int64_t step = getStep(iv, latch);
+		Value* start = iv->getIncomingValueForBlock(preheader);
+
+		// The addresses in the loop that are an invariant array
+		// indexed by iv, grouped by array and scale (for each one,
+		// array[scale * iv + offset] is the pointer plus offset)
+		std::vector<PointerGroup> groups;
+		for (BasicBlock* block : L->getBlocks())
+		{
+			for (Instruction& instr : *block)
+			{
+				GetElementPtrInst* gep = dyn_cast<GetElementPtrInst>(&instr);
+				AffineIndex index;
+				if (gep == nullptr || !gep->isInBounds() || gep->getNumIndices() != 1 ||
+					!L->isLoopInvariant(gep->getPointerOperand()) ||
+					!getAffineIndex(gep->getOperand(1), iv, index) || index.mScale == 0)
+				{
+					continue;
+				}
+
+				Value* base = gep->getPointerOperand();
+				auto group = std::find_if(groups.begin(), groups.end(),
+										  [&](const PointerGroup& other) {
+					return other.mBase == base && other.mScale == index.mScale;
+				});
+				if (group == groups.end())
+				{
+					groups.push_back(PointerGroup{ base, index.mScale, { } });
+					group = groups.end() - 1;
+				}
+				group->mAddresses.push_back(std::make_pair(gep, index.mOffset));
+			}
+		}
+
+		for (PointerGroup& group : groups)
+		{
+			GetElementPtrInst* first = group.mAddresses.front().first;
+			int64_t firstOffset = group.mAddresses.front().second;
+			Type* indexType = first->getOperand(1)->getType();
+			std::string name = group.mBase->hasName() ? group.mBase->getName().str() : "ptr";
+			name += ".iv";
+
+			// The pointer is first's address in each iteration. It isn't
+			// inbounds, since that address is only computed (and checked)
+			// in the iterations where first is reached.
+			IRBuilder<> preheaderBuild(preheader->getTerminator());
+			Value* startIndex = start;
+			if (group.mScale != 1)
+			{
+				startIndex = preheaderBuild.CreateMul(startIndex,
+													  ConstantInt::get(indexType, group.mScale));
+			}
+			if (firstOffset != 0)
+			{
+				startIndex = preheaderBuild.CreateAdd(startIndex,
+													  ConstantInt::get(indexType, firstOffset));
+			}
+			Value* startPtr = group.mBase;
+			ConstantInt* constantStart = dyn_cast<ConstantInt>(startIndex);
+			if (constantStart == nullptr || !constantStart->isZero())
+			{
+				startPtr = preheaderBuild.CreateGEP(group.mBase, startIndex, name + ".start");
+			}
+
+			PHINode* ptr = PHINode::Create(group.mBase->getType(), 2, name, &header->front());
+			IRBuilder<> latchBuild(latch->getTerminator());
+			Value* nextPtr = latchBuild.CreateGEP(ptr, ConstantInt::get(indexType, group.mScale * step),
+												  name + ".next");
+			ptr->addIncoming(startPtr, preheader);
+			ptr->addIncoming(nextPtr, latch);
+
+			// The other addresses are a constant distance from first's
+			for (auto& address : group.mAddresses)
+			{
+				GetElementPtrInst* gep = address.first;
+				Value* index = gep->getOperand(1);
+				Value* newPtr = ptr;
+				int64_t offset = address.second - firstOffset;
+				if (offset != 0)
+				{
+					IRBuilder<> build(gep);
+					newPtr = build.CreateGEP(ptr, ConstantInt::get(indexType, offset));
+					newPtr->takeName(gep);
+				}
+				gep->replaceAllUsesWith(newPtr);
+				gep->eraseFromParent();
+				RecursivelyDeleteTriviallyDeadInstructions(index);
+			}
+			changed = true;
+		}
+
+		// If iv was only used for array indices, all that's left
+		// of it is the add to get to the next iteration
+		Instruction* next = dyn_cast<Instruction>(iv->getIncomingValueForBlock(latch));
+		if (iv->hasOneUse() && next != nullptr && next->hasOneUse() &&
+			*iv->user_begin() == next && *next->user_begin() == iv)
+		{
+			iv->replaceAllUsesWith(UndefValue::get(iv->getType()));
+			iv->eraseFromParent();
+			next->eraseFromParent();
+		}
+	}
+
+	return changed;
+}
+
+void IndVars::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// Instructions are only added to/removed from
+	// blocks in the loop, so the CFG doesn't change
+	Info.setPreservesCFG();
+	Info.addRequired<LoopInfo>();
+	Info.addPreserved<LoopInfo>();
+	Info.addPreserved<DominatorTreeWrapperPass>();
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::IndVars::ID = 0;
@@ -0,0 +1,183 @@
+//
+//  Inliner.cpp
+//  uscc
+//
+//  Implements the function inliner. Functions are visited
+//  callees first (bottom-up in the call graph), so a call is
+//  judged on the size of the callee after its own calls have
+//  been inlined.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma clang diagnostic pop
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// The cost of inlining a call starts at the number of instructions
+// in the callee, since they're all copied into the caller
+
+// Inlining removes the call and the return
+const int CallBonus = 5;
+// Each argument doesn't have to be passed anymore
+const int ArgBonus = 1;
+// Each use of a parameter that's a constant at the call
+// site will likely fold away once it's inlined
+const int ConstantArgBonus = 2;
+// Inlining a function that's part of a cycle in the call graph
+// doesn't get rid of the cycle, so it only pays off when the
+// function is tiny
+const int RecursionPenalty = 20;
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool Inliner::runOnModule(Module& M)
+{
+	// scc_iterator visits the strongly connected components of
+	// the call graph in post-order, which means callees first
+	CallGraph callGraph(M);
+	std::vector<Function*> order;
+	std::set<Function*> recursive;
+	for (scc_iterator<CallGraph*> scc = scc_begin(&callGraph); !scc.isAtEnd(); ++scc)
+	{
+		for (CallGraphNode* node : *scc)
+		{
+			Function* func = node->getFunction();
+			if (func == nullptr || func->isDeclaration())
+			{
+				continue;
+			}
+
+			order.push_back(func);
+			if (scc.hasLoop())
+			{
+				recursive.insert(func);
+			}
+		}
+	}
+
+	bool changed = false;
+	for (Function* func : order)
+	{
+		// Calls that come from inlined code were already
+		// considered when the callee was visited
+		std::vector<CallInst*> calls;
+		for (BasicBlock& block : *func)
+		{
+			for (Instruction& instr : block)
+			{
+				CallInst* call = dyn_cast<CallInst>(&instr);
+				if (call == nullptr)
+				{
+					continue;
+				}
+
+				// A function calling itself would never stop growing
+				Function* callee = call->getCalledFunction();
+				if (callee != nullptr && !callee->isDeclaration() && callee != func)
+				{
+					calls.push_back(call);
+				}
+			}
+		}
+
+		// The report numbers the calls to each callee from 1,
+		// in the order they are in the caller
+		std::map<Function*, unsigned> numCalls;
+		for (CallInst* call : calls)
+		{
+			Function* callee = call->getCalledFunction();
+			unsigned site = ++numCalls[callee];
+			int cost = getInlineCost(call, recursive.count(callee) != 0);
+			if (cost > mThreshold)
+			{
+				if (mReport != nullptr)
+				{
+					*mReport << "Didn't inline call " << site << " to " << callee->getName()
+						<< " in " << func->getName() << " (cost " << cost << ")\n";
+				}
+				continue;
+			}
+
+			// This also maps the callee's phis and return values
+			// into the blocks it's split the caller into
+			InlineFunctionInfo info;
+			if (InlineFunction(call, info))
+			{
+				if (mReport != nullptr)
+				{
+					*mReport << "Inlined call " << site << " to " << callee->getName()
+						<< " in " << func->getName() << " (cost " << cost << ")\n";
+				}
+				changed = true;
+			}
+		}
+	}
+
+	return changed;
+}
+
+void Inliner::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// Inlining changes the CFG of every caller,
+	// so no analysis is preserved
+}
+
+int Inliner::getInlineCost(CallInst* call, bool recursive)
+{
+	Function* callee = call->getCalledFunction();
+	int cost = 0;
+	for (BasicBlock& block : *callee)
+	{
+		cost += static_cast<int>(block.size());
+	}
+
+	cost -= CallBonus;
+	Function::arg_iterator arg = callee->arg_begin();
+	for (unsigned i = 0; i < call->getNumArgOperands(); i++, ++arg)
+	{
+		cost -= ArgBonus;
+		if (isa<Constant>(call->getArgOperand(i)))
+		{
+			cost -= ConstantArgBonus * static_cast<int>(arg->getNumUses());
+		}
+	}
+
+	if (recursive)
+	{
+		cost += RecursionPenalty;
+	}
+
+	return cost;
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::Inliner::ID = 0;
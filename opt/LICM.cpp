@@ -18,30 +18,426 @@
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Dominators.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Transforms/Utils/SSAUpdater.h>
 #pragma clang diagnostic pop
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 using namespace llvm;
 
+namespace
+{
+
+// Returns true if ptr is a local/global variable, or a constant element
+// of a local/global array that's in bounds, so it's always safe to load.
+// object is set to the variable/array, and element to the element.
+bool getConstantElement(Value* ptr, Value*& object, int64_t& element)
+{
+	// The emitter gets array[0] from the array, then indexes
+	// that, so the index can be spread over a chain of GEPs
+	int64_t offset = 0;
+	GEPOperator* gep = dyn_cast<GEPOperator>(ptr);
+	while (gep != nullptr && gep->getNumIndices() == 1)
+	{
+		ConstantInt* constant = dyn_cast<ConstantInt>(gep->getOperand(1));
+		if (constant == nullptr)
+		{
+			return false;
+		}
+		offset += constant->getSExtValue();
+		ptr = gep->getPointerOperand();
+		gep = dyn_cast<GEPOperator>(ptr);
+	}
+
+	object = ptr;
+	element = offset;
+	if (isa<AllocaInst>(ptr) || isa<GlobalVariable>(ptr))
+	{
+		return offset == 0;
+	}
+
+	if (gep == nullptr || gep->getNumIndices() != 2)
+	{
+		return false;
+	}
+	object = gep->getPointerOperand();
+	if (!isa<AllocaInst>(object) && !isa<GlobalVariable>(object))
+	{
+		return false;
+	}
+
+	// The first index steps over the whole array, so it has to be 0
+	ConstantInt* first = dyn_cast<ConstantInt>(gep->getOperand(1));
+	ConstantInt* index = dyn_cast<ConstantInt>(gep->getOperand(2));
+	ArrayType* array = dyn_cast<ArrayType>(cast<PointerType>(object->getType())->getElementType());
+	if (first == nullptr || !first->isZero() || index == nullptr || array == nullptr)
+	{
+		return false;
+	}
+	element += index->getSExtValue();
+	return element >= 0 && static_cast<uint64_t>(element) < array->getNumElements();
+}
+
+bool isDereferenceable(Value* ptr)
+{
+	Value* object;
+	int64_t element;
+	return getConstantElement(ptr, object, element);
+}
+
+// Returns true if this is a local that's only ever loaded or stored
+// to (directly or through GEPs), so calls can't access it
+bool isNonEscapingLocal(Value* object)
+{
+	if (!isa<AllocaInst>(object))
+	{
+		return false;
+	}
+
+	std::vector<Value*> worklist(1, object);
+	while (!worklist.empty())
+	{
+		Value* ptr = worklist.back();
+		worklist.pop_back();
+		for (User* user : ptr->users())
+		{
+			if (isa<LoadInst>(user))
+			{
+				continue;
+			}
+			else if (StoreInst* store = dyn_cast<StoreInst>(user))
+			{
+				// Storing the address itself somewhere lets it escape
+				if (store->getValueOperand() == ptr)
+				{
+					return false;
+				}
+			}
+			else if (isa<GetElementPtrInst>(user))
+			{
+				worklist.push_back(user);
+			}
+			else
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Returns false only if the two addresses can't be the same
+bool mayAlias(Value* first, Value* second)
+{
+	if (first == second)
+	{
+		return true;
+	}
+
+	Value* firstObject = GetUnderlyingObject(first);
+	Value* secondObject = GetUnderlyingObject(second);
+	if (firstObject != secondObject)
+	{
+		// Different locals/globals are different memory, and a pointer
+		// argument can't point to a local of this function
+		bool firstLocal = isa<AllocaInst>(firstObject);
+		bool secondLocal = isa<AllocaInst>(secondObject);
+		bool firstKnown = firstLocal || isa<GlobalVariable>(firstObject);
+		bool secondKnown = secondLocal || isa<GlobalVariable>(secondObject);
+		return !((firstKnown && secondKnown) ||
+				 (firstLocal && isa<Argument>(secondObject)) ||
+				 (secondLocal && isa<Argument>(firstObject)));
+	}
+
+	// Different constant elements of the same array don't overlap
+	int64_t firstElement;
+	int64_t secondElement;
+	if (getConstantElement(first, firstObject, firstElement) &&
+		getConstantElement(second, secondObject, secondElement))
+	{
+		return firstElement == secondElement;
+	}
+	return true;
+}
+
+Value* getPointerOperand(Instruction* access)
+{
+	if (LoadInst* load = dyn_cast<LoadInst>(access))
+	{
+		return load->getPointerOperand();
+	}
+	return cast<StoreInst>(access)->getPointerOperand();
+}
+
+// Rewrites the loads/stores of one address in a loop to use SSA
+// values, and stores the final value in each of the loop's exits
+class LoopPromoter : public LoadAndStorePromoter
+{
+public:
+	LoopPromoter(Value* ptr, const SmallVectorImpl<Instruction*>& accesses,
+				 SSAUpdater& ssa, const SmallVectorImpl<BasicBlock*>& exits,
+				 bool hasStore)
+	: LoadAndStorePromoter(accesses, ssa)
+	, mPtr(ptr)
+	, mSSA(ssa)
+	, mExits(exits)
+	, mHasStore(hasStore)
+	{ }
+
+	virtual void doExtraRewritesBeforeFinalDeletion() const override
+	{
+		if (!mHasStore)
+		{
+			return;
+		}
+
+		for (BasicBlock* exit : mExits)
+		{
+			Value* value = mSSA.GetValueInMiddleOfBlock(exit);
+			new StoreInst(value, mPtr, &*exit->getFirstInsertionPt());
+		}
+	}
+private:
+	Value* mPtr;
+	SSAUpdater& mSSA;
+	const SmallVectorImpl<BasicBlock*>& mExits;
+	bool mHasStore;
+};
+
+} // anonymous
+
 namespace uscc
 {
 namespace opt
 {
-	
+
 bool LICM::runOnLoop(llvm::Loop *L, llvm::LPPassManager &LPM)
 {
 	mChanged = false;
-	
-	// PA6: Implement
-	
+	mCurrLoop = L;
+	mLoopInfo = &getAnalysis<LoopInfo>();
+	mDomTree = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+
+	// Without a preheader, there's nowhere to move things to
+	if (L->getLoopPreheader() == nullptr)
+	{
+		return false;
+	}
+
+	// Visiting the blocks in dominator tree order means an instruction's
+	// operands from the loop are hoisted before it's checked
+	hoistPreOrder(mDomTree->getNode(L->getHeader()));
+
+	promoteMemory();
+
 	return mChanged;
 }
 
 void LICM::getAnalysisUsage(AnalysisUsage &Info) const
 {
-	// PA6: Implement
+	// Instructions only move to the preheader,
+	// so none of the analyses change
+	Info.setPreservesCFG();
+	Info.addRequired<DominatorTreeWrapperPass>();
+	Info.addRequired<LoopInfo>();
+	Info.addPreserved<DominatorTreeWrapperPass>();
+	Info.addPreserved<LoopInfo>();
+}
+
+bool LICM::isSafeToHoistInstr(llvm::Instruction* instr)
+{
+	// Only arithmetic and address computations are candidates, and
+	// only if moving them can't introduce a trap (such as dividing
+	// by a value that was checked against 0 in the loop)
+	return (isa<BinaryOperator>(instr) || isa<CastInst>(instr) ||
+			isa<SelectInst>(instr) || isa<GetElementPtrInst>(instr) ||
+			isa<CmpInst>(instr)) &&
+		mCurrLoop->hasLoopInvariantOperands(instr) &&
+		isSafeToSpeculativelyExecute(instr);
+}
+
+void LICM::hoistInstr(llvm::Instruction* instr)
+{
+	instr->moveBefore(mCurrLoop->getLoopPreheader()->getTerminator());
+	mChanged = true;
+}
+
+void LICM::hoistPreOrder(llvm::DomTreeNode* node)
+{
+	BasicBlock* block = node->getBlock();
+
+	// Inner loops were already visited, and anything invariant in
+	// them is in their preheader (which is in this loop) by now
+	if (mLoopInfo->getLoopFor(block) == mCurrLoop)
+	{
+		BasicBlock::iterator iter = block->begin();
+		while (iter != block->end())
+		{
+			Instruction* instr = &*iter;
+			++iter;
+			if (isSafeToHoistInstr(instr))
+			{
+				hoistInstr(instr);
+			}
+		}
+	}
+
+	for (DomTreeNode* child : node->getChildren())
+	{
+		if (mCurrLoop->contains(child->getBlock()))
+		{
+			hoistPreOrder(child);
+		}
+	}
+}
+
+bool LICM::runsEachIteration(llvm::BasicBlock* block)
+{
+	// Every iteration that goes around again
+	// runs the blocks that dominate the latches
+	SmallVector<BasicBlock*, 4> latches;
+	mCurrLoop->getLoopLatches(latches);
+	for (BasicBlock* latch : latches)
+	{
+		if (!mDomTree->dominates(block, latch))
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
-	
+
+void LICM::promoteMemory()
+{
+	BasicBlock* preheader = mCurrLoop->getLoopPreheader();
+	SmallVector<BasicBlock*, 4> exits;
+	mCurrLoop->getExitBlocks(exits);
+
+	// Stores can only be moved to the exits if
+	// they're never reached from outside the loop
+	bool dedicatedExits = true;
+	for (BasicBlock* exit : exits)
+	{
+		for (pred_iterator pred = pred_begin(exit); pred != pred_end(exit); ++pred)
+		{
+			if (!mCurrLoop->contains(*pred))
+			{
+				dedicatedExits = false;
+			}
+		}
+	}
+
+	// Every load/store in the loop, and whether anything
+	// else (a call) might access memory
+	std::vector<Instruction*> accesses;
+	bool hasCalls = false;
+	for (BasicBlock* block : mCurrLoop->getBlocks())
+	{
+		for (Instruction& instr : *block)
+		{
+			if (isa<LoadInst>(instr) || isa<StoreInst>(instr))
+			{
+				accesses.push_back(&instr);
+			}
+			else if (instr.mayReadOrWriteMemory())
+			{
+				hasCalls = true;
+			}
+		}
+	}
+
+	// The invariant addresses, in the order they're first accessed
+	std::vector<Value*> pointers;
+	for (Instruction* access : accesses)
+	{
+		Value* ptr = getPointerOperand(access);
+		if (mCurrLoop->isLoopInvariant(ptr) &&
+			std::find(pointers.begin(), pointers.end(), ptr) == pointers.end())
+		{
+			pointers.push_back(ptr);
+		}
+	}
+
+	for (Value* ptr : pointers)
+	{
+		// The value is loaded in the preheader, even if the
+		// loop body never runs, so that has to be safe
+		if (!isDereferenceable(ptr) ||
+			(hasCalls && !isNonEscapingLocal(GetUnderlyingObject(ptr))))
+		{
+			continue;
+		}
+
+		SmallVector<Instruction*, 8> uses;
+		bool hasStore = false;
+		bool storedEachIteration = false;
+		bool aliased = false;
+		for (Instruction* access : accesses)
+		{
+			if (access == nullptr)
+			{
+				continue;
+			}
+
+			Value* other = getPointerOperand(access);
+			if (other == ptr)
+			{
+				uses.push_back(access);
+				if (isa<StoreInst>(access))
+				{
+					hasStore = true;
+					storedEachIteration = storedEachIteration ||
+						runsEachIteration(access->getParent());
+				}
+			}
+			else if (mayAlias(ptr, other))
+			{
+				aliased = true;
+				break;
+			}
+		}
+
+		// The exits store the final value even if the loop didn't, so
+		// a store that only some iterations reach (such as one in an
+		// if) would be stored on paths that never stored it before
+		if (aliased || (hasStore && (!dedicatedExits || !storedEachIteration)))
+		{
+			continue;
+		}
+
+		// Uses in the loop read the value from the preheader, or the
+		// last store before them (with phis where paths merge)
+		SmallVector<PHINode*, 8> newPhis;
+		SSAUpdater ssa(&newPhis);
+		LoopPromoter promoter(ptr, uses, ssa, exits, hasStore);
+		LoadInst* initial = new LoadInst(ptr, ptr->getName() + ".promoted",
+										 preheader->getTerminator());
+		ssa.AddAvailableValue(preheader, initial);
+		promoter.run(uses);
+		if (initial->use_empty())
+		{
+			initial->eraseFromParent();
+		}
+		mChanged = true;
+
+		// The promoted loads/stores are deleted now
+		for (Instruction*& access : accesses)
+		{
+			if (std::find(uses.begin(), uses.end(), access) != uses.end())
+			{
+				access = nullptr;
+			}
+		}
+	}
+}
+
 } // opt
 } // uscc
 
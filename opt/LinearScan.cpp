@@ -0,0 +1,194 @@
+//
+//  LinearScan.cpp
+//  uscc
+//
+//  Implements the linear scan mode of the register allocator,
+//  which doesn't build an interference graph, so it's used
+//  for functions too big to color quickly
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "RegAlloc.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/CodeGen/LiveIntervalUnion.h>
+#include <llvm/CodeGen/MachineFunction.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Target/TargetRegisterInfo.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
+
+using namespace llvm;
+
+namespace uscc
+{
+namespace opt
+{
+
+void RegAlloc::linearScan()
+{
+	// Number the blocks in reverse post-order, which
+	// is the order the intervals are visited in
+	std::vector<unsigned> blockOrder(mFunc->getNumBlockIDs(), ~0u);
+	unsigned number = 0;
+	ReversePostOrderTraversal<MachineFunction*> rpot(mFunc);
+	for (MachineBasicBlock* block : rpot)
+	{
+		blockOrder[block->getNumber()] = number++;
+	}
+
+	// Intervals that haven't been visited, ordered by the block
+	// they start in and then where in the block they start
+	typedef std::tuple<unsigned, SlotIndex, unsigned> Start;
+	std::priority_queue<Start, std::vector<Start>, std::greater<Start>> unhandled;
+	auto enqueue = [&](unsigned reg)
+	{
+		LiveInterval& interval = mLIS->getInterval(reg);
+		if (interval.empty())
+		{
+			// Nothing can interfere with it
+			assignColor(interval);
+			return;
+		}
+
+		SlotIndex start = interval.beginIndex();
+		unsigned block = mLIS->getMBBFromIndex(start)->getNumber();
+		unhandled.push(Start(blockOrder[block], start, reg));
+	};
+
+	std::vector<LiveInterval*> intervals;
+	collectIntervals(intervals);
+	for (LiveInterval* interval : intervals)
+	{
+		enqueue(interval->reg);
+	}
+
+	SmallVector<unsigned, 4> retry;
+	while (!unhandled.empty())
+	{
+		unsigned reg = std::get<2>(unhandled.top());
+		unhandled.pop();
+
+		retry.clear();
+		allocate(reg, retry);
+		for (unsigned retryReg : retry)
+		{
+			enqueue(retryReg);
+		}
+	}
+
+	// Drops the intervals spilling left without uses
+	intervals.clear();
+	collectIntervals(intervals);
+}
+
+void RegAlloc::allocate(unsigned reg, SmallVectorImpl<unsigned>& retry)
+{
+	// Registers can be queued more than once, or lose
+	// all their uses when something else is spilled
+	if (!mLIS->hasInterval(reg) || mVRM->hasPhys(reg) || mRegInfo->reg_nodbg_empty(reg))
+	{
+		return;
+	}
+
+	LiveInterval& interval = mLIS->getInterval(reg);
+	if (!assignColor(interval))
+	{
+		// Spill whichever is cheaper, this interval or the
+		// intervals holding one of its colors
+		SmallVector<LiveInterval*, 4> evicted;
+		SmallVector<unsigned, 4> newRegs;
+		if (!evictForColor(interval, evicted))
+		{
+			if (!interval.isSpillable())
+			{
+				report_fatal_error("ran out of registers during register allocation");
+			}
+			spill(interval, newRegs);
+		}
+		for (LiveInterval* other : evicted)
+		{
+			spill(*other, newRegs);
+		}
+
+		for (unsigned newReg : newRegs)
+		{
+			if (mLIS->hasInterval(newReg))
+			{
+				retry.push_back(newReg);
+			}
+		}
+	}
+
+	retry.append(mRequeue.begin(), mRequeue.end());
+	mRequeue.clear();
+}
+
+bool RegAlloc::evictForColor(LiveInterval& interval,
+							 SmallVectorImpl<LiveInterval*>& evicted)
+{
+	const TargetRegisterInfo* regInfo = mRegInfo->getTargetRegisterInfo();
+	SmallVector<MCPhysReg, 16> colors;
+	getColors(interval, colors);
+
+	// Each color costs as much as the heaviest interval holding it
+	MCPhysReg bestColor = 0;
+	float bestWeight = interval.weight;
+	for (MCPhysReg physReg : colors)
+	{
+		float weight = 0.0f;
+		for (MCRegUnitIterator units(physReg, regInfo); units.isValid(); ++units)
+		{
+			LiveIntervalUnion::Query& query = mMatrix->query(interval, *units);
+			query.collectInterferingVRegs();
+			for (LiveInterval* other : query.interferingVRegs())
+			{
+				weight = std::max(weight, other->weight);
+			}
+		}
+
+		if (weight < bestWeight)
+		{
+			bestColor = physReg;
+			bestWeight = weight;
+		}
+	}
+
+	if (bestColor == 0)
+	{
+		return false;
+	}
+
+	// Unassigning changes the queries, so collect everything first
+	SmallVector<LiveInterval*, 8> holders;
+	for (MCRegUnitIterator units(bestColor, regInfo); units.isValid(); ++units)
+	{
+		LiveIntervalUnion::Query& query = mMatrix->query(interval, *units);
+		query.collectInterferingVRegs();
+		holders.append(query.interferingVRegs().begin(), query.interferingVRegs().end());
+	}
+
+	for (LiveInterval* other : holders)
+	{
+		// The same interval can hold more than one unit of the register
+		if (mVRM->hasPhys(other->reg))
+		{
+			mMatrix->unassign(*other);
+			evicted.push_back(other);
+		}
+	}
+
+	return assignColor(interval);
+}
+
+} // opt
+} // uscc
@@ -7,59 +7,51 @@
 */
 
 #include "Liveness.h"
+#include <llvm/IR/CFG.h>
+#include <algorithm>
+#include <utility>
 
 using namespace std;
 using namespace llvm;
 
-bool enableLiveness;
-
 char Liveness::ID = 0;
 INITIALIZE_PASS(Liveness, "liveness", "Liveness Analysis", true, true)
 
-FunctionPass *llvm::createLivenessPass() 
-{
-    return new Liveness();
-}
-
-namespace llvm
-{
-std::set<StringRef> operator+(const std::set<StringRef> & lhs, const std::set<StringRef> & rhs)
-{
-    std::set<StringRef> ret = lhs;
-    for (auto & i : rhs)
-        ret.insert(i);
-    return ret;
-}
-
-void operator+=(std::set<StringRef> & lhs, const std::set<StringRef> & rhs)
-{
-    for (auto & i : rhs)
-        lhs.insert(i);
-}
-
-std::set<StringRef> operator-(const std::set<StringRef> & lhs, const std::set<StringRef> & rhs)
+FunctionPass *llvm::createLivenessPass(raw_ostream *out) 
 {
-    std::set<StringRef> ret = lhs;
-    for (auto & i : rhs)
-        ret.erase(i);
-    return ret;
+    return new Liveness(out);
 }
 
-void operator-=(std::set<StringRef> & lhs, const std::set<StringRef> & rhs)
+// Computes the post order of the blocks reachable from entry, with an explicit
+// stack so that long chains of blocks can't overflow the native one.
+static void computePostOrder(BasicBlock *entry, const DenseMap<const BasicBlock *, unsigned> &bbIndex,
+                             std::vector<BasicBlock *> &order)
 {
-    for (auto & i : rhs)
-        lhs.erase(i);
-}
-}
-
-void computePostOrder(BasicBlock *entry, set<BasicBlock *> &visited, deque<BasicBlock *> &order) 
-{
-    visited.insert(entry);
-    auto succItr = llvm::succ_begin(entry), end = llvm::succ_end(entry);
-    for (; succItr != end; ++succItr) 
-        if (!visited.count(*succItr))
-        computePostOrder(*succItr, visited, order);
-    order.push_back(entry);
+    BitVector visited(bbIndex.size());
+    std::vector<std::pair<BasicBlock *, succ_iterator>> stack;
+    visited.set(bbIndex.lookup(entry));
+    stack.push_back(std::make_pair(entry, succ_begin(entry)));
+    while (!stack.empty())
+    {
+        BasicBlock *bb = stack.back().first;
+        succ_iterator &succItr = stack.back().second;
+        if (succItr != succ_end(bb))
+        {
+            BasicBlock *succ = *succItr;
+            ++succItr;
+            unsigned idx = bbIndex.lookup(succ);
+            if (!visited.test(idx))
+            {
+                visited.set(idx);
+                stack.push_back(std::make_pair(succ, succ_begin(succ)));
+            }
+        }
+        else
+        {
+            order.push_back(bb);
+            stack.pop_back();
+        }
+    }
 }
 
 bool Liveness::runOnFunction(Function &F) 
@@ -69,144 +61,242 @@ bool Liveness::runOnFunction(Function &F)
     BasicBlock &frontBB = F.front();
     BasicBlock &endBB = F.back();
     assert(!frontBB.empty() && !endBB.empty() && "the front/end basic block must not be empty!");
-    // The OUT set of the last block is empty.
-    bb2Out[&endBB] = std::set<StringRef>();
+    releaseMemory();
 
     // PA4
-    // Step #1: identify program variables.
+    // Step #1: identify program variables and number them in name order.
     for (auto & BB : F)
     {
         for (auto & ins : BB)
         {
-            if (ins.getOpcode() == Instruction::Alloca)
-                named.insert(ins.getName());
+            if (auto alloca = dyn_cast<AllocaInst>(&ins))
+                vars.push_back(alloca);
         }
     }
+    std::sort(vars.begin(), vars.end(), [](AllocaInst *a, AllocaInst *b) {
+        return a->getName() < b->getName();
+    });
+    for (unsigned i = 0, e = vars.size(); i < e; ++i)
+        varIndex[vars[i]] = i;
 
     // Step #2: calculate DEF/USE set for each basic block
-    std::map<BasicBlock *, std::set<StringRef>> bb2Use, bb2Def;
+    unsigned numVars = vars.size();
+    unsigned numBBs = 0;
     for (auto & BB : F)
     {
-        std::set<StringRef> use;
-        std::set<StringRef> def;
-        for (auto iter = BB.rbegin(); iter != BB.rend(); iter++)
-        {
-            StoreInst * store = dyn_cast_or_null<StoreInst>(&*iter);
-            LoadInst * load = dyn_cast_or_null<LoadInst>(&*iter);
-            if (store && named.find(store->getPointerOperand()->getName()) != named.end())
-            {
-                use.erase(iter->getOperand(1)->getName());
-                def.insert(iter->getOperand(1)->getName());
-            }
-            else if (load && named.find(load->getPointerOperand()->getName()) != named.end())
+        bbIndex[&BB] = numBBs++;
+        blocks.push_back(&BB);
+    }
+    // The OUT set of the last block is empty.
+    bbIn.assign(numBBs, BitVector(numVars));
+    bbOut.assign(numBBs, BitVector(numVars));
+    bbUse.assign(numBBs, BitVector(numVars));
+    bbDef.assign(numBBs, BitVector(numVars));
+    for (auto & BB : F)
+        computeUseDef(BB);
+
+    // Step #3: compute post order traversal.
+    computePostOrder(&frontBB, bbIndex, postOrder);
+    bbToPO.assign(numBBs, -1);
+    for (unsigned po = 0, e = postOrder.size(); po < e; ++po)
+        bbToPO[bbIndex[postOrder[po]]] = po;
+    // (The last block always counts, with its empty OUT set.)
+    reachable.resize(numBBs);
+    reachable.set(bbIndex[&endBB]);
+    for (auto bb : postOrder)
+        reachable.set(bbIndex[bb]);
+
+    // Step #4: solve with a worklist until the fixed point.
+    BitVector pending(postOrder.size(), true);
+    unsigned cnt = solve(pending);
+
+    // Step #5: output IN/OUT set for each basic block.
+    if (out) 
+    {
+        auto printSet = [this](const BitVector &set) {
+            for (int var = set.find_first(); var >= 0; var = set.find_next(var))
             {
-                use.insert(iter->getOperand(0)->getName());
-                def.erase(iter->getOperand(0)->getName());
+                StringRef name = vars[var]->getName();
+                *out << " " << name.substr(0, name.size() - 5);
             }
+            *out << "\n";
+        };
+        *out << "********** Live-in/Live-out information **********\n";
+        *out << "********** Function: " << F.getName().str() << ", analysis iterates " << cnt << " times\n";
+        for (auto &bb : F) 
+        {
+            unsigned idx = bbIndex[&bb];
+            *out << bb.getName() << ":\n";
+            *out << "  IN:";
+            printSet(bbIn[idx]);
+            *out << "  OUT:";
+            printSet(bbOut[idx]);
         }
-        bb2Use[&BB] = use;
-        bb2Def[&BB] = def;
     }
+    // Liveness does not change the input function at all.
+    return false;
+}
 
-    // Step #3: compute post order traversal.
-    set<BasicBlock *> visited;
-    std::deque<BasicBlock *> worklist;
-#if 0
-    for (auto &bb : F)
-        worklist.push_back(&bb);
-#else
-    computePostOrder(&F.front(), visited, worklist);
-#endif
-
-    // Step #4: iterate over control flow graph of the input function until the fixed point.
+// IN = USE | (OUT & ~DEF), a few words per block.
+// The worklist is a bit per post order position; seeding it with every block
+// is reverse post order on the reversed CFG. When a block's IN changes only
+// its predecessors are queued again: the ones later in post order are picked
+// up in this round, the rest in the next one. Returns the number of rounds,
+// counting the confirming round a full sweep would need after the last change
+// (so the count matches the sweeping solver's).
+unsigned Liveness::solve(BitVector &pending)
+{
     unsigned cnt = 0;
+    bool changed = false;
+    BitVector newIn(vars.size());
 
-    for (auto &i : bb2In)
-        i.second.clear();
-    for (auto &i : bb2Out)
-        i.second.clear();
-
-    bool change = true;
-    while (change)
+    while (pending.any())
     {
         cnt++;
-        change = false;
-        for (auto bb : worklist)
+        changed = false;
+        for (int po = pending.find_first(); po >= 0; po = pending.find_next(po))
         {
-            auto & in = bb2In[bb];
-            auto & out = bb2Out[bb];
-            auto & use = bb2Use[bb];
-            auto & def = bb2Def[bb];
-            std::set<StringRef> oldIn = in;
+            pending.reset(po);
+            BasicBlock *bb = postOrder[po];
+            unsigned idx = bbIndex[bb];
+            BitVector & out = bbOut[idx];
 
             for (auto iter = succ_begin(bb); iter != succ_end(bb); iter++)
-                out += bb2In[*iter];
+                out |= bbIn[bbIndex[*iter]];
 
-            in = use + (out - def);
+            newIn = out;
+            newIn.reset(bbDef[idx]);
+            newIn |= bbUse[idx];
 
-            if (oldIn != in)
-                change = true;
+            if (newIn != bbIn[idx])
+            {
+                changed = true;
+                bbIn[idx] = newIn;
+                for (auto iter = pred_begin(bb); iter != pred_end(bb); iter++)
+                {
+                    int predPO = bbToPO[bbIndex[*iter]];
+                    if (predPO >= 0)
+                        pending.set(predPO);
+                }
+            }
         }
     }
+    if (changed)
+        cnt++;
+    return cnt;
+}
 
-    // Step #5: output IN/OUT set for each basic block.
-    if (enableLiveness) 
+void Liveness::computeUseDef(BasicBlock &BB)
+{
+    BitVector &use = bbUse[bbIndex[&BB]];
+    BitVector &def = bbDef[bbIndex[&BB]];
+    use.reset();
+    def.reset();
+    for (auto iter = BB.rbegin(); iter != BB.rend(); iter++)
     {
-        llvm::outs() << "********** Live-in/Live-out information **********\n";
-        llvm::outs() << "********** Function: " << F.getName().str() << ", analysis iterates " << cnt << " times\n";
-        for (auto &bb : F) 
+        int var;
+        if (auto store = dyn_cast<StoreInst>(&*iter))
         {
-            llvm::outs() << bb.getName() << ":\n";
-            llvm::outs() << "  IN:";
-            for (auto &var : bb2In[&bb])
-                llvm::outs() << " " << var.substr(0, var.size() - 5);
-            llvm::outs() << "\n";
-            llvm::outs() << "  OUT:";
-            for (auto &var : bb2Out[&bb])
-                llvm::outs() << " " << var.substr(0, var.size() - 5);
-            llvm::outs() << "\n";
+            if ((var = getVarIndex(store->getPointerOperand())) >= 0)
+            {
+                use.reset(var);
+                def.set(var);
+            }
+        }
+        else if (auto load = dyn_cast<LoadInst>(&*iter))
+        {
+            if ((var = getVarIndex(load->getPointerOperand())) >= 0)
+            {
+                use.set(var);
+                def.reset(var);
+            }
         }
     }
-    // Liveness does not change the input function at all.
-    return false;
 }
 
-bool Liveness::isDead(llvm::Instruction &inst) 
+void Liveness::findDeadStores(BasicBlock &BB, std::vector<Instruction *> &dead)
 {
-    BasicBlock *bb = inst.getParent();
-    if (!bb)
-        return true;
-    if (!bb2Out.count(bb))
-        return true;
+    // Unreachable blocks are never visited, so every store in them is dead.
+    auto bbItr = bbIndex.find(&BB);
+    if (bbItr == bbIndex.end() || !reachable.test(bbItr->second))
+    {
+        for (auto & ins : BB)
+            if (isa<StoreInst>(&ins))
+                dead.push_back(&ins);
+        return;
+    }
 
     // PA4
-    StoreInst * st = dyn_cast_or_null<StoreInst>(&inst);
-    if (st && named.find(st->getPointerOperand()->getName()) != named.end())
+    // Walk backward from OUT, so live holds what is live right after each instruction.
+    BitVector live = bbOut[bbItr->second];
+    for (auto iter = BB.rbegin(); iter != BB.rend(); iter++)
     {
-        auto store = dyn_cast_or_null<StoreInst>(&inst);
-        auto name = store->getPointerOperand()->getName();
-        bool use = false;
-        for (auto iter = std::next(BasicBlock::iterator(inst)); iter != bb->end(); iter++)
+        int var;
+        if (auto store = dyn_cast<StoreInst>(&*iter))
         {
-            StoreInst * store = dyn_cast_or_null<StoreInst>(&*iter);
-            LoadInst * load = dyn_cast_or_null<LoadInst>(&*iter);
-            if (load)
-            {
-                auto useName = load->getPointerOperand()->getName();
-                if (useName == name)
-                {
-                    use = true;
-                    break;
-                }
-            }
-            if (store)
+            if ((var = getVarIndex(store->getPointerOperand())) >= 0)
             {
-                auto useName = store->getPointerOperand()->getName();
-                if (useName == name)
-                    break;
+                if (!live.test(var))
+                    dead.push_back(store);
+                live.reset(var);
             }
         }
-        return !bb2Out[bb].count(name) && !use;
+        else if (auto load = dyn_cast<LoadInst>(&*iter))
+        {
+            if ((var = getVarIndex(load->getPointerOperand())) >= 0)
+                live.set(var);
+        }
+    }
+}
+
+void Liveness::update(const SmallPtrSetImpl<BasicBlock *> &changed, std::vector<BasicBlock *> &rescan)
+{
+    // Deleting a load of v can only shrink the liveness of v itself (and deleting a
+    // dead store changes nothing), so only the variables whose USE/DEF changed in the
+    // changed blocks are affected.
+    BitVector affected(vars.size());
+    BitVector oldUse(vars.size()), oldDef(vars.size());
+    for (auto bb : changed)
+    {
+        unsigned idx = bbIndex[bb];
+        oldUse = bbUse[idx];
+        oldDef = bbDef[idx];
+        computeUseDef(*bb);
+        oldUse ^= bbUse[idx];
+        oldDef ^= bbDef[idx];
+        affected |= oldUse;
+        affected |= oldDef;
+        rescan.push_back(bb);
+    }
+    if (affected.none())
+        return;
+
+    // Re-running the transfer function from the current sets can't shrink them
+    // around loops, so clear the affected bits in every block where any of them
+    // is live and solve again over just those blocks.
+    BitVector pending(postOrder.size());
+    std::vector<std::pair<unsigned, BitVector>> oldOut;
+    BitVector tmp(vars.size());
+    for (unsigned po = 0, e = postOrder.size(); po < e; ++po)
+    {
+        unsigned idx = bbIndex[postOrder[po]];
+        tmp = bbIn[idx];
+        tmp |= bbOut[idx];
+        tmp &= affected;
+        if (tmp.none() && !changed.count(postOrder[po]))
+            continue;
+
+        oldOut.push_back(std::make_pair(idx, bbOut[idx]));
+        bbIn[idx].reset(affected);
+        bbOut[idx].reset(affected);
+        pending.set(po);
+    }
+    solve(pending);
+
+    // Blocks whose OUT set changed may have more dead stores now
+    for (auto & old : oldOut)
+    {
+        if (old.second != bbOut[old.first] && !changed.count(blocks[old.first]))
+            rescan.push_back(blocks[old.first]);
     }
-    return false;
 }
@@ -9,23 +9,51 @@
 #define USCC_LIVENESS_H
 
 #include "Passes.h"
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/IR/Operator.h>
 #include <llvm/IR/Instructions.h>
-#include <map>
 #include <vector>
-#include <set>
 
 namespace llvm {
 // Liveness analysis
 class Liveness : public FunctionPass 
 {
 private:
-    // IN[BB] and OUT[BB]
-    std::map<BasicBlock *, std::set<StringRef>> bb2In, bb2Out;
-    std::set<StringRef> named;
+    // Tracked variables (allocas), numbered densely in name order
+    // so that printing a set in bit order prints it sorted.
+    std::vector<AllocaInst *> vars;
+    DenseMap<const Value *, unsigned> varIndex;
+    // Blocks are numbered densely too, and IN[BB]/OUT[BB] are
+    // fixed-width bit vector rows indexed by block number.
+    DenseMap<const BasicBlock *, unsigned> bbIndex;
+    std::vector<BasicBlock *> blocks;
+    std::vector<BitVector> bbIn, bbOut, bbUse, bbDef;
+    // Blocks reachable from the entry (the only ones the analysis visits)
+    BitVector reachable;
+    // Post order of the reachable blocks, and each block's position in it (or -1)
+    std::vector<BasicBlock *> postOrder;
+    std::vector<int> bbToPO;
+    // Where to print the IN/OUT sets (nullptr to not print them)
+    raw_ostream *out;
+
+    // Returns the number of the variable ptr refers to, or -1 if it's not tracked.
+    int getVarIndex(const Value *ptr) const 
+    {
+        auto itr = varIndex.find(ptr);
+        return itr == varIndex.end() ? -1 : (int)itr->second;
+    }
+
+    // Calculates USE/DEF for a single block.
+    void computeUseDef(BasicBlock &BB);
+
+    // Iterates the blocks pending in the worklist (indexed by post order
+    // position) until IN/OUT reach the fixed point. Returns the number of rounds.
+    unsigned solve(BitVector &pending);
     public:
     static char ID;
-    Liveness() : FunctionPass(ID), bb2In(), bb2Out(), named() 
+    Liveness(raw_ostream *out = nullptr) : FunctionPass(ID), out(out)
     {
         initializeLivenessPass(*PassRegistry::getPassRegistry());
     }
@@ -33,19 +61,37 @@ private:
 
     virtual void releaseMemory() override 
     {
-        bb2In.clear();
-        bb2Out.clear();
-        named.clear();
+        vars.clear();
+        varIndex.clear();
+        bbIndex.clear();
+        blocks.clear();
+        bbIn.clear();
+        bbOut.clear();
+        bbUse.clear();
+        bbDef.clear();
+        reachable.clear();
+        postOrder.clear();
+        bbToPO.clear();
     }
 
     /**
-     * This function is called by other clients to check that a store is dead if its source value
-     * is never used by following loads. In this way, we can also remove other instructions directly/indirectly
-     * producing the source value.
-     * @param inst
-     * @return
+     * This function is called by other clients to find the stores in a block whose value is never
+     * used by following loads. It walks the block backward once from OUT[BB], so every store in the
+     * block is classified in a single scan. In this way, we can also remove other instructions
+     * directly/indirectly producing the source value.
+     * @param BB
+     * @param dead the dead stores are appended here
+     */
+    void findDeadStores(BasicBlock &BB, std::vector<Instruction *> &dead);
+
+    /**
+     * Brings IN/OUT up to date after loads/stores were deleted from the given blocks. Only the
+     * changed blocks and the predecessors whose OUT set shrinks as a result are recomputed.
+     * @param changed blocks whose instructions were deleted
+     * @param rescan receives the changed blocks and every block whose OUT set changed,
+     *               i.e. the blocks which may now contain more dead stores
      */
-    bool isDead(Instruction &inst);
+    void update(const SmallPtrSetImpl<BasicBlock *> &changed, std::vector<BasicBlock *> &rescan);
 };
 }
 
@@ -25,15 +25,25 @@ namespace uscc
 namespace opt
 {
 
-void registerOptPasses(legacy::PassManager& pm)
+void registerOptPasses(legacy::PassManager& pm, int inlineThreshold,
+					   bool vectorize, raw_ostream* inlineReport)
 {
 	PassRegistry& pr = *PassRegistry::getPassRegistry();
 	initializeLoopInfoPass(pr);
 	initializeDominatorTreeWrapperPassPass(pr);
-	pm.add(new ConstantOps());
+	pm.add(new Inliner(inlineThreshold, inlineReport));
+	pm.add(new ScalarRepl());
+	pm.add(new SCCP());
+	pm.add(new TailRecursion());
 	pm.add(new ConstantBranch());
 	pm.add(new DeadBlocks());
+	pm.add(new GVN());
 	pm.add(new LICM());
+	if (vectorize)
+	{
+		pm.add(new Vectorizer());
+	}
+	pm.add(new IndVars());
 	pm.add(new DominatorTreeWrapperPass());
 	pm.add(new LoopInfo());
 }
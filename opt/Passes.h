@@ -4,14 +4,23 @@
 //
 //  Declares the opt passes supported by USCC
 //
-//  At the moment, there are four passes:
-//     * Constant op removal
+//  At the moment, there are ten passes:
+//     * Function inlining
+//     * Scalar replacement of small local arrays
+//     * Sparse conditional constant propagation (SCCP)
+//     * Tail recursion elimination
 //     * Constant branch folding
 //     * Removal of dead blocks from CFG
+//     * Global value numbering (GVN)
 //     * Loop Invariant Code Motion (LICM)
+//     * Loop vectorization
+//     * Induction variable strength reduction
 //
 //  These passes will execute if uscc is ran with -O
 //
+//  It also declares the hooks for the graph coloring
+//  register allocator used when generating native code
+//
 //---------------------------------------------------------
 //  Copyright (c) 2014, Sanjay Madhav
 //  All rights reserved.
@@ -28,6 +37,12 @@
 #include <llvm/IR/Dominators.h>
 #pragma clang diagnostic pop
 
+// LLVM forward-declarations
+namespace llvm
+{
+	class CallInst;
+}
+
 using llvm::FunctionPass;
 using llvm::LoopPass;
 
@@ -37,15 +52,83 @@ namespace uscc
 namespace opt
 {
 
-// Helper function for registering the opt passes
-void registerOptPasses(llvm::legacy::PassManager& pm);
+// Helper function for registering the opt passes. Calls with an inline
+// cost of at most inlineThreshold are inlined, and reported to
+// inlineReport (if it's set). The vectorizer only runs if vectorize is set.
+void registerOptPasses(llvm::legacy::PassManager& pm, int inlineThreshold,
+					   bool vectorize, llvm::raw_ostream* inlineReport);
 void registerAnalysisPasses(llvm::PassRegistry &Registry);
 
-// Declares the Constant Propagation Pass
-struct ConstantOps : public FunctionPass
+// How the register allocator assigns registers
+enum class RegAllocKind
+{
+	GraphColor,
+	LinearScan,
+	// Spills first, then colors in dominance order
+	SSA
+};
+
+// Makes uscc's allocator the default register allocator for native
+// code, with numColors registers to color each value with. Graph
+// coloring switches to linear scan for functions with more than
+// linearScanThreshold virtual registers (0 for never).
+void registerRegAlloc(RegAllocKind kind, unsigned numColors,
+					  unsigned linearScanThreshold);
+
+// Sets where the register allocator reports its decisions, and its
+// time/spill count per function, for code generated on this thread
+// (nullptr for nowhere)
+void setRegAllocOutput(llvm::raw_ostream* output, llvm::raw_ostream* stats);
+
+// Declares the Function Inlining Pass
+struct Inliner : public llvm::ModulePass
+{
+	static char ID;
+	Inliner(int threshold, llvm::raw_ostream* report)
+	: ModulePass(ID)
+	, mThreshold(threshold)
+	, mReport(report)
+	{}
+	
+	virtual bool runOnModule(llvm::Module& M) override;
+	
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+
+	// Returns the cost of inlining call, where recursive is
+	// true if the callee is in a cycle of the call graph
+	int getInlineCost(llvm::CallInst* call, bool recursive);
+
+	int mThreshold;
+	llvm::raw_ostream* mReport;
+};
+
+// Declares the Scalar Replacement of Arrays Pass
+struct ScalarRepl : public FunctionPass
+{
+	static char ID;
+	ScalarRepl() : FunctionPass(ID) {}
+	
+	virtual bool runOnFunction(llvm::Function& F) override;
+	
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+};
+
+// Declares the Sparse Conditional Constant Propagation Pass
+struct SCCP : public FunctionPass
+{
+	static char ID;
+	SCCP() : FunctionPass(ID) {}
+	
+	virtual bool runOnFunction(llvm::Function& F) override;
+	
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+};
+
+// Declares the Tail Recursion Elimination Pass
+struct TailRecursion : public FunctionPass
 {
 	static char ID;
-	ConstantOps() : FunctionPass(ID) {}
+	TailRecursion() : FunctionPass(ID) {}
 	
 	virtual bool runOnFunction(llvm::Function& F) override;
 	
@@ -73,6 +156,17 @@ struct DeadBlocks : public FunctionPass
 	
 	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
 };
+
+// Declares the Global Value Numbering Pass
+struct GVN : public FunctionPass
+{
+	static char ID;
+	GVN() : FunctionPass(ID) {}
+	
+	virtual bool runOnFunction(llvm::Function& F) override;
+	
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+};
 	
 // Loop invariant code motion
 struct LICM : public LoopPass
@@ -88,6 +182,15 @@ struct LICM : public LoopPass
 	void hoistInstr(llvm::Instruction*);
     void hoistPreOrder(llvm::DomTreeNode*);
 
+	// Keeps array elements that are loaded/stored at a loop invariant
+	// address in a register for the whole loop, when nothing else
+	// in the loop can access them
+	void promoteMemory();
+
+	// Returns true if block runs in every iteration of the loop
+	// (that doesn't leave from the header)
+	bool runsEachIteration(llvm::BasicBlock* block);
+
 	// Data regarding the current loop
 	llvm::Loop* mCurrLoop;
 
@@ -100,13 +203,37 @@ struct LICM : public LoopPass
 	// Denotes whether or not loop has been modified
 	bool mChanged;
 };
+
+// Declares the Loop Vectorization Pass
+struct Vectorizer : public FunctionPass
+{
+	static char ID;
+	Vectorizer() : FunctionPass(ID) {}
+	
+	virtual bool runOnFunction(llvm::Function& F) override;
+	
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+};
+
+// Induction variable strength reduction
+struct IndVars : public LoopPass
+{
+	static char ID;
+	IndVars() : LoopPass(ID) {}
+	
+	virtual bool runOnLoop(llvm::Loop* L, llvm::LPPassManager& LPM) override;
+	
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+};
+
 } // opt
 } // uscc
 
 namespace llvm 
 {
     void initializeLivenessPass(PassRegistry &Registry);
-    FunctionPass* createLivenessPass();
+    // If out is set, the pass prints the live-in/live-out sets of every block to it.
+    FunctionPass* createLivenessPass(raw_ostream *out = nullptr);
     // Create a dead code elimination pass that behaves as a client of liveness.
     FunctionPass* createDCEPass();
 }
\ No newline at end of file
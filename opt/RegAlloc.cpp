@@ -0,0 +1,541 @@
+//
+//  RegAlloc.cpp
+//  uscc
+//
+//  Implements the Chaitin-Briggs graph coloring mode of the
+//  register allocator, and the parts shared with linear scan
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "RegAlloc.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/CodeGen/CalcSpillWeights.h>
+#include <llvm/CodeGen/LiveStackAnalysis.h>
+#include <llvm/CodeGen/MachineBlockFrequencyInfo.h>
+#include <llvm/CodeGen/MachineDominators.h>
+#include <llvm/CodeGen/MachineInstr.h>
+#include <llvm/CodeGen/MachineLoopInfo.h>
+#include <llvm/CodeGen/Passes.h>
+#include <llvm/CodeGen/RegAllocRegistry.h>
+#include <llvm/PassRegistry.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Target/TargetRegisterInfo.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <chrono>
+#include <set>
+
+using namespace llvm;
+
+namespace uscc
+{
+namespace opt
+{
+
+RegAllocKind RegAlloc::sKind = RegAllocKind::GraphColor;
+unsigned RegAlloc::sNumColors = 4;
+unsigned RegAlloc::sLinearScanThreshold = 0;
+thread_local raw_ostream* RegAlloc::sOutput = nullptr;
+thread_local raw_ostream* RegAlloc::sStats = nullptr;
+
+RegAlloc::RegAlloc()
+: MachineFunctionPass(ID)
+, mFunc(nullptr)
+, mRegInfo(nullptr)
+, mLIS(nullptr)
+, mVRM(nullptr)
+, mMatrix(nullptr)
+, mNumSpills(0)
+{
+	PassRegistry& pr = *PassRegistry::getPassRegistry();
+	initializeSlotIndexesPass(pr);
+	initializeLiveIntervalsPass(pr);
+	initializeRegisterCoalescerPass(pr);
+	initializeMachineSchedulerPass(pr);
+	initializeLiveStacksPass(pr);
+	initializeMachineDominatorTreePass(pr);
+	initializeMachineLoopInfoPass(pr);
+	initializeVirtRegMapPass(pr);
+	initializeLiveRegMatrixPass(pr);
+}
+
+void RegAlloc::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// The same analyses LLVM's own allocators need, most of which
+	// are used by the spiller. (Except LiveDebugVariables, which
+	// is private to lib/CodeGen, and only tracks the debug info
+	// uscc never emits.)
+	Info.setPreservesCFG();
+	Info.addRequired<AliasAnalysis>();
+	Info.addPreserved<AliasAnalysis>();
+	Info.addRequired<LiveIntervals>();
+	Info.addPreserved<LiveIntervals>();
+	Info.addPreserved<SlotIndexes>();
+	Info.addRequired<LiveStacks>();
+	Info.addPreserved<LiveStacks>();
+	Info.addRequired<MachineBlockFrequencyInfo>();
+	Info.addPreserved<MachineBlockFrequencyInfo>();
+	Info.addRequiredID(MachineDominatorsID);
+	Info.addPreservedID(MachineDominatorsID);
+	Info.addRequired<MachineLoopInfo>();
+	Info.addPreserved<MachineLoopInfo>();
+	Info.addRequired<VirtRegMap>();
+	Info.addPreserved<VirtRegMap>();
+	Info.addRequired<LiveRegMatrix>();
+	Info.addPreserved<LiveRegMatrix>();
+	MachineFunctionPass::getAnalysisUsage(Info);
+}
+
+bool RegAlloc::runOnMachineFunction(MachineFunction& MF)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	mFunc = &MF;
+	mRegInfo = &MF.getRegInfo();
+	mLIS = &getAnalysis<LiveIntervals>();
+	mVRM = &getAnalysis<VirtRegMap>();
+	mMatrix = &getAnalysis<LiveRegMatrix>();
+	mRegClassInfo.runOnMachineFunction(MF);
+	mSpiller.reset(createInlineSpiller(*this, MF, *mVRM));
+	mNumSpills = 0;
+
+	// Spill weights are the use/def counts of each interval,
+	// scaled by the frequency (and so loop depth) of their blocks
+	calculateSpillWeightsAndHints(*mLIS, MF, getAnalysis<MachineLoopInfo>(),
+								  getAnalysis<MachineBlockFrequencyInfo>());
+
+	if (sOutput)
+	{
+		*sOutput << "********** USCC REGISTER ALLOCATION **********\n";
+		*sOutput << "********** Function: " << MF.getName() << "\n";
+		*sOutput << "NUM_COLORS=" << sNumColors << "\n";
+	}
+
+	// The interference graph can have a quadratic number of edges,
+	// so big functions use linear scan instead
+	bool useLinearScan = sKind == RegAllocKind::LinearScan ||
+		(sKind == RegAllocKind::GraphColor && sLinearScanThreshold != 0 &&
+		 mRegInfo->getNumVirtRegs() > sLinearScanThreshold);
+	const char* allocator;
+	if (useLinearScan)
+	{
+		allocator = "linear scan";
+		linearScan();
+	}
+	else if (sKind == RegAllocKind::SSA)
+	{
+		allocator = "SSA coloring";
+		colorSSA();
+	}
+	else
+	{
+		allocator = "graph coloring";
+		colorGraph();
+	}
+
+	mSpiller.reset();
+	mRequeue.clear();
+
+	if (sStats)
+	{
+		auto end = std::chrono::steady_clock::now();
+		unsigned numCopies = 0;
+		unsigned numRemoved = countRemovedCopies(numCopies);
+		*sStats << "  " << MF.getName() << ": "
+			<< allocator << " register allocation "
+			<< format("%g", std::chrono::duration<double, std::milli>(end - start).count())
+			<< " ms, " << mNumSpills << " spills, "
+			<< numRemoved << " of " << numCopies << " copies removed\n";
+	}
+	return true;
+}
+
+unsigned RegAlloc::countRemovedCopies(unsigned& numCopies)
+{
+	unsigned numRemoved = 0;
+	numCopies = 0;
+	for (MachineBasicBlock& block : *mFunc)
+	{
+		for (MachineInstr& instr : block)
+		{
+			if (!instr.isCopy())
+			{
+				continue;
+			}
+			numCopies++;
+
+			// The rewriter deletes copies from a register to itself
+			unsigned dest = getCopyReg(instr.getOperand(0));
+			if (dest != 0 && dest == getCopyReg(instr.getOperand(1)))
+			{
+				numRemoved++;
+			}
+		}
+	}
+	return numRemoved;
+}
+
+unsigned RegAlloc::getCopyReg(const MachineOperand& operand)
+{
+	// Copies of part of a register aren't coalesced
+	if (operand.getSubReg() != 0)
+	{
+		return 0;
+	}
+
+	unsigned reg = operand.getReg();
+	if (TargetRegisterInfo::isVirtualRegister(reg))
+	{
+		return mVRM->hasPhys(reg) ? mVRM->getPhys(reg) : 0;
+	}
+	return reg;
+}
+
+void RegAlloc::colorGraph()
+{
+	// Chaitin's loop: if any interval has to be spilled, the spill
+	// code changes the graph, so everything is colored again
+	while (true)
+	{
+		buildGraph();
+		simplify();
+		select();
+
+		if (mSpills.empty())
+		{
+			break;
+		}
+
+		for (LiveInterval* interval : mAssigned)
+		{
+			mMatrix->unassign(*interval);
+		}
+		for (LiveInterval* interval : mSpills)
+		{
+			SmallVector<unsigned, 4> newRegs;
+			spill(*interval, newRegs);
+		}
+	}
+
+	mNodes.clear();
+	mEdges.clear();
+	mAssigned.clear();
+	mSpills.clear();
+}
+
+void RegAlloc::buildGraph()
+{
+	mNodes.clear();
+	mEdges.clear();
+	collectIntervals(mNodes);
+	mEdges.resize(mNodes.size());
+
+	// Sweep the intervals in order of where they start. Only
+	// intervals that start before this one ends can overlap it.
+	// (Empty intervals don't interfere with anything.)
+	std::vector<unsigned> order;
+	for (unsigned i = 0; i < mNodes.size(); i++)
+	{
+		if (!mNodes[i]->empty())
+		{
+			order.push_back(i);
+		}
+	}
+	std::sort(order.begin(), order.end(), [this](unsigned a, unsigned b)
+	{
+		return mNodes[a]->beginIndex() < mNodes[b]->beginIndex();
+	});
+
+	for (unsigned i = 0; i < order.size(); i++)
+	{
+		LiveInterval* first = mNodes[order[i]];
+		for (unsigned j = i + 1; j < order.size(); j++)
+		{
+			LiveInterval* second = mNodes[order[j]];
+			if (!(second->beginIndex() < first->endIndex()))
+			{
+				break;
+			}
+			if (first->overlaps(*second))
+			{
+				mEdges[order[i]].push_back(order[j]);
+				mEdges[order[j]].push_back(order[i]);
+			}
+		}
+	}
+}
+
+void RegAlloc::simplify()
+{
+	mStack.clear();
+
+	std::vector<unsigned> degree(mNodes.size());
+	std::vector<bool> removed(mNodes.size(), false);
+	// Nodes with fewer than K neighbors, which can always be colored
+	std::set<unsigned> lowDegree;
+	for (unsigned i = 0; i < mNodes.size(); i++)
+	{
+		degree[i] = static_cast<unsigned>(mEdges[i].size());
+		if (degree[i] < sNumColors)
+		{
+			lowDegree.insert(i);
+		}
+	}
+
+	while (mStack.size() < mNodes.size())
+	{
+		unsigned node;
+		if (!lowDegree.empty())
+		{
+			node = *lowDegree.begin();
+			lowDegree.erase(lowDegree.begin());
+			if (sOutput)
+			{
+				*sOutput << "Found neighbors=" << degree[node] << " for "
+					<< *mNodes[node] << "\n";
+			}
+		}
+		else
+		{
+			// Every node left has at least K neighbors, so optimistically
+			// remove the cheapest one to spill. It may still get a color.
+			node = static_cast<unsigned>(mNodes.size());
+			for (unsigned i = 0; i < mNodes.size(); i++)
+			{
+				if (!removed[i] &&
+					(node == mNodes.size() || mNodes[i]->weight < mNodes[node]->weight))
+				{
+					node = i;
+				}
+			}
+			if (sOutput)
+			{
+				*sOutput << "Spill candidate (neighbors=" << degree[node]
+					<< ", weight=" << format("%g", mNodes[node]->weight) << "): "
+					<< *mNodes[node] << "\n";
+			}
+		}
+
+		if (sOutput)
+		{
+			*sOutput << "Removal: " << *mNodes[node] << "\n";
+		}
+		removed[node] = true;
+		mStack.push_back(node);
+
+		for (unsigned neighbor : mEdges[node])
+		{
+			if (!removed[neighbor] && --degree[neighbor] == sNumColors - 1)
+			{
+				lowDegree.insert(neighbor);
+			}
+		}
+	}
+}
+
+void RegAlloc::select()
+{
+	mAssigned.clear();
+	mSpills.clear();
+	while (!mStack.empty())
+	{
+		LiveInterval* interval = mNodes[mStack.back()];
+		mStack.pop_back();
+
+		if (assignColor(*interval))
+		{
+			mAssigned.push_back(interval);
+		}
+		else if (interval->isSpillable())
+		{
+			mSpills.push_back(interval);
+		}
+		else
+		{
+			report_fatal_error("ran out of registers during register allocation");
+		}
+	}
+}
+
+void RegAlloc::collectIntervals(std::vector<LiveInterval*>& intervals)
+{
+	for (unsigned i = 0, e = mRegInfo->getNumVirtRegs(); i < e; i++)
+	{
+		unsigned reg = TargetRegisterInfo::index2VirtReg(i);
+		if (!mLIS->hasInterval(reg))
+		{
+			continue;
+		}
+
+		// Spilling can leave registers behind with no uses left
+		if (mRegInfo->reg_nodbg_empty(reg))
+		{
+			mLIS->removeInterval(reg);
+			continue;
+		}
+
+		intervals.push_back(&mLIS->getInterval(reg));
+	}
+}
+
+void RegAlloc::getColors(LiveInterval& interval, SmallVectorImpl<MCPhysReg>& colors)
+{
+	ArrayRef<MCPhysReg> order =
+		mRegClassInfo.getOrder(mRegInfo->getRegClass(interval.reg));
+
+	// Registers clobbered by calls or used for arguments/return values
+	// while this interval is live aren't colors it can have, so skip
+	// them rather than counting them against K
+	for (MCPhysReg physReg : order)
+	{
+		if (mMatrix->checkRegMaskInterference(interval, physReg) ||
+			mMatrix->checkRegUnitInterference(interval, physReg))
+		{
+			continue;
+		}
+
+		// Spill code can't be spilled again, so it's allowed
+		// to use any register
+		if (colors.size() == sNumColors && interval.isSpillable())
+		{
+			break;
+		}
+		colors.push_back(physReg);
+	}
+}
+
+bool RegAlloc::assignColor(LiveInterval& interval)
+{
+	SmallVector<MCPhysReg, 16> colors;
+	getColors(interval, colors);
+
+	// The copies phi elimination leaves behind are removed if both
+	// sides get the same register, so the colors of the values this
+	// is copied to/from are tried first
+	SmallVector<unsigned, 4> preferred;
+	for (MachineInstr& instr : mRegInfo->reg_nodbg_instructions(interval.reg))
+	{
+		if (!instr.isCopy())
+		{
+			continue;
+		}
+
+		const MachineOperand& other = instr.getOperand(0).getReg() == interval.reg ?
+			instr.getOperand(1) : instr.getOperand(0);
+		unsigned physReg = getCopyReg(other);
+		if (physReg != 0 &&
+			std::find(colors.begin(), colors.end(), physReg) != colors.end())
+		{
+			preferred.push_back(physReg);
+		}
+	}
+	for (unsigned physReg : preferred)
+	{
+		if (mMatrix->checkInterference(interval, physReg) == LiveRegMatrix::IK_Free)
+		{
+			mMatrix->assign(interval, physReg);
+			if (sOutput)
+			{
+				*sOutput << "Assigning to physical register: " << interval << "\n";
+			}
+			return true;
+		}
+	}
+
+	for (MCPhysReg physReg : colors)
+	{
+		if (mMatrix->checkInterference(interval, physReg) == LiveRegMatrix::IK_Free)
+		{
+			mMatrix->assign(interval, physReg);
+			if (sOutput)
+			{
+				*sOutput << "Assigning to physical register: " << interval << "\n";
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void RegAlloc::spill(LiveInterval& interval, SmallVectorImpl<unsigned>& newRegs)
+{
+	if (sOutput)
+	{
+		*sOutput << "Spilling: " << interval << "\n";
+	}
+	mNumSpills++;
+
+	LiveRangeEdit edit(&interval, newRegs, *mFunc, *mLIS, mVRM, this);
+	mSpiller->spill(edit);
+
+	// The new registers only live around a single use or def
+	for (unsigned reg : newRegs)
+	{
+		if (mLIS->hasInterval(reg))
+		{
+			mLIS->getInterval(reg).markNotSpillable();
+		}
+	}
+}
+
+bool RegAlloc::LRE_CanEraseVirtReg(unsigned reg)
+{
+	if (mVRM->hasPhys(reg))
+	{
+		mMatrix->unassign(mLIS->getInterval(reg));
+		mRequeue.push_back(reg);
+	}
+	// The allocators may still point to the interval, so it's left
+	// for collectIntervals to remove once it has no uses
+	return false;
+}
+
+void RegAlloc::LRE_WillShrinkVirtReg(unsigned reg)
+{
+	if (mVRM->hasPhys(reg))
+	{
+		mMatrix->unassign(mLIS->getInterval(reg));
+		mRequeue.push_back(reg);
+	}
+}
+
+char RegAlloc::ID = 0;
+
+namespace
+{
+
+FunctionPass* createRegAlloc()
+{
+	return new RegAlloc();
+}
+
+RegisterRegAlloc usccRegAlloc("uscc", "uscc register allocator", createRegAlloc);
+
+} // anonymous
+
+void registerRegAlloc(RegAllocKind kind, unsigned numColors,
+					  unsigned linearScanThreshold)
+{
+	RegAlloc::sKind = kind;
+	RegAlloc::sNumColors = numColors;
+	RegAlloc::sLinearScanThreshold = linearScanThreshold;
+	RegisterRegAlloc::setDefault(createRegAlloc);
+}
+
+void setRegAllocOutput(llvm::raw_ostream* output, llvm::raw_ostream* stats)
+{
+	RegAlloc::sOutput = output;
+	RegAlloc::sStats = stats;
+}
+
+} // opt
+} // uscc
@@ -0,0 +1,161 @@
+//
+//  RegAlloc.h
+//  uscc
+//
+//  Declares the register allocator used for native code
+//  generation. It has a graph coloring mode (RegAlloc.cpp),
+//  a linear scan mode (LinearScan.cpp) and an SSA mode
+//  (SSAColoring.cpp), which share the code for assigning
+//  colors and spilling.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#pragma once
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/CodeGen/LiveIntervalAnalysis.h>
+#include <llvm/CodeGen/LiveRangeEdit.h>
+#include <llvm/CodeGen/LiveRegMatrix.h>
+#include <llvm/CodeGen/MachineFunctionPass.h>
+#include <llvm/CodeGen/MachineRegisterInfo.h>
+#include <llvm/CodeGen/RegisterClassInfo.h>
+#include <llvm/CodeGen/VirtRegMap.h>
+#include <llvm/Support/raw_ostream.h>
+#pragma clang diagnostic pop
+#include "Spiller.h"
+#include <memory>
+#include <vector>
+
+namespace uscc
+{
+namespace opt
+{
+
+class RegAlloc : public llvm::MachineFunctionPass,
+				 private llvm::LiveRangeEdit::Delegate
+{
+public:
+	static char ID;
+	RegAlloc();
+
+	virtual const char* getPassName() const override
+	{
+		return "USCC Register Allocator";
+	}
+
+	virtual bool runOnMachineFunction(llvm::MachineFunction& MF) override;
+
+	virtual void getAnalysisUsage(llvm::AnalysisUsage& Info) const override;
+
+	// Settings from registerRegAlloc
+	static RegAllocKind sKind;
+	static unsigned sNumColors;
+	static unsigned sLinearScanThreshold;
+
+	// Where the decisions and the statistics are reported, set per
+	// thread so each file compiled in parallel gets its own report
+	static thread_local llvm::raw_ostream* sOutput;
+	static thread_local llvm::raw_ostream* sStats;
+private:
+	// Graph coloring (RegAlloc.cpp)
+	void colorGraph();
+
+	// Collects the live interval of every virtual register that
+	// still needs a register, and builds the interference graph
+	void buildGraph();
+
+	// Removes nodes from the graph until it's empty, preferring nodes
+	// with fewer than K neighbors, and pushes them onto mStack
+	void simplify();
+
+	// Pops the nodes off mStack and colors them. Nodes that can't
+	// be colored are added to mSpills.
+	void select();
+
+	// Linear scan (LinearScan.cpp)
+	void linearScan();
+
+	// SSA coloring (SSAColoring.cpp)
+	void colorSSA();
+
+	// Spills intervals until no more than K are live at any point
+	void reducePressure();
+
+	// Shared by the allocators
+
+	// Assigns a color to the interval of reg, making room by spilling
+	// if needed. Registers that still need a color afterwards (spill
+	// code, and intervals that lost their color) are added to retry.
+	void allocate(unsigned reg, llvm::SmallVectorImpl<unsigned>& retry);
+
+	// Frees the color of interval that's held by the cheapest intervals,
+	// if they're cheaper to spill than interval, and assigns it. The
+	// intervals it was taken from are added to evicted.
+	bool evictForColor(llvm::LiveInterval& interval,
+					   llvm::SmallVectorImpl<llvm::LiveInterval*>& evicted);
+
+	// Adds the interval of every virtual register that's used to
+	// intervals, in virtual register order
+	void collectIntervals(std::vector<llvm::LiveInterval*>& intervals);
+
+	// Gets the registers this interval can be colored with: the first
+	// K registers of its class it isn't prevented from using by
+	// physical registers (or all of them, for spill code)
+	void getColors(llvm::LiveInterval& interval,
+				   llvm::SmallVectorImpl<llvm::MCPhysReg>& colors);
+
+	// Tries to assign one of its colors to this interval, preferring
+	// the registers of the values it's copied to/from
+	bool assignColor(llvm::LiveInterval& interval);
+
+	// Returns the register a copy operand ends up in
+	// (0 if it doesn't have one, or is a subregister)
+	unsigned getCopyReg(const llvm::MachineOperand& operand);
+
+	// Returns how many copies are between values which got the same
+	// register (so they will be removed), out of numCopies copies
+	unsigned countRemovedCopies(unsigned& numCopies);
+
+	// Replaces the interval with loads/stores around each use/def,
+	// adding the new registers (which can't be spilled) to newRegs
+	void spill(llvm::LiveInterval& interval,
+			   llvm::SmallVectorImpl<unsigned>& newRegs);
+
+	// Spilling can delete or shrink other intervals. Ones that have
+	// a register lose it and are added to mRequeue.
+	virtual bool LRE_CanEraseVirtReg(unsigned reg) override;
+	virtual void LRE_WillShrinkVirtReg(unsigned reg) override;
+
+	llvm::MachineFunction* mFunc;
+	llvm::MachineRegisterInfo* mRegInfo;
+	llvm::LiveIntervals* mLIS;
+	llvm::VirtRegMap* mVRM;
+	llvm::LiveRegMatrix* mMatrix;
+	llvm::RegisterClassInfo mRegClassInfo;
+	std::unique_ptr<llvm::Spiller> mSpiller;
+
+	// Nodes of the interference graph, in virtual register order
+	std::vector<llvm::LiveInterval*> mNodes;
+	// Indices of the neighbors of each node
+	std::vector<std::vector<unsigned>> mEdges;
+	// Node indices, in the order they were removed by simplify
+	std::vector<unsigned> mStack;
+	// Intervals which were colored/couldn't be colored by select
+	std::vector<llvm::LiveInterval*> mAssigned;
+	std::vector<llvm::LiveInterval*> mSpills;
+
+	// Registers unassigned by the spiller, to allocate again
+	std::vector<unsigned> mRequeue;
+
+	// Number of intervals spilled in this function
+	unsigned mNumSpills;
+};
+
+} // opt
+} // uscc
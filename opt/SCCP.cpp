@@ -0,0 +1,592 @@
+//
+//  SCCP.cpp
+//  uscc
+//
+//  Implements sparse conditional constant propagation --
+//  Finds every value that's constant along the paths the
+//  program can actually take (Wegman-Zadeck), replaces those
+//  values with constants, folds the branches on them and
+//  removes the blocks that can never execute
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#pragma clang diagnostic pop
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// Where a value is in the lattice. Values start out Unknown (nothing
+// that defines them has executed yet) and can only move down.
+struct LatticeVal
+{
+	enum State
+	{
+		Unknown,
+		Constant,
+		Overdefined
+	};
+
+	LatticeVal()
+	: mState(Unknown)
+	, mConstant(nullptr)
+	{ }
+
+	State mState;
+	ConstantInt* mConstant;
+};
+
+class SCCPSolver
+{
+public:
+	SCCPSolver(Function& F)
+	: mFunc(F)
+	{ }
+
+	// Runs until nothing changes, starting from the entry block
+	void solve();
+
+	// Moves the conditions that are still Unknown in a block that
+	// executes to Overdefined, so every branch has a successor.
+	// Returns true if it did, and solve has to run again.
+	bool resolveBranches();
+
+	// Replaces the constant values, folds the branches on them and
+	// deletes the blocks that never execute
+	bool rewrite();
+private:
+	LatticeVal getValue(Value* value);
+
+	// Lowers instr to newVal, and revisits its users if it changed
+	void update(Instruction* instr, const LatticeVal& newVal);
+	void markOverdefined(Instruction* instr);
+	void markConstant(Instruction* instr, const APInt& value);
+
+	void markEdgeFeasible(BasicBlock* from, BasicBlock* to);
+	bool isEdgeFeasible(BasicBlock* from, BasicBlock* to);
+
+	void visit(Instruction* instr);
+	void visitPHI(PHINode* phi);
+	void visitBinaryOperator(BinaryOperator* binOp);
+	void visitCast(CastInst* cast);
+	void visitICmp(ICmpInst* icmp);
+	void visitTerminator(TerminatorInst* term);
+
+	Function& mFunc;
+
+	DenseMap<Value*, LatticeVal> mValues;
+	SmallPtrSet<BasicBlock*, 32> mExecutable;
+	std::set<std::pair<BasicBlock*, BasicBlock*>> mFeasibleEdges;
+
+	// Blocks that just became executable, and instructions
+	// with an operand that changed
+	std::vector<BasicBlock*> mBlockWorklist;
+	std::vector<Instruction*> mInstrWorklist;
+};
+
+void SCCPSolver::solve()
+{
+	if (mExecutable.insert(&mFunc.getEntryBlock()))
+	{
+		mBlockWorklist.push_back(&mFunc.getEntryBlock());
+	}
+
+	while (!mBlockWorklist.empty() || !mInstrWorklist.empty())
+	{
+		while (!mInstrWorklist.empty())
+		{
+			Instruction* instr = mInstrWorklist.back();
+			mInstrWorklist.pop_back();
+			visit(instr);
+		}
+
+		while (!mBlockWorklist.empty())
+		{
+			BasicBlock* block = mBlockWorklist.back();
+			mBlockWorklist.pop_back();
+			for (Instruction& instr : *block)
+			{
+				visit(&instr);
+			}
+		}
+	}
+}
+
+bool SCCPSolver::resolveBranches()
+{
+	bool resolved = false;
+	for (BasicBlock& block : mFunc)
+	{
+		if (!mExecutable.count(&block))
+		{
+			continue;
+		}
+
+		BranchInst* br = dyn_cast<BranchInst>(block.getTerminator());
+		if (br == nullptr || !br->isConditional())
+		{
+			continue;
+		}
+
+		Instruction* cond = dyn_cast<Instruction>(br->getCondition());
+		if (cond != nullptr && getValue(cond).mState == LatticeVal::Unknown)
+		{
+			markOverdefined(cond);
+			mInstrWorklist.push_back(br);
+			resolved = true;
+		}
+	}
+
+	return resolved;
+}
+
+bool SCCPSolver::rewrite()
+{
+	bool changed = false;
+	std::vector<BasicBlock*> deadBlocks;
+	for (BasicBlock& block : mFunc)
+	{
+		if (!mExecutable.count(&block))
+		{
+			deadBlocks.push_back(&block);
+			continue;
+		}
+
+		// Replace the instructions that are always the same constant
+		BasicBlock::iterator iter = block.begin();
+		while (iter != block.end())
+		{
+			Instruction* instr = &*iter;
+			++iter;
+			LatticeVal value = getValue(instr);
+			if (value.mState == LatticeVal::Constant)
+			{
+				instr->replaceAllUsesWith(value.mConstant);
+				instr->eraseFromParent();
+				changed = true;
+			}
+		}
+
+		// A conditional branch with only one successor that's ever
+		// taken becomes an unconditional branch to it
+		BranchInst* br = dyn_cast<BranchInst>(block.getTerminator());
+		if (br != nullptr && br->isConditional())
+		{
+			BasicBlock* trueBlock = br->getSuccessor(0);
+			BasicBlock* falseBlock = br->getSuccessor(1);
+			bool trueFeasible = isEdgeFeasible(&block, trueBlock);
+			bool falseFeasible = isEdgeFeasible(&block, falseBlock);
+			if (trueFeasible != falseFeasible)
+			{
+				BasicBlock* dest = trueFeasible ? trueBlock : falseBlock;
+				BasicBlock* notTaken = trueFeasible ? falseBlock : trueBlock;
+				if (notTaken != dest)
+				{
+					notTaken->removePredecessor(&block);
+				}
+				BranchInst::Create(dest, br);
+				br->eraseFromParent();
+				changed = true;
+			}
+		}
+	}
+
+	// Nothing that executes branches to the dead blocks anymore, but
+	// they can still branch to (and use values from) each other
+	for (BasicBlock* block : deadBlocks)
+	{
+		for (succ_iterator succ = succ_begin(block); succ != succ_end(block); ++succ)
+		{
+			if (mExecutable.count(*succ))
+			{
+				(*succ)->removePredecessor(block);
+			}
+		}
+		block->dropAllReferences();
+	}
+	for (BasicBlock* block : deadBlocks)
+	{
+		block->eraseFromParent();
+		changed = true;
+	}
+
+	return changed;
+}
+
+LatticeVal SCCPSolver::getValue(Value* value)
+{
+	LatticeVal result;
+	if (ConstantInt* constant = dyn_cast<ConstantInt>(value))
+	{
+		result.mState = LatticeVal::Constant;
+		result.mConstant = constant;
+	}
+	else if (isa<Instruction>(value))
+	{
+		DenseMap<Value*, LatticeVal>::iterator iter = mValues.find(value);
+		if (iter != mValues.end())
+		{
+			result = iter->second;
+		}
+	}
+	else
+	{
+		// Arguments, globals and undef can be anything
+		result.mState = LatticeVal::Overdefined;
+	}
+
+	return result;
+}
+
+void SCCPSolver::update(Instruction* instr, const LatticeVal& newVal)
+{
+	LatticeVal& oldVal = mValues[instr];
+	if (oldVal.mState == newVal.mState && oldVal.mConstant == newVal.mConstant)
+	{
+		return;
+	}
+	oldVal = newVal;
+
+	// Users in blocks that haven't executed yet get
+	// visited when their block does
+	for (User* user : instr->users())
+	{
+		Instruction* userInstr = cast<Instruction>(user);
+		if (mExecutable.count(userInstr->getParent()))
+		{
+			mInstrWorklist.push_back(userInstr);
+		}
+	}
+}
+
+void SCCPSolver::markOverdefined(Instruction* instr)
+{
+	LatticeVal value;
+	value.mState = LatticeVal::Overdefined;
+	update(instr, value);
+}
+
+void SCCPSolver::markConstant(Instruction* instr, const APInt& result)
+{
+	LatticeVal value;
+	value.mState = LatticeVal::Constant;
+	value.mConstant = ConstantInt::get(instr->getContext(), result);
+	update(instr, value);
+}
+
+void SCCPSolver::markEdgeFeasible(BasicBlock* from, BasicBlock* to)
+{
+	if (!mFeasibleEdges.insert(std::make_pair(from, to)).second)
+	{
+		return;
+	}
+
+	if (mExecutable.insert(to))
+	{
+		mBlockWorklist.push_back(to);
+	}
+	else
+	{
+		// The phis have a new incoming value to merge
+		for (BasicBlock::iterator iter = to->begin(); isa<PHINode>(iter); ++iter)
+		{
+			mInstrWorklist.push_back(&*iter);
+		}
+	}
+}
+
+bool SCCPSolver::isEdgeFeasible(BasicBlock* from, BasicBlock* to)
+{
+	return mFeasibleEdges.count(std::make_pair(from, to)) != 0;
+}
+
+void SCCPSolver::visit(Instruction* instr)
+{
+	// Once it's Overdefined, it can't change again
+	if (getValue(instr).mState == LatticeVal::Overdefined)
+	{
+		return;
+	}
+
+	if (PHINode* phi = dyn_cast<PHINode>(instr))
+	{
+		visitPHI(phi);
+	}
+	else if (BinaryOperator* binOp = dyn_cast<BinaryOperator>(instr))
+	{
+		visitBinaryOperator(binOp);
+	}
+	else if (CastInst* cast = dyn_cast<CastInst>(instr))
+	{
+		visitCast(cast);
+	}
+	else if (ICmpInst* icmp = dyn_cast<ICmpInst>(instr))
+	{
+		visitICmp(icmp);
+	}
+	else if (TerminatorInst* term = dyn_cast<TerminatorInst>(instr))
+	{
+		visitTerminator(term);
+	}
+	else if (!instr->getType()->isVoidTy())
+	{
+		// Loads, calls and addresses aren't tracked
+		markOverdefined(instr);
+	}
+}
+
+void SCCPSolver::visitPHI(PHINode* phi)
+{
+	// Only the values coming in along edges that are taken count
+	LatticeVal result;
+	for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+	{
+		if (!isEdgeFeasible(phi->getIncomingBlock(i), phi->getParent()))
+		{
+			continue;
+		}
+
+		LatticeVal incoming = getValue(phi->getIncomingValue(i));
+		if (incoming.mState == LatticeVal::Unknown)
+		{
+			continue;
+		}
+		else if (incoming.mState == LatticeVal::Overdefined ||
+				 (result.mState == LatticeVal::Constant &&
+				  result.mConstant != incoming.mConstant))
+		{
+			markOverdefined(phi);
+			return;
+		}
+		result = incoming;
+	}
+
+	if (result.mState == LatticeVal::Constant)
+	{
+		update(phi, result);
+	}
+}
+
+void SCCPSolver::visitBinaryOperator(BinaryOperator* binOp)
+{
+	LatticeVal lhsVal = getValue(binOp->getOperand(0));
+	LatticeVal rhsVal = getValue(binOp->getOperand(1));
+	if (lhsVal.mState == LatticeVal::Overdefined ||
+		rhsVal.mState == LatticeVal::Overdefined)
+	{
+		markOverdefined(binOp);
+		return;
+	}
+	else if (lhsVal.mState == LatticeVal::Unknown ||
+			 rhsVal.mState == LatticeVal::Unknown)
+	{
+		return;
+	}
+
+	const APInt& lhs = lhsVal.mConstant->getValue();
+	const APInt& rhs = rhsVal.mConstant->getValue();
+	APInt result;
+	switch (binOp->getOpcode())
+	{
+		case Instruction::Add:
+			result = lhs + rhs;
+			break;
+		case Instruction::Sub:
+			result = lhs - rhs;
+			break;
+		case Instruction::Mul:
+			result = lhs * rhs;
+			break;
+		case Instruction::SDiv:
+		case Instruction::SRem:
+			// Dividing by 0 (or INT_MIN by -1) is undefined, and has
+			// to stay in the program so it happens at run time
+			if (rhs == 0 || (lhs.isMinSignedValue() && rhs.isAllOnesValue()))
+			{
+				markOverdefined(binOp);
+				return;
+			}
+			result = binOp->getOpcode() == Instruction::SDiv ? lhs.sdiv(rhs) : lhs.srem(rhs);
+			break;
+		case Instruction::And:
+			result = lhs & rhs;
+			break;
+		case Instruction::Or:
+			result = lhs | rhs;
+			break;
+		case Instruction::Xor:
+			result = lhs ^ rhs;
+			break;
+		default:
+			// uscc doesn't emit the others
+			markOverdefined(binOp);
+			return;
+	}
+
+	markConstant(binOp, result);
+}
+
+void SCCPSolver::visitCast(CastInst* cast)
+{
+	LatticeVal operand = getValue(cast->getOperand(0));
+	if (operand.mState == LatticeVal::Unknown)
+	{
+		return;
+	}
+	else if (operand.mState == LatticeVal::Overdefined ||
+			 !cast->getType()->isIntegerTy())
+	{
+		markOverdefined(cast);
+		return;
+	}
+
+	const APInt& value = operand.mConstant->getValue();
+	unsigned width = cast->getType()->getIntegerBitWidth();
+	switch (cast->getOpcode())
+	{
+		case Instruction::ZExt:
+			markConstant(cast, value.zext(width));
+			break;
+		case Instruction::SExt:
+			markConstant(cast, value.sext(width));
+			break;
+		case Instruction::Trunc:
+			markConstant(cast, value.trunc(width));
+			break;
+		default:
+			markOverdefined(cast);
+			break;
+	}
+}
+
+void SCCPSolver::visitICmp(ICmpInst* icmp)
+{
+	LatticeVal lhsVal = getValue(icmp->getOperand(0));
+	LatticeVal rhsVal = getValue(icmp->getOperand(1));
+	if (lhsVal.mState == LatticeVal::Overdefined ||
+		rhsVal.mState == LatticeVal::Overdefined)
+	{
+		markOverdefined(icmp);
+		return;
+	}
+	else if (lhsVal.mState == LatticeVal::Unknown ||
+			 rhsVal.mState == LatticeVal::Unknown)
+	{
+		return;
+	}
+
+	const APInt& lhs = lhsVal.mConstant->getValue();
+	const APInt& rhs = rhsVal.mConstant->getValue();
+	bool result = false;
+	switch (icmp->getPredicate())
+	{
+		case CmpInst::ICMP_EQ:
+			result = lhs == rhs;
+			break;
+		case CmpInst::ICMP_NE:
+			result = lhs != rhs;
+			break;
+		case CmpInst::ICMP_UGT:
+			result = lhs.ugt(rhs);
+			break;
+		case CmpInst::ICMP_UGE:
+			result = lhs.uge(rhs);
+			break;
+		case CmpInst::ICMP_ULT:
+			result = lhs.ult(rhs);
+			break;
+		case CmpInst::ICMP_ULE:
+			result = lhs.ule(rhs);
+			break;
+		case CmpInst::ICMP_SGT:
+			result = lhs.sgt(rhs);
+			break;
+		case CmpInst::ICMP_SGE:
+			result = lhs.sge(rhs);
+			break;
+		case CmpInst::ICMP_SLT:
+			result = lhs.slt(rhs);
+			break;
+		case CmpInst::ICMP_SLE:
+			result = lhs.sle(rhs);
+			break;
+		default:
+			markOverdefined(icmp);
+			return;
+	}
+
+	markConstant(icmp, APInt(1, result));
+}
+
+void SCCPSolver::visitTerminator(TerminatorInst* term)
+{
+	BasicBlock* block = term->getParent();
+	BranchInst* br = dyn_cast<BranchInst>(term);
+	if (br == nullptr || br->isUnconditional())
+	{
+		for (unsigned i = 0; i < term->getNumSuccessors(); i++)
+		{
+			markEdgeFeasible(block, term->getSuccessor(i));
+		}
+		return;
+	}
+
+	// Only the side the condition picks is taken, if it's constant
+	LatticeVal cond = getValue(br->getCondition());
+	if (cond.mState == LatticeVal::Constant)
+	{
+		unsigned taken = cond.mConstant->isZero() ? 1 : 0;
+		markEdgeFeasible(block, br->getSuccessor(taken));
+	}
+	else if (cond.mState == LatticeVal::Overdefined)
+	{
+		markEdgeFeasible(block, br->getSuccessor(0));
+		markEdgeFeasible(block, br->getSuccessor(1));
+	}
+}
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool SCCP::runOnFunction(Function& F)
+{
+	SCCPSolver solver(F);
+	do
+	{
+		solver.solve();
+	} while (solver.resolveBranches());
+
+	return solver.rewrite();
+}
+
+void SCCP::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// This pass removes blocks and edges, so it preserves nothing
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::SCCP::ID = 0;
@@ -14,6 +14,7 @@
 
 #include "SSABuilder.h"
 #include "../parse/Symbols.h"
+#include <algorithm>
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
@@ -28,63 +29,64 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/CFG.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/ValueHandle.h>
 #pragma clang diagnostic pop
 
-#include <list>
-
 using namespace uscc::opt;
 using namespace uscc::parse;
 using namespace llvm;
 
-// Called when a new function is started to clear out all the data
-void SSABuilder::reset()
+// Creates an empty phi at the start of the block (after any existing phis)
+static PHINode* createPhi(Identifier* var, BasicBlock* block)
 {
-	// PA5: Implement
-	for (auto& def : mVarDefs)
+	if (Instruction* first = block->getFirstNonPHI())
 	{
-		delete def.second;
+		return PHINode::Create(var->llvmType(block->getContext()), 0, "Phi", first);
 	}
-	mVarDefs.clear();
-
-	for (auto& phis : mIncompletePhis)
+	else
 	{
-		delete phis.second;
+		return PHINode::Create(var->llvmType(block->getContext()), 0, "Phi", block);
 	}
-	mIncompletePhis.clear();
+}
 
-	mSealedBlocks.clear();
+// Called when a new function is started to clear out all the data
+void SSABuilder::reset()
+{
+	// PA5: Implement
+	mBlocks.clear();
+	mBlockIdx.clear();
+	mVarIdx.clear();
+	mVarDefs.clear();
+	mPhiUses.clear();
+	mPendingPhis.clear();
 }
 
 // For a specific variable in a specific basic block, write its value
 void SSABuilder::writeVariable(Identifier* var, BasicBlock* block, Value* value)
 {
 	// PA5: Implement
-	SubMap *submap = mVarDefs[block];	
-	(*submap)[var] = value;
+	setDef(DefKey(getBlockIdx(block), getVarIdx(var)), value);
 }
 
 // Read the value assigned to the variable in the requested basic block
-// Will recursively search predecessor blocks if it was not written in this block
+// Will search predecessor blocks if it was not written in this block
 Value* SSABuilder::readVariable(Identifier* var, BasicBlock* block)
 {
 	// PA5: Implement
-	if (mVarDefs[block]->find(var) != mVarDefs[block]->end())
-	{
-		SubMap *submap = mVarDefs[block];	
-		return (*submap)[var];
-	}
-	else
-	{
-		return readVariableRecursive(var, block);
-	}
+	unsigned varIdx = getVarIdx(var);
+	Value* result = beginRead(var, varIdx, getBlockIdx(block));
+	return finishReads(var, varIdx, result);
 }
 
 // This is called to add a new block to the maps
 void SSABuilder::addBlock(BasicBlock* block, bool isSealed /* = false */)
 {
 	// PA5: Implement
-	mVarDefs[block] = new SubMap();
-	mIncompletePhis[block] = new SubPHI();
+	mBlockIdx[block] = static_cast<unsigned>(mBlocks.size());
+	BlockInfo info;
+	info.mBlock = block;
+	info.mSealed = false;
+	mBlocks.push_back(std::move(info));
 	if (isSealed)
 	{
 		sealBlock(block);
@@ -96,94 +98,229 @@ void SSABuilder::addBlock(BasicBlock* block, bool isSealed /* = false */)
 void SSABuilder::sealBlock(llvm::BasicBlock* block)
 {
 	// PA5: Implement
-	for (auto& phi : *mIncompletePhis[block])
+	unsigned blockIdx = getBlockIdx(block);
+	std::vector<std::pair<Identifier*, PHINode*>> phis;
+	phis.swap(mBlocks[blockIdx].mIncompletePhis);
+	for (auto& phi : phis)
 	{
 		addPhiOperands(phi.first, phi.second);
 	}
-	mSealedBlocks.insert(block);
+	mBlocks[blockIdx].mSealed = true;
 }
 
-// Recursively search predecessor blocks for a variable
-Value* SSABuilder::readVariableRecursive(Identifier* var, BasicBlock* block)
+// Starts reading the variable in a block. Returns the value if it's known
+// right away, otherwise pushes the frames needed and returns nullptr
+Value* SSABuilder::beginRead(Identifier* var, unsigned varIdx, unsigned blockIdx)
 {
-	Value* retVal = nullptr;
-	
-	// PA5: Implement
-	if (mSealedBlocks.find(block) == mSealedBlocks.end()) {
-		if (block->getFirstNonPHI() != block->end()) {
-			retVal = PHINode::Create(var->llvmType(), 0, "Phi", block->getFirstNonPHI());
+	while (true)
+	{
+		auto def = mVarDefs.find(DefKey(blockIdx, varIdx));
+		if (def != mVarDefs.end())
+		{
+			return def->second;
 		}
-		else {
-			retVal = PHINode::Create(var->llvmType(), 0, "Phi", block);
+		
+		BasicBlock* block = mBlocks[blockIdx].mBlock;
+		if (!mBlocks[blockIdx].mSealed)
+		{
+			// Incomplete CFG
+			PHINode* phi = createPhi(var, block);
+			mBlocks[blockIdx].mIncompletePhis.push_back(std::make_pair(var, phi));
+			setDef(DefKey(blockIdx, varIdx), phi);
+			return phi;
+		}
+		else if (BasicBlock* pred = block->getSinglePredecessor())
+		{
+			// Optimize the common case of one predecessor: no phi needed,
+			// just keep walking up and memoize on the way back
+			ReadFrame frame;
+			frame.mBlockIdx = blockIdx;
+			frame.mPhi = nullptr;
+			frame.mPredsLeft = 0;
+			mFrames.push_back(frame);
+			blockIdx = getBlockIdx(pred);
+		}
+		else
+		{
+			// Break potential cycles with operandless phi
+			PHINode* phi = createPhi(var, block);
+			setDef(DefKey(blockIdx, varIdx), phi);
+			pushPhiFrame(phi, blockIdx);
+			return nullptr;
 		}
-		SubPHI *subphi = mIncompletePhis[block];
-		(*subphi)[var] = dyn_cast<PHINode>(retVal);
 	}
-	else if (block->getSinglePredecessor() != nullptr) {
-		retVal = readVariable(var, block->getSinglePredecessor());
+}
+
+// Pushes a frame that reads the operands of phi from every predecessor
+void SSABuilder::pushPhiFrame(PHINode* phi, unsigned blockIdx)
+{
+	// Predecessors are pushed in reverse, so the first one is on top
+	// and the operands are added in order
+	size_t first = mPreds.size();
+	for (auto pred = pred_begin(phi->getParent()); pred != pred_end(phi->getParent()); pred++)
+	{
+		mPreds.push_back(*pred);
 	}
-	else {
-		if (block->getFirstNonPHI() != block->end()) {
-			retVal = PHINode::Create(var->llvmType(), 0, "Phi", block->getFirstNonPHI());
+	std::reverse(mPreds.begin() + first, mPreds.end());
+	
+	ReadFrame frame;
+	frame.mBlockIdx = blockIdx;
+	frame.mPhi = phi;
+	frame.mPredsLeft = static_cast<unsigned>(mPreds.size() - first);
+	mFrames.push_back(frame);
+	mPendingPhis.insert(phi);
+}
+
+// Finishes all the frames, memoizing the value in every block visited.
+// result is the value of the read that just finished (if any).
+Value* SSABuilder::finishReads(Identifier* var, unsigned varIdx, Value* result)
+{
+	while (!mFrames.empty())
+	{
+		ReadFrame& frame = mFrames.back();
+		if (result != nullptr)
+		{
+			if (frame.mPhi == nullptr)
+			{
+				// Single predecessor, so the block has the same value
+				setDef(DefKey(frame.mBlockIdx, varIdx), result);
+				mFrames.pop_back();
+				continue;
+			}
+			
+			// Read of the predecessor on top is done
+			frame.mPhi->addIncoming(result, mPreds.back());
+			mPreds.pop_back();
+			frame.mPredsLeft--;
 		}
-		else {
-			retVal = PHINode::Create(var->llvmType(), 0, "Phi", block);
+		
+		if (frame.mPredsLeft > 0)
+		{
+			result = beginRead(var, varIdx, getBlockIdx(mPreds.back()));
+		}
+		else
+		{
+			// The phi is complete, so it may be trivial now. Its definition
+			// is patched if it's removed, so read the value back from there
+			DefKey key(frame.mBlockIdx, varIdx);
+			PHINode* phi = frame.mPhi;
+			mFrames.pop_back();
+			mPendingPhis.erase(phi);
+			tryRemoveTrivialPhi(phi);
+			result = mVarDefs[key];
 		}
-		writeVariable(var, block, retVal);
-		retVal = addPhiOperands(var, dyn_cast<PHINode>(retVal));
 	}
-	writeVariable(var, block, retVal);
 	
-	return retVal;
+	return result;
 }
 
 // Adds phi operands based on predecessors of the containing block
-Value* SSABuilder::addPhiOperands(Identifier* var, PHINode* phi)
+void SSABuilder::addPhiOperands(Identifier* var, PHINode* phi)
 {
 	// PA5: Implement
-	for (auto pred = pred_begin(phi->getParent()); pred != pred_end(phi->getParent()); pred++)
-	{
-		Value* val = readVariable(var, *pred);
-		phi->addIncoming(val, *pred);
-	}
-	return tryRemoveTrivialPhi(phi);
+	pushPhiFrame(phi, getBlockIdx(phi->getParent()));
+	finishReads(var, getVarIdx(var), nullptr);
 }
 
-// Removes trivial phi nodes
-Value* SSABuilder::tryRemoveTrivialPhi(llvm::PHINode* phi)
+// Removes phi if it's trivial, along with any phi users that become
+// trivial as a result
+void SSABuilder::tryRemoveTrivialPhi(llvm::PHINode* phi)
 {
-	Value* same = nullptr;
-	
 	// PA5: Implement
-	for (int i = 0; i < phi->getNumIncomingValues(); i++) {
-		Value *op = phi->getIncomingValue(i);
-		if (op == same || op == phi) {
+	// Weak handles, since removing one phi may remove another
+	SmallVector<WeakVH, 8> worklist;
+	worklist.push_back(phi);
+	while (!worklist.empty())
+	{
+		phi = dyn_cast_or_null<PHINode>(static_cast<Value*>(worklist.pop_back_val()));
+		if (phi == nullptr || mPendingPhis.count(phi))
+		{
 			continue;
 		}
-		else if (same != nullptr) {
-			return phi;
+		
+		Value* same = nullptr;
+		bool trivial = true;
+		for (unsigned i = 0; i < phi->getNumIncomingValues(); i++)
+		{
+			Value* op = phi->getIncomingValue(i);
+			if (op == same || op == phi)
+			{
+				// Unique value or self-reference
+				continue;
+			}
+			else if (same != nullptr)
+			{
+				// The phi merges at least two values: not trivial
+				trivial = false;
+				break;
+			}
+			same = op;
 		}
-		same = op;
-	}
-	if (same == nullptr) {
-		same = UndefValue::get(phi->getType());
-	}
-
-	phi->replaceAllUsesWith(same);
-	for (auto& blocks : mVarDefs) {
-		for (auto& defines : *blocks.second) {
-			if (defines.second == phi) {
-				defines.second = same;
+		if (!trivial)
+		{
+			continue;
+		}
+		if (same == nullptr)
+		{
+			// The phi is unreachable or in the start block
+			same = UndefValue::get(phi->getType());
+		}
+		
+		// All users except the phi itself might become trivial
+		for (auto user = phi->user_begin(); user != phi->user_end(); user++)
+		{
+			if (PHINode* userPhi = dyn_cast<PHINode>(*user))
+			{
+				if (userPhi != phi)
+				{
+					worklist.push_back(userPhi);
+				}
+			}
+		}
+		
+		// Reroute all uses of phi to same, including the definitions
+		// that refer to it
+		phi->replaceAllUsesWith(same);
+		auto uses = mPhiUses.find(phi);
+		if (uses != mPhiUses.end())
+		{
+			SmallVector<DefKey, 4> keys(uses->second.begin(), uses->second.end());
+			mPhiUses.erase(uses);
+			for (auto& key : keys)
+			{
+				auto def = mVarDefs.find(key);
+				if (def != mVarDefs.end() && def->second == phi)
+				{
+					setDef(key, same);
+				}
 			}
 		}
+		phi->eraseFromParent();
 	}
-	phi->eraseFromParent();
+}
 
-	for (auto user = phi->user_begin(); user != phi->user_end(); user++) {
-		if (PHINode *phi = dyn_cast_or_null<PHINode>(*user)) {
-			tryRemoveTrivialPhi(phi);
-		}
+// Returns the dense index of the block (assigned by addBlock)
+unsigned SSABuilder::getBlockIdx(BasicBlock* block) const
+{
+	auto iter = mBlockIdx.find(block);
+	assert(iter != mBlockIdx.end() && "Block was never added to the SSABuilder");
+	return iter->second;
+}
+
+// Returns the dense index of the variable, assigning one on first use
+unsigned SSABuilder::getVarIdx(Identifier* var)
+{
+	auto result = mVarIdx.insert(std::make_pair(var, static_cast<unsigned>(mVarIdx.size())));
+	return result.first->second;
+}
+
+// Records a definition, and if it's a phi, remembers that this
+// entry refers to it
+void SSABuilder::setDef(DefKey key, Value* value)
+{
+	mVarDefs[key] = value;
+	if (PHINode* phi = dyn_cast<PHINode>(value))
+	{
+		mPhiUses[phi].push_back(key);
 	}
-	
-	return same;
 }
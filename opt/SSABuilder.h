@@ -14,8 +14,15 @@
 //---------------------------------------------------------
 
 #pragma once
-#include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#pragma clang diagnostic pop
 
 // LLVM forward-declarations
 namespace llvm
@@ -49,7 +56,7 @@ public:
 	void writeVariable(parse::Identifier* var, llvm::BasicBlock* block, llvm::Value* value);
 	
 	// Read the value assigned to the variable in the requested basic block
-	// Will recursively search predecessor blocks if it was not written in this block
+	// Will search predecessor blocks if it was not written in this block
 	llvm::Value* readVariable(parse::Identifier* var, llvm::BasicBlock* block);
 	
 	// This is called to add a new block to the maps
@@ -62,26 +69,80 @@ public:
 private:
 	// Helper functions
 	
-	// Recursively search predecessor blocks for a variable
-	llvm::Value* readVariableRecursive(parse::Identifier* var, llvm::BasicBlock* block);
+	// One block whose value of the variable is still being read.
+	// Lookups keep these on an explicit stack rather than recursing,
+	// so long chains of blocks can't overflow the native stack.
+	struct ReadFrame
+	{
+		unsigned mBlockIdx;
+		// Phi whose operands are being read, or nullptr if the block
+		// has a single predecessor
+		llvm::PHINode* mPhi;
+		// Number of predecessors (on top of the pred stack) left to read
+		unsigned mPredsLeft;
+	};
+	
+	// Starts reading the variable in a block. Returns the value if it's known
+	// right away, otherwise pushes the frames needed and returns nullptr
+	llvm::Value* beginRead(parse::Identifier* var, unsigned varIdx, unsigned blockIdx);
+	
+	// Pushes a frame that reads the operands of phi from every predecessor
+	void pushPhiFrame(llvm::PHINode* phi, unsigned blockIdx);
+	
+	// Finishes all the frames, memoizing the value in every block visited.
+	// result is the value of the read that just finished (if any).
+	llvm::Value* finishReads(parse::Identifier* var, unsigned varIdx, llvm::Value* result);
 	
 	// Adds phi operands based on predecessors of the containing block
-	llvm::Value* addPhiOperands(parse::Identifier* var, llvm::PHINode* phi);
+	void addPhiOperands(parse::Identifier* var, llvm::PHINode* phi);
+	
+	// Removes phi if it's trivial, along with any phi users that become
+	// trivial as a result
+	void tryRemoveTrivialPhi(llvm::PHINode* phi);
+	
+	// Returns the dense index of the block (assigned by addBlock)
+	unsigned getBlockIdx(llvm::BasicBlock* block) const;
+	
+	// Returns the dense index of the variable, assigning one on first use
+	unsigned getVarIdx(parse::Identifier* var);
+	
+	// Key of the definition of a variable in a block: (block index, var index)
+	typedef std::pair<unsigned, unsigned> DefKey;
+	
+	// Records a definition, and if it's a phi, remembers that this
+	// entry refers to it
+	void setDef(DefKey key, llvm::Value* value);
+	
+	struct BlockInfo
+	{
+		llvm::BasicBlock* mBlock;
+		bool mSealed;
+		// Any incomplete PHI nodes (only while the block isn't sealed)
+		std::vector<std::pair<parse::Identifier*, llvm::PHINode*>> mIncompletePhis;
+	};
+	
+	// Blocks of the current function, indexed by block index
+	std::vector<BlockInfo> mBlocks;
+	llvm::DenseMap<llvm::BasicBlock*, unsigned> mBlockIdx;
 	
-	// Removes trivial phi nodes
-	llvm::Value* tryRemoveTrivialPhi(llvm::PHINode* phi);
+	// Dense index of every variable seen in the current function
+	llvm::DenseMap<parse::Identifier*, unsigned> mVarIdx;
 	
-	typedef std::unordered_map<parse::Identifier*, llvm::Value*> SubMap;
-	typedef std::unordered_map<parse::Identifier*, llvm::PHINode*> SubPHI;
+	// This stores the variable definitions for every block in one flat table
+	llvm::DenseMap<DefKey, llvm::Value*> mVarDefs;
 	
-	// This stores the variable definitions for a particular basic block
-	std::unordered_map<llvm::BasicBlock*, SubMap*> mVarDefs;
+	// Reverse use list: for each phi, the mVarDefs entries that refer to it,
+	// so replacing a trivial phi only touches those entries
+	llvm::DenseMap<llvm::PHINode*, llvm::SmallVector<DefKey, 4>> mPhiUses;
 	
-	// This stores any incomplete PHI nodes
-	std::unordered_map<llvm::BasicBlock*, SubPHI*> mIncompletePhis;
+	// Phis whose operands are still being read, which must not be
+	// removed until they're complete
+	llvm::SmallPtrSet<llvm::PHINode*, 16> mPendingPhis;
 	
-	// Set of all the sealed blocks in the current function
-	std::unordered_set<llvm::BasicBlock*> mSealedBlocks;
+	// Explicit stack used by reads, and the predecessors its phi
+	// frames still have to read (kept around to avoid reallocating)
+	std::vector<ReadFrame> mFrames;
+	std::vector<llvm::BasicBlock*> mPreds;
 };
 	
 } // opt
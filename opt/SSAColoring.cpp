@@ -0,0 +1,223 @@
+//
+//  SSAColoring.cpp
+//  uscc
+//
+//  Implements the SSA mode of the register allocator. Since
+//  the IR is strict SSA, its interference graphs are chordal:
+//  once no more than K values are live at any point, coloring
+//  the definitions in dominance order needs at most K colors,
+//  so there's no graph to build.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "RegAlloc.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/CodeGen/LiveInterval.h>
+#include <llvm/CodeGen/MachineDominators.h>
+#include <llvm/CodeGen/MachineInstr.h>
+#include <llvm/Target/TargetRegisterInfo.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <deque>
+
+using namespace llvm;
+
+namespace uscc
+{
+namespace opt
+{
+
+void RegAlloc::colorSSA()
+{
+	reducePressure();
+
+	// Definitions in dominator tree preorder. Each value's definition
+	// dominates its uses, so everything it interferes with that's
+	// colored before it is live at its definition.
+	std::vector<bool> queued(mRegInfo->getNumVirtRegs(), false);
+	std::deque<unsigned> worklist;
+	MachineDominatorTree& domTree = getAnalysis<MachineDominatorTree>();
+	MachineDomTreeNode* root = domTree.getRootNode();
+	for (auto iter = df_begin(root), end = df_end(root); iter != end; ++iter)
+	{
+		for (MachineInstr& instr : *iter->getBlock())
+		{
+			for (const MachineOperand& operand : instr.operands())
+			{
+				if (!operand.isReg() || !operand.isDef() ||
+					!TargetRegisterInfo::isVirtualRegister(operand.getReg()))
+				{
+					continue;
+				}
+
+				unsigned index = TargetRegisterInfo::virtReg2Index(operand.getReg());
+				if (!queued[index])
+				{
+					queued[index] = true;
+					worklist.push_back(operand.getReg());
+				}
+			}
+		}
+	}
+
+	// Values that are never defined (undef) go last
+	std::vector<LiveInterval*> intervals;
+	collectIntervals(intervals);
+	for (LiveInterval* interval : intervals)
+	{
+		if (!queued[TargetRegisterInfo::virtReg2Index(interval->reg)])
+		{
+			worklist.push_back(interval->reg);
+		}
+	}
+
+	// Copies from phi elimination and the fixed registers of calls
+	// mean a color isn't always free, so this can still spill
+	SmallVector<unsigned, 4> retry;
+	while (!worklist.empty())
+	{
+		unsigned reg = worklist.front();
+		worklist.pop_front();
+
+		retry.clear();
+		allocate(reg, retry);
+		worklist.insert(worklist.end(), retry.begin(), retry.end());
+	}
+
+	// Drops the intervals spilling left without uses
+	intervals.clear();
+	collectIntervals(intervals);
+}
+
+void RegAlloc::reducePressure()
+{
+	std::vector<LiveInterval*> intervals;
+	collectIntervals(intervals);
+
+	// Where each interval is used, in order
+	std::vector<std::vector<SlotIndex>> uses(intervals.size());
+	for (unsigned i = 0; i < intervals.size(); i++)
+	{
+		for (MachineInstr& instr : mRegInfo->use_nodbg_instructions(intervals[i]->reg))
+		{
+			uses[i].push_back(mLIS->getInstructionIndex(&instr));
+		}
+		std::sort(uses[i].begin(), uses[i].end());
+	}
+
+	// Every segment starts and ends an interval being live. At the
+	// same index, the segments that end go first, since they're
+	// half-open.
+	struct Event
+	{
+		SlotIndex mIndex;
+		bool mStart;
+		unsigned mNode;
+
+		bool operator<(const Event& other) const
+		{
+			if (mIndex != other.mIndex)
+			{
+				return mIndex < other.mIndex;
+			}
+			return mStart < other.mStart;
+		}
+	};
+	std::vector<Event> events;
+	for (unsigned i = 0; i < intervals.size(); i++)
+	{
+		for (const LiveRange::Segment& segment : *intervals[i])
+		{
+			events.push_back(Event{segment.start, true, i});
+			events.push_back(Event{segment.end, false, i});
+		}
+	}
+	std::sort(events.begin(), events.end());
+
+	// Sweep through the function, and whenever more than K values are
+	// live, spill the one that's used furthest in the future (Belady)
+	std::vector<bool> spilled(intervals.size(), false);
+	std::vector<unsigned> live;
+	for (const Event& event : events)
+	{
+		if (spilled[event.mNode])
+		{
+			continue;
+		}
+
+		if (!event.mStart)
+		{
+			auto iter = std::find(live.begin(), live.end(), event.mNode);
+			if (iter != live.end())
+			{
+				live.erase(iter);
+			}
+			continue;
+		}
+
+		live.push_back(event.mNode);
+		while (live.size() > sNumColors)
+		{
+			// Intervals with no uses later in the function are only
+			// used again around a loop, so they count as furthest, and
+			// the cheapest of them is spilled
+			unsigned furthest = ~0u;
+			SlotIndex furthestUse;
+			unsigned noLaterUse = ~0u;
+			for (unsigned node : live)
+			{
+				if (!intervals[node]->isSpillable())
+				{
+					continue;
+				}
+
+				auto next = std::lower_bound(uses[node].begin(), uses[node].end(),
+											 event.mIndex);
+				if (next == uses[node].end())
+				{
+					if (noLaterUse == ~0u ||
+						intervals[node]->weight < intervals[noLaterUse]->weight)
+					{
+						noLaterUse = node;
+					}
+				}
+				else if (furthest == ~0u || furthestUse < *next)
+				{
+					furthest = node;
+					furthestUse = *next;
+				}
+			}
+
+			if (noLaterUse != ~0u)
+			{
+				furthest = noLaterUse;
+			}
+			if (furthest == ~0u)
+			{
+				break;
+			}
+			spilled[furthest] = true;
+			live.erase(std::find(live.begin(), live.end(), furthest));
+		}
+	}
+
+	// Nothing has a color yet, so spilling can't disturb anything
+	SmallVector<unsigned, 4> newRegs;
+	for (unsigned i = 0; i < intervals.size(); i++)
+	{
+		if (spilled[i])
+		{
+			spill(*intervals[i], newRegs);
+		}
+	}
+}
+
+} // opt
+} // uscc
@@ -0,0 +1,622 @@
+//
+//  ScalarRepl.cpp
+//  uscc
+//
+//  Implements scalar replacement of local arrays --
+//  A small local array that's only accessed at constant indices
+//  (and never passed to a call) is split into its elements, and
+//  each element is kept in SSA values instead of memory. Loops
+//  that index one of these arrays by their counter are fully
+//  unrolled first if they only run a few times, so the indices
+//  in each copy of the body are constants.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#include <llvm/Transforms/Utils/Local.h>
+#include <llvm/Transforms/Utils/SSAUpdater.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// Arrays with more elements than this stay in memory
+const uint64_t MaxElements = 16;
+// A loop is only unrolled if it runs at most this many times, and
+// all the copies of the loops unrolled in a function add up to at
+// most this many instructions
+const int64_t MaxUnrollTrips = 16;
+const unsigned MaxUnrolledSize = 256;
+
+// The loads and stores of a local array
+struct ArrayAccesses
+{
+	// Each load/store at a constant index, and that index
+	std::vector<std::pair<Instruction*, uint64_t>> mElements;
+	// The addresses whose index isn't a constant
+	std::vector<GetElementPtrInst*> mVariable;
+};
+
+// The inliner marks where an inlined function's arrays are live,
+// which doesn't matter once they aren't in memory
+bool onlyLifetimeMarkers(BitCastInst* bitCast)
+{
+	for (User* user : bitCast->users())
+	{
+		IntrinsicInst* intrinsic = dyn_cast<IntrinsicInst>(user);
+		if (intrinsic == nullptr ||
+			(intrinsic->getIntrinsicID() != Intrinsic::lifetime_start &&
+			 intrinsic->getIntrinsicID() != Intrinsic::lifetime_end))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Finds the accesses through ptr, which is offset elements into
+// array (if known is set). Returns false if the array escapes, or
+// is accessed in a way that can't be split into its elements.
+bool collectAccesses(AllocaInst* array, Value* ptr, int64_t offset, bool known,
+					 ArrayAccesses& accesses)
+{
+	ArrayType* type = cast<ArrayType>(array->getAllocatedType());
+	Type* elementType = type->getElementType();
+	for (User* user : ptr->users())
+	{
+		Instruction* instr = cast<Instruction>(user);
+		if (LoadInst* load = dyn_cast<LoadInst>(instr))
+		{
+			if (load->isVolatile() || load->getType() != elementType)
+			{
+				return false;
+			}
+		}
+		else if (StoreInst* store = dyn_cast<StoreInst>(instr))
+		{
+			// Storing the address itself means it escapes
+			if (store->isVolatile() || store->getPointerOperand() != ptr ||
+				store->getValueOperand()->getType() != elementType)
+			{
+				return false;
+			}
+		}
+		else if (GetElementPtrInst* gep = dyn_cast<GetElementPtrInst>(instr))
+		{
+			// The emitter gets array[0] from the array (which is the
+			// address every access starts from), then indexes that
+			Value* index = nullptr;
+			if (ptr == array)
+			{
+				ConstantInt* first = dyn_cast<ConstantInt>(gep->getOperand(1));
+				if (gep->getNumIndices() != 2 || first == nullptr || !first->isZero())
+				{
+					return false;
+				}
+				index = gep->getOperand(2);
+			}
+			else if (gep->getNumIndices() == 1)
+			{
+				index = gep->getOperand(1);
+			}
+			else
+			{
+				return false;
+			}
+
+			ConstantInt* constant = dyn_cast<ConstantInt>(index);
+			if (constant == nullptr)
+			{
+				accesses.mVariable.push_back(gep);
+				if (!collectAccesses(array, gep, 0, false, accesses))
+				{
+					return false;
+				}
+			}
+			else if (!collectAccesses(array, gep, offset + constant->getSExtValue(),
+									  known, accesses))
+			{
+				return false;
+			}
+			continue;
+		}
+		else if (BitCastInst* bitCast = dyn_cast<BitCastInst>(instr))
+		{
+			if (!onlyLifetimeMarkers(bitCast))
+			{
+				return false;
+			}
+			continue;
+		}
+		else
+		{
+			// Calls (including memcpy), phis, selects...
+			return false;
+		}
+
+		if (known)
+		{
+			if (offset < 0 || static_cast<uint64_t>(offset) >= type->getNumElements())
+			{
+				return false;
+			}
+			accesses.mElements.push_back(std::make_pair(instr, static_cast<uint64_t>(offset)));
+		}
+	}
+
+	return true;
+}
+
+// Returns how many times the body of L runs, or -1 if that isn't a
+// small constant. L has to be a while loop where only the header
+// tests whether to leave, by comparing a counter to a constant
+// (either counter < 10 or 10 > counter).
+int64_t getTripCount(Loop* L)
+{
+	BasicBlock* header = L->getHeader();
+	BasicBlock* preheader = L->getLoopPreheader();
+	BasicBlock* latch = L->getLoopLatch();
+	if (!L->getSubLoops().empty() || preheader == nullptr || latch == nullptr ||
+		latch == header || L->getExitingBlock() != header || L->getExitBlock() == nullptr)
+	{
+		return -1;
+	}
+
+	BranchInst* br = dyn_cast<BranchInst>(header->getTerminator());
+	if (br == nullptr || !br->isConditional())
+	{
+		return -1;
+	}
+	ICmpInst* cmp = dyn_cast<ICmpInst>(br->getCondition());
+	if (cmp == nullptr)
+	{
+		return -1;
+	}
+
+	// If the counter is on the right, the operands are swapped
+	// (along with the predicate), so it's always on the left
+	CmpInst::Predicate pred = cmp->getPredicate();
+	Value* lhs = cmp->getOperand(0);
+	Value* rhs = cmp->getOperand(1);
+	if (isa<ConstantInt>(lhs))
+	{
+		std::swap(lhs, rhs);
+		pred = cmp->getSwappedPredicate();
+	}
+	PHINode* counter = dyn_cast<PHINode>(lhs);
+	ConstantInt* bound = dyn_cast<ConstantInt>(rhs);
+	if (counter == nullptr || counter->getParent() != header || bound == nullptr)
+	{
+		return -1;
+	}
+
+	Constant* value = dyn_cast<ConstantInt>(counter->getIncomingValueForBlock(preheader));
+	BinaryOperator* next = dyn_cast<BinaryOperator>(counter->getIncomingValueForBlock(latch));
+	if (value == nullptr || next == nullptr || next->getOperand(0) != counter ||
+		!isa<ConstantInt>(next->getOperand(1)) ||
+		(next->getOpcode() != Instruction::Add && next->getOpcode() != Instruction::Sub))
+	{
+		return -1;
+	}
+	Constant* step = cast<ConstantInt>(next->getOperand(1));
+
+	// Runs the counter until the compare leaves the loop
+	bool stayOnTrue = L->contains(br->getSuccessor(0));
+	for (int64_t trips = 0; trips <= MaxUnrollTrips; trips++)
+	{
+		Constant* result = ConstantExpr::getICmp(pred, value, bound);
+		if (result->isOneValue() != stayOnTrue)
+		{
+			return trips;
+		}
+		value = ConstantExpr::get(next->getOpcode(), value, step);
+	}
+
+	return -1;
+}
+
+// Returns true if value would be a constant in each copy of L's
+// body, if L were unrolled. That's true of the header phis that start
+// out as a constant (like the counter), and what's computed from them.
+bool isConstantWhenUnrolled(Value* value, Loop* L, std::set<PHINode*>& visiting)
+{
+	if (isa<Constant>(value))
+	{
+		return true;
+	}
+
+	Instruction* instr = dyn_cast<Instruction>(value);
+	if (instr == nullptr || !L->contains(instr))
+	{
+		return false;
+	}
+
+	if (PHINode* phi = dyn_cast<PHINode>(instr))
+	{
+		if (phi->getParent() != L->getHeader())
+		{
+			return false;
+		}
+		// A phi that's already being checked depends on itself,
+		// which is only a problem if something else isn't constant
+		if (!visiting.insert(phi).second)
+		{
+			return true;
+		}
+		return isConstantWhenUnrolled(phi->getIncomingValueForBlock(L->getLoopPreheader()),
+									  L, visiting) &&
+			isConstantWhenUnrolled(phi->getIncomingValueForBlock(L->getLoopLatch()),
+								   L, visiting);
+	}
+	else if (isa<BinaryOperator>(instr) || isa<CastInst>(instr) ||
+			 isa<CmpInst>(instr) || isa<SelectInst>(instr))
+	{
+		for (Value* operand : instr->operands())
+		{
+			if (!isConstantWhenUnrolled(operand, L, visiting))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+// Returns true if nothing after L uses a value computed in its body
+// (as opposed to the header, which is the last thing to run)
+bool onlyHeaderUsedOutside(Loop* L)
+{
+	for (BasicBlock* block : L->getBlocks())
+	{
+		if (block == L->getHeader())
+		{
+			continue;
+		}
+
+		for (Instruction& instr : *block)
+		{
+			for (User* user : instr.users())
+			{
+				if (!L->contains(cast<Instruction>(user)))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+// Replaces L with tripCount copies of its blocks, one after another.
+// The last copy is just the header, which goes to the exit.
+void unrollLoop(Loop* L, int64_t tripCount)
+{
+	BasicBlock* header = L->getHeader();
+	BasicBlock* preheader = L->getLoopPreheader();
+	BasicBlock* latch = L->getLoopLatch();
+	BasicBlock* exit = L->getExitBlock();
+	Function* func = header->getParent();
+	std::vector<BasicBlock*> blocks = L->getBlocks();
+	unsigned stayIdx = L->contains(header->getTerminator()->getSuccessor(0)) ? 0 : 1;
+
+	// The header phis of the first copy are their values from the
+	// preheader, and after that, the previous copy's values
+	std::vector<PHINode*> phis;
+	std::vector<Value*> phiValues;
+	for (BasicBlock::iterator iter = header->begin(); isa<PHINode>(iter); ++iter)
+	{
+		PHINode* phi = cast<PHINode>(iter);
+		phis.push_back(phi);
+		phiValues.push_back(phi->getIncomingValueForBlock(preheader));
+	}
+
+	std::vector<BasicBlock*> newBlocks;
+	std::vector<Value*> conds;
+	BasicBlock* prevHeader = nullptr;
+	BasicBlock* prevLatch = nullptr;
+	for (int64_t copy = 0; copy <= tripCount; copy++)
+	{
+		ValueToValueMapTy valueMap;
+		bool last = copy == tripCount;
+		std::vector<BasicBlock*> copies;
+		for (BasicBlock* block : blocks)
+		{
+			if (last && block != header)
+			{
+				continue;
+			}
+			BasicBlock* newBlock = CloneBasicBlock(block, valueMap, "." + std::to_string(copy), func);
+			newBlock->moveBefore(header);
+			valueMap[block] = newBlock;
+			copies.push_back(newBlock);
+		}
+		newBlocks.insert(newBlocks.end(), copies.begin(), copies.end());
+
+		BasicBlock* newHeader = cast<BasicBlock>(valueMap[header]);
+		for (unsigned i = 0; i < phis.size(); i++)
+		{
+			PHINode* newPhi = cast<PHINode>(valueMap[phis[i]]);
+			valueMap[phis[i]] = phiValues[i];
+			newPhi->eraseFromParent();
+		}
+		for (BasicBlock* newBlock : copies)
+		{
+			for (Instruction& instr : *newBlock)
+			{
+				RemapInstruction(&instr, valueMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
+			}
+		}
+
+		// Each copy of the header knows which way it goes
+		BranchInst* br = cast<BranchInst>(newHeader->getTerminator());
+		BasicBlock* target = br->getSuccessor(last ? 1 - stayIdx : stayIdx);
+		conds.push_back(br->getCondition());
+		BranchInst::Create(target, br);
+		br->eraseFromParent();
+
+		// Chain this copy after the previous one
+		if (prevLatch == nullptr)
+		{
+			preheader->getTerminator()->replaceUsesOfWith(header, newHeader);
+		}
+		else
+		{
+			prevLatch->getTerminator()->replaceUsesOfWith(prevHeader, newHeader);
+		}
+		prevHeader = newHeader;
+		if (!last)
+		{
+			prevLatch = cast<BasicBlock>(valueMap[latch]);
+			for (unsigned i = 0; i < phis.size(); i++)
+			{
+				Value* value = phis[i]->getIncomingValueForBlock(latch);
+				ValueToValueMapTy::iterator mapped = valueMap.find(value);
+				if (mapped != valueMap.end())
+				{
+					value = mapped->second;
+				}
+				phiValues[i] = value;
+			}
+			continue;
+		}
+
+		// Anything after the loop that used the header's values
+		// uses the values from the last copy of it instead
+		for (BasicBlock::iterator iter = exit->begin(); isa<PHINode>(iter); ++iter)
+		{
+			PHINode* phi = cast<PHINode>(iter);
+			int idx = phi->getBasicBlockIndex(header);
+			if (idx >= 0)
+			{
+				phi->setIncomingBlock(static_cast<unsigned>(idx), newHeader);
+			}
+		}
+		for (Instruction& instr : *header)
+		{
+			// (Except the branch, which was already replaced)
+			ValueToValueMapTy::iterator mapped = valueMap.find(&instr);
+			if (mapped != valueMap.end() && mapped->second != nullptr)
+			{
+				instr.replaceAllUsesWith(mapped->second);
+			}
+		}
+	}
+
+	for (BasicBlock* block : blocks)
+	{
+		block->dropAllReferences();
+	}
+	for (BasicBlock* block : blocks)
+	{
+		block->eraseFromParent();
+	}
+
+	// The compares are only deleted now, since the last one
+	// could've been the only use of a value after the loop uses
+	for (Value* cond : conds)
+	{
+		RecursivelyDeleteTriviallyDeadInstructions(cond);
+	}
+
+	// The counter (and whatever's computed from it) is a
+	// constant in each copy, so it can be folded now. The blocks
+	// of a copy aren't always in the order they run (an if/else
+	// can come before what it uses), so this folds until nothing
+	// changes rather than trusting one pass.
+	bool folded = true;
+	while (folded)
+	{
+		folded = false;
+		for (BasicBlock* block : newBlocks)
+		{
+			BasicBlock::iterator iter = block->begin();
+			while (iter != block->end())
+			{
+				Instruction* instr = &*iter;
+				++iter;
+				if (Constant* constant = ConstantFoldInstruction(instr))
+				{
+					instr->replaceAllUsesWith(constant);
+					instr->eraseFromParent();
+					folded = true;
+				}
+			}
+		}
+	}
+}
+
+// Erases ptr, and the addresses (and lifetime markers) computed from it
+void eraseAddresses(Instruction* ptr)
+{
+	while (!ptr->use_empty())
+	{
+		eraseAddresses(cast<Instruction>(*ptr->user_begin()));
+	}
+	ptr->eraseFromParent();
+}
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool ScalarRepl::runOnFunction(Function& F)
+{
+	LoopInfo& loopInfo = getAnalysis<LoopInfo>();
+
+	// Sized local arrays are all allocated in the entry block
+	std::vector<AllocaInst*> arrays;
+	for (Instruction& instr : F.getEntryBlock())
+	{
+		AllocaInst* alloca = dyn_cast<AllocaInst>(&instr);
+		if (alloca == nullptr)
+		{
+			continue;
+		}
+		ArrayType* type = dyn_cast<ArrayType>(alloca->getAllocatedType());
+		if (type != nullptr && type->getNumElements() <= MaxElements)
+		{
+			arrays.push_back(alloca);
+		}
+	}
+
+	// The loops that have to be unrolled for an array's
+	// indices to be constants, and their trip counts. What
+	// they add up to once unrolled is limited for the whole
+	// function, so lots of small loops can't blow it up.
+	std::vector<std::pair<Loop*, int64_t>> unroll;
+	unsigned unrolledSize = 0;
+	for (AllocaInst* array : arrays)
+	{
+		ArrayAccesses accesses;
+		if (!collectAccesses(array, array, 0, true, accesses))
+		{
+			continue;
+		}
+
+		std::vector<std::pair<Loop*, int64_t>> loops;
+		unsigned addedSize = 0;
+		bool canUnroll = true;
+		for (GetElementPtrInst* gep : accesses.mVariable)
+		{
+			Loop* loop = loopInfo.getLoopFor(gep->getParent());
+			int64_t tripCount = loop != nullptr ? getTripCount(loop) : -1;
+			if (tripCount < 0 || !onlyHeaderUsedOutside(loop))
+			{
+				canUnroll = false;
+				break;
+			}
+
+			unsigned size = 0;
+			for (BasicBlock* block : loop->getBlocks())
+			{
+				size += static_cast<unsigned>(block->size());
+			}
+			std::set<PHINode*> visiting;
+			Value* index = gep->getOperand(gep->getNumOperands() - 1);
+			if (!isConstantWhenUnrolled(index, loop, visiting))
+			{
+				canUnroll = false;
+				break;
+			}
+
+			// A loop another array (or another access to this one)
+			// already needs unrolled doesn't cost anything more
+			auto pair = std::make_pair(loop, tripCount);
+			if (std::find(unroll.begin(), unroll.end(), pair) == unroll.end() &&
+				std::find(loops.begin(), loops.end(), pair) == loops.end())
+			{
+				addedSize += size * static_cast<unsigned>(tripCount);
+				loops.push_back(pair);
+			}
+		}
+
+		if (canUnroll && unrolledSize + addedSize <= MaxUnrolledSize)
+		{
+			unroll.insert(unroll.end(), loops.begin(), loops.end());
+			unrolledSize += addedSize;
+		}
+	}
+
+	// Only innermost loops are unrolled, so none of
+	// them contain the blocks of another one
+	bool changed = false;
+	for (auto& loop : unroll)
+	{
+		unrollLoop(loop.first, loop.second);
+		changed = true;
+	}
+
+	for (AllocaInst* array : arrays)
+	{
+		ArrayAccesses accesses;
+		if (!collectAccesses(array, array, 0, true, accesses) || !accesses.mVariable.empty())
+		{
+			continue;
+		}
+
+		// Each element is promoted on its own, the same way
+		// LICM keeps an array element in a register. Loads
+		// before any store get undef.
+		std::map<uint64_t, SmallVector<Instruction*, 8>> elements;
+		for (auto& access : accesses.mElements)
+		{
+			elements[access.second].push_back(access.first);
+		}
+		for (auto& element : elements)
+		{
+			SmallVector<PHINode*, 8> newPhis;
+			SSAUpdater ssa(&newPhis);
+			std::string name = array->getName().str() + "." + std::to_string(element.first);
+			LoadAndStorePromoter promoter(element.second, ssa, name);
+			promoter.run(element.second);
+		}
+
+		// Only the addresses are left, and nothing uses them
+		eraseAddresses(array);
+		changed = true;
+	}
+
+	return changed;
+}
+
+void ScalarRepl::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// Unrolling changes the CFG, so no analysis is preserved
+	Info.addRequired<LoopInfo>();
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::ScalarRepl::ID = 0;
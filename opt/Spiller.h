@@ -0,0 +1,45 @@
+//
+//  Spiller.h
+//  uscc
+//
+//  Declares the interface of LLVM's spiller, which the register
+//  allocator uses to insert spill code. LLVM 3.5 keeps this
+//  header private to lib/CodeGen (so it isn't installed), but
+//  createInlineSpiller is exported by libLLVMCodeGen. This has
+//  to stay the same as lib/CodeGen/Spiller.h, since the classes
+//  are shared with the library.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#pragma once
+
+namespace llvm
+{
+
+class LiveRangeEdit;
+class MachineFunction;
+class MachineFunctionPass;
+class VirtRegMap;
+
+// Inserts spill (or rematerialization) code for an interval
+class Spiller
+{
+	virtual void anchor();
+public:
+	virtual ~Spiller() = 0;
+
+	// Spills the interval edit.getParent()
+	virtual void spill(LiveRangeEdit& edit) = 0;
+};
+
+// Returns a spiller that inserts the spill code directly
+Spiller* createInlineSpiller(MachineFunctionPass& pass,
+							 MachineFunction& mf,
+							 VirtRegMap& vrm);
+
+} // llvm
@@ -0,0 +1,326 @@
+//
+//  TailRecursion.cpp
+//  uscc
+//
+//  Implements tail recursion elimination --
+//  A function that ends by calling itself (and returning what
+//  the call returns) branches back to its start instead, with
+//  phis for the arguments. If it returns the call's result
+//  added to/multiplied by something (like n * f(n - 1)), that
+//  something goes into an accumulator which every other
+//  return applies to the value it returns.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/Analysis/ValueTracking.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// A self call in tail position
+struct TailCall
+{
+	TailCall()
+	: mCall(nullptr)
+	, mAccumulate(nullptr)
+	{ }
+
+	// Returns the value mCall's result is combined with
+	Value* getOther() const
+	{
+		return mAccumulate->getOperand(mAccumulate->getOperand(0) == mCall ? 1 : 0);
+	}
+
+	CallInst* mCall;
+	// If the function returns mCall's result combined with
+	// something else instead of the result itself
+	BinaryOperator* mAccumulate;
+};
+
+// Returns true if block returns right after its last non-terminator,
+// either with a ret or by branching to a block that only returns. The
+// blocks branched through on the way can have nothing but phis (like
+// the ends of nested if statements, since a return can't be inside
+// one). value is set to what's returned (nullptr for ret void).
+bool getReturnedValue(BasicBlock* block, Value*& value)
+{
+	std::vector<BasicBlock*> path;
+	path.push_back(block);
+	ReturnInst* ret = dyn_cast<ReturnInst>(block->getTerminator());
+	while (ret == nullptr)
+	{
+		BranchInst* br = dyn_cast<BranchInst>(path.back()->getTerminator());
+		if (br == nullptr || br->isConditional())
+		{
+			return false;
+		}
+
+		BasicBlock* next = br->getSuccessor(0);
+		if (std::find(path.begin(), path.end(), next) != path.end())
+		{
+			return false;
+		}
+		for (Instruction& instr : *next)
+		{
+			if (!isa<PHINode>(&instr) && &instr != next->getTerminator())
+			{
+				return false;
+			}
+		}
+		path.push_back(next);
+		ret = dyn_cast<ReturnInst>(next->getTerminator());
+	}
+
+	// Work back to what's returned when coming from block
+	value = ret->getReturnValue();
+	for (size_t i = path.size() - 1; i > 0; i--)
+	{
+		PHINode* phi = dyn_cast_or_null<PHINode>(value);
+		if (phi != nullptr && phi->getParent() == path[i])
+		{
+			value = phi->getIncomingValueForBlock(path[i - 1]);
+		}
+	}
+
+	return true;
+}
+
+bool isSelfCall(Instruction* instr, Function* func)
+{
+	CallInst* call = dyn_cast_or_null<CallInst>(instr);
+	return call != nullptr && call->getCalledFunction() == func;
+}
+
+// Finds the self call at the end of block, if it's in tail position
+bool findTailCall(BasicBlock* block, TailCall& tailCall)
+{
+	Function* func = block->getParent();
+	Value* value = nullptr;
+	if (!getReturnedValue(block, value))
+	{
+		return false;
+	}
+
+	Instruction* last = block->getTerminator()->getPrevNode();
+	if (isSelfCall(last, func))
+	{
+		// Either the call's result is returned (and not used by
+		// anything else), or it doesn't matter
+		tailCall.mCall = cast<CallInst>(last);
+		if (value != nullptr && (value != last || !last->hasOneUse()))
+		{
+			return false;
+		}
+		if (value == nullptr && !last->use_empty())
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// Only add and mul can be reassociated into an accumulator
+		BinaryOperator* binOp = dyn_cast_or_null<BinaryOperator>(last);
+		if (binOp == nullptr || binOp != value || !binOp->hasOneUse() ||
+			(binOp->getOpcode() != Instruction::Add &&
+			 binOp->getOpcode() != Instruction::Mul))
+		{
+			return false;
+		}
+
+		Instruction* prev = binOp->getPrevNode();
+		if (!isSelfCall(prev, func) || !prev->hasOneUse())
+		{
+			return false;
+		}
+		tailCall.mCall = cast<CallInst>(prev);
+		tailCall.mAccumulate = binOp;
+		if (tailCall.getOther() == prev)
+		{
+			return false;
+		}
+	}
+
+	// The function's locals are reused by the next iteration, so
+	// it can't be passed the address of one
+	for (unsigned i = 0; i < tailCall.mCall->getNumArgOperands(); i++)
+	{
+		Value* object = GetUnderlyingObject(tailCall.mCall->getArgOperand(i));
+		if (isa<AllocaInst>(object))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool TailRecursion::runOnFunction(Function& F)
+{
+	if (F.isVarArg())
+	{
+		return false;
+	}
+
+	std::vector<TailCall> tailCalls;
+	Instruction::BinaryOps accumulateOp = Instruction::Add;
+	bool hasAccumulator = false;
+	for (BasicBlock& block : F)
+	{
+		TailCall tailCall;
+		if (!findTailCall(&block, tailCall))
+		{
+			continue;
+		}
+
+		// There's only one accumulator, so every tail call
+		// has to combine its result the same way
+		if (tailCall.mAccumulate != nullptr)
+		{
+			if (hasAccumulator && tailCall.mAccumulate->getOpcode() != accumulateOp)
+			{
+				continue;
+			}
+			accumulateOp = tailCall.mAccumulate->getOpcode();
+			hasAccumulator = true;
+		}
+		tailCalls.push_back(tailCall);
+	}
+
+	if (tailCalls.empty())
+	{
+		return false;
+	}
+
+	// The old entry block becomes the loop header. The new entry
+	// block keeps the locals, so they're only allocated once.
+	BasicBlock* header = &F.getEntryBlock();
+	std::string entryName = header->getName().str();
+	header->setName("tailrecurse");
+	BasicBlock* entry = BasicBlock::Create(F.getContext(), entryName, &F, header);
+	BranchInst* entryBr = BranchInst::Create(header, entry);
+	BasicBlock::iterator iter = header->begin();
+	while (iter != header->end())
+	{
+		Instruction* instr = &*iter;
+		++iter;
+		if (isa<AllocaInst>(instr))
+		{
+			instr->moveBefore(entryBr);
+		}
+	}
+
+	// Each argument is now whatever the last tail call passed
+	std::vector<PHINode*> argPhis;
+	Instruction* insertPt = &header->front();
+	for (Argument& arg : F.getArgumentList())
+	{
+		PHINode* phi = PHINode::Create(arg.getType(), 2, arg.getName() + ".tr", insertPt);
+		arg.replaceAllUsesWith(phi);
+		phi->addIncoming(&arg, entry);
+		argPhis.push_back(phi);
+	}
+
+	// Starts out as the identity, so the first return isn't changed
+	PHINode* accumulator = nullptr;
+	if (hasAccumulator)
+	{
+		Type* type = F.getReturnType();
+		accumulator = PHINode::Create(type, 2, "accumulator.tr", insertPt);
+		Constant* identity = ConstantInt::get(type, accumulateOp == Instruction::Mul ? 1 : 0);
+		accumulator->addIncoming(identity, entry);
+	}
+
+	for (TailCall& tailCall : tailCalls)
+	{
+		CallInst* call = tailCall.mCall;
+		BasicBlock* block = call->getParent();
+		for (unsigned i = 0; i < argPhis.size(); i++)
+		{
+			argPhis[i]->addIncoming(call->getArgOperand(i), block);
+		}
+
+		TerminatorInst* term = block->getTerminator();
+		if (accumulator != nullptr)
+		{
+			Value* next = accumulator;
+			if (tailCall.mAccumulate != nullptr)
+			{
+				next = BinaryOperator::Create(accumulateOp, accumulator, tailCall.getOther(),
+											  "accumulate.tr", term);
+			}
+			accumulator->addIncoming(next, block);
+		}
+
+		// Branch back to the start instead of returning
+		if (BranchInst* br = dyn_cast<BranchInst>(term))
+		{
+			br->getSuccessor(0)->removePredecessor(block);
+		}
+		BranchInst::Create(header, term);
+		term->eraseFromParent();
+
+		// If another tail call branched to the same return block, its
+		// phi could have been replaced by this call, which is only
+		// still used if that block can't be reached anymore
+		if (tailCall.mAccumulate != nullptr)
+		{
+			tailCall.mAccumulate->replaceAllUsesWith(UndefValue::get(call->getType()));
+			tailCall.mAccumulate->eraseFromParent();
+		}
+		call->replaceAllUsesWith(UndefValue::get(call->getType()));
+		call->eraseFromParent();
+	}
+
+	// The other returns are the innermost call returning,
+	// so they apply everything accumulated on the way in
+	if (accumulator != nullptr)
+	{
+		for (BasicBlock& block : F)
+		{
+			ReturnInst* ret = dyn_cast<ReturnInst>(block.getTerminator());
+			if (ret != nullptr)
+			{
+				Instruction* value = BinaryOperator::Create(accumulateOp, accumulator,
+															ret->getReturnValue(),
+															"accumulated.tr", ret);
+				ret->setOperand(0, value);
+			}
+		}
+	}
+
+	return true;
+}
+
+void TailRecursion::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// This adds a loop to the CFG, so no analysis is preserved
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::TailRecursion::ID = 0;
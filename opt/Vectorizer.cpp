@@ -0,0 +1,945 @@
+//
+//  Vectorizer.cpp
+//  uscc
+//
+//  Implements the loop vectorizer --
+//  A counted loop over int/char arrays (a body block that runs
+//  while i < n, with i going up by one) gets a copy in front of
+//  it that works on 16 bytes of each array per iteration, with
+//  <4 x i32> and <16 x i8> operations. Sums and products are
+//  kept in a vector, one per lane, and added/multiplied together
+//  after the vector loop. The original loop is left to run the
+//  iterations that don't fill a whole vector.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+#include "Passes.h"
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ValueTracking.h>
+#pragma clang diagnostic pop
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+
+// The size of a vector register
+const unsigned VectorBytes = 16;
+
+// Returns lhs + rhs, or just lhs if rhs is 0 (or the other way around)
+Value* createAdd(IRBuilder<>& build, Value* lhs, Value* rhs, const Twine& name = "")
+{
+	ConstantInt* constant = dyn_cast<ConstantInt>(rhs);
+	if (constant != nullptr && constant->isZero())
+	{
+		return lhs;
+	}
+	constant = dyn_cast<ConstantInt>(lhs);
+	if (constant != nullptr && constant->isZero())
+	{
+		return rhs;
+	}
+	return build.CreateAdd(lhs, rhs, name);
+}
+
+// Returns true if nothing but object itself can point into it
+bool isIdentifiedObject(Value* object)
+{
+	return isa<AllocaInst>(object) || isa<GlobalVariable>(object);
+}
+
+class LoopVectorizer
+{
+public:
+	LoopVectorizer(Loop* loop)
+	: mLoop(loop)
+	, mBuild(loop->getHeader()->getContext())
+	, mWidth(0)
+	{ }
+
+	// Returns true if the loop is one that can be vectorized
+	bool canVectorize();
+
+	// Adds the vector loop in front of the loop
+	void vectorize();
+private:
+	// An add/sub or mul of every iteration's values
+	struct Reduction
+	{
+		PHINode* mPhi;
+		Instruction::BinaryOps mOp;
+		PHINode* mVectorPhi;
+		// The vector for the next iteration
+		Value* mVectorNext;
+	};
+
+	// An array element accessed in each iteration,
+	// which is base[i + offset]
+	struct ArrayAccess
+	{
+		GetElementPtrInst* mAddress;
+		Value* mBase;
+		int64_t mOffset;
+		bool mIsStore;
+	};
+
+	// Finds the counter, and the value it goes up to
+	bool analyzeCondition();
+
+	// Returns true if phi is the result of a reduction
+	bool analyzeReduction(PHINode* phi);
+
+	// Returns true if every instruction in the body can be widened
+	bool analyzeBody();
+
+	// Returns true if gep is a consecutive array element
+	bool analyzeAccess(GetElementPtrInst* gep);
+
+	// Returns true if the vector loop can access the arrays in a
+	// different order than the loop, given the overlap checks in
+	// mChecks (if two arrays might be the same array)
+	bool analyzeDependences();
+
+	// Sets offset to what's added to the counter in index
+	bool getOffset(Value* index, int64_t& offset);
+
+	// Returns true if address is one of the accesses in mAccesses
+	bool isAccess(Value* address);
+
+	// Returns the access through address
+	ArrayAccess& getAccess(Value* address);
+
+	// Returns the vector of value in each lane
+	Value* widen(Value* value);
+
+	// If value is only used as a narrower type, returns true if
+	// it can be computed in that type, then computes it
+	bool canNarrow(Value* value, Type* type);
+	Value* narrow(Value* value, Type* type);
+
+	// Returns the address of the vector of access's elements
+	Value* getVectorAddress(const ArrayAccess& access);
+
+	// Combines the lanes of vector with op
+	Value* reduce(IRBuilder<>& build, Value* vector, Instruction::BinaryOps op);
+
+	// Returns the condition that the arrays in mChecks don't overlap
+	Value* emitOverlapChecks(IRBuilder<>& build);
+
+	// Returns the first element of base that's accessed,
+	// and the one after the last element that's accessed
+	std::pair<Value*, Value*> emitBounds(IRBuilder<>& build, Value* base);
+
+	Loop* mLoop;
+	BasicBlock* mPreheader;
+	BasicBlock* mHeader;
+	BasicBlock* mBody;
+	BasicBlock* mVectorPreheader;
+
+	// The loop runs while mCounter < mEnd
+	PHINode* mCounter;
+	Value* mStart;
+	Value* mEnd;
+
+	std::vector<Reduction> mReductions;
+	std::vector<ArrayAccess> mAccesses;
+	// Pairs of arrays that can only be accessed in a different
+	// order if they don't overlap
+	std::vector<std::pair<Value*, Value*>> mChecks;
+
+	// Builds the vector loop
+	IRBuilder<> mBuild;
+	// The counter for the first lane in this iteration
+	Value* mLaneCounter;
+	// The values of each lane for each value in the loop
+	std::map<Value*, Value*> mWidened;
+	std::map<std::pair<Value*, Type*>, Value*> mNarrowed;
+	// The vector address for each element address
+	std::map<Value*, Value*> mAddresses;
+
+	// Number of lanes in the vectors
+	unsigned mWidth;
+};
+
+bool LoopVectorizer::canVectorize()
+{
+	// The vector loop is one block, like the loop's body
+	mPreheader = mLoop->getLoopPreheader();
+	mHeader = mLoop->getHeader();
+	mBody = mLoop->getLoopLatch();
+	if (!mLoop->getSubLoops().empty() || mLoop->getNumBlocks() != 2 ||
+		mPreheader == nullptr || mBody == nullptr || mBody == mHeader)
+	{
+		return false;
+	}
+
+	BranchInst* bodyBr = dyn_cast<BranchInst>(mBody->getTerminator());
+	if (bodyBr == nullptr || bodyBr->isConditional() ||
+		mBody->getSinglePredecessor() != mHeader)
+	{
+		return false;
+	}
+
+	if (!analyzeCondition())
+	{
+		return false;
+	}
+
+	// Every other phi has to be a sum (or product) of the iterations
+	for (BasicBlock::iterator iter = mHeader->begin(); isa<PHINode>(iter); ++iter)
+	{
+		PHINode* phi = cast<PHINode>(iter);
+		if (phi != mCounter && !analyzeReduction(phi))
+		{
+			return false;
+		}
+	}
+
+	if (!analyzeBody() || mAccesses.empty() || !analyzeDependences())
+	{
+		return false;
+	}
+
+	// As many lanes as the smallest element fits in a register
+	unsigned smallest = VectorBytes;
+	for (ArrayAccess& access : mAccesses)
+	{
+		Type* type = access.mAddress->getType()->getPointerElementType();
+		smallest = std::min(smallest, type->getScalarSizeInBits() / 8);
+	}
+	mWidth = VectorBytes / smallest;
+	return true;
+}
+
+bool LoopVectorizer::analyzeCondition()
+{
+	// The header only decides whether to run the body
+	BranchInst* br = dyn_cast<BranchInst>(mHeader->getTerminator());
+	if (br == nullptr || br->isUnconditional() || br->getSuccessor(0) != mBody)
+	{
+		return false;
+	}
+	ICmpInst* cmp = dyn_cast<ICmpInst>(br->getCondition());
+	if (cmp == nullptr || cmp->getParent() != mHeader || !cmp->hasOneUse() ||
+		&*mHeader->getFirstNonPHI() != cmp || cmp->getNextNode() != br)
+	{
+		return false;
+	}
+
+	// i < n or i != n, in either order
+	Value* lhs = cmp->getOperand(0);
+	Value* rhs = cmp->getOperand(1);
+	CmpInst::Predicate pred = cmp->getPredicate();
+	if (!isa<PHINode>(lhs) || cast<PHINode>(lhs)->getParent() != mHeader)
+	{
+		std::swap(lhs, rhs);
+		pred = cmp->getSwappedPredicate();
+	}
+	PHINode* counter = dyn_cast<PHINode>(lhs);
+	if (counter == nullptr || counter->getParent() != mHeader ||
+		!mLoop->isLoopInvariant(rhs) ||
+		(pred != CmpInst::ICMP_SLT && pred != CmpInst::ICMP_NE))
+	{
+		return false;
+	}
+
+	// It has to go up by one
+	BinaryOperator* next = dyn_cast<BinaryOperator>(counter->getIncomingValueForBlock(mBody));
+	if (next == nullptr || next->getOpcode() != Instruction::Add)
+	{
+		return false;
+	}
+	bool counterFirst = next->getOperand(0) == counter;
+	ConstantInt* step = dyn_cast<ConstantInt>(next->getOperand(counterFirst ? 1 : 0));
+	if (step == nullptr || !step->isOne() ||
+		next->getOperand(counterFirst ? 0 : 1) != counter)
+	{
+		return false;
+	}
+
+	mCounter = counter;
+	mStart = counter->getIncomingValueForBlock(mPreheader);
+	mEnd = rhs;
+	return true;
+}
+
+bool LoopVectorizer::analyzeReduction(PHINode* phi)
+{
+	if (!phi->getType()->isIntegerTy())
+	{
+		return false;
+	}
+
+	// Follows the chain of operations from phi to the value for the next
+	// iteration. Nothing else in the loop can use them, since a lane
+	// only has part of the result.
+	Value* latchValue = phi->getIncomingValueForBlock(mBody);
+	Instruction::BinaryOps op = Instruction::BinaryOpsEnd;
+	Instruction* link = phi;
+	while (link != latchValue)
+	{
+		Instruction* user = nullptr;
+		for (User* linkUser : link->users())
+		{
+			Instruction* instr = cast<Instruction>(linkUser);
+			if (!mLoop->contains(instr))
+			{
+				continue;
+			}
+			else if (user != nullptr)
+			{
+				return false;
+			}
+			user = instr;
+		}
+
+		// Subtracting is adding the negative, but only if
+		// it's the value being subtracted from
+		BinaryOperator* binOp = dyn_cast_or_null<BinaryOperator>(user);
+		if (binOp == nullptr || binOp->getParent() != mBody ||
+			binOp->getOperand(0) == binOp->getOperand(1) ||
+			(binOp->getOpcode() == Instruction::Sub && binOp->getOperand(0) != link))
+		{
+			return false;
+		}
+
+		Instruction::BinaryOps linkOp = binOp->getOpcode();
+		if (linkOp == Instruction::Sub)
+		{
+			linkOp = Instruction::Add;
+		}
+		if ((linkOp != Instruction::Add && linkOp != Instruction::Mul) ||
+			(op != Instruction::BinaryOpsEnd && op != linkOp))
+		{
+			return false;
+		}
+		op = linkOp;
+		link = binOp;
+	}
+
+	if (link == phi || !link->hasOneUse())
+	{
+		return false;
+	}
+
+	Reduction reduction;
+	reduction.mPhi = phi;
+	reduction.mOp = op;
+	reduction.mVectorPhi = nullptr;
+	reduction.mVectorNext = nullptr;
+	mReductions.push_back(reduction);
+	return true;
+}
+
+bool LoopVectorizer::analyzeBody()
+{
+	for (Instruction& instr : *mBody)
+	{
+		if (isa<TerminatorInst>(instr))
+		{
+			continue;
+		}
+
+		if (GetElementPtrInst* gep = dyn_cast<GetElementPtrInst>(&instr))
+		{
+			if (!analyzeAccess(gep))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		// Loads and stores have to be through one of the addresses
+		// found above (not one computed outside the loop, such as
+		// &k[0], which is the same in every lane), and everything
+		// else is arithmetic on ints
+		if (LoadInst* load = dyn_cast<LoadInst>(&instr))
+		{
+			if (load->isVolatile() || !isAccess(load->getPointerOperand()))
+			{
+				return false;
+			}
+		}
+		else if (StoreInst* store = dyn_cast<StoreInst>(&instr))
+		{
+			if (store->isVolatile() || !isAccess(store->getPointerOperand()))
+			{
+				return false;
+			}
+		}
+		else if (BinaryOperator* binOp = dyn_cast<BinaryOperator>(&instr))
+		{
+			// Division has no vector instruction, and
+			// a lane that isn't used could trap
+			switch (binOp->getOpcode())
+			{
+			case Instruction::Add:
+			case Instruction::Sub:
+			case Instruction::Mul:
+			case Instruction::And:
+			case Instruction::Or:
+			case Instruction::Xor:
+				break;
+			default:
+				return false;
+			}
+		}
+		else if (!isa<ICmpInst>(instr) && !isa<SelectInst>(instr) &&
+				 !isa<SExtInst>(instr) && !isa<ZExtInst>(instr) &&
+				 !isa<TruncInst>(instr))
+		{
+			return false;
+		}
+
+		if (!instr.getType()->isIntegerTy() && !instr.getType()->isVoidTy())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool LoopVectorizer::analyzeAccess(GetElementPtrInst* gep)
+{
+	ArrayAccess access;
+	access.mAddress = gep;
+	access.mBase = gep->getPointerOperand();
+	access.mIsStore = false;
+	Type* type = gep->getType()->getPointerElementType();
+	if (!gep->isInBounds() || gep->getNumIndices() != 1 || !type->isIntegerTy() ||
+		!mLoop->isLoopInvariant(access.mBase) ||
+		!getOffset(gep->getOperand(1), access.mOffset))
+	{
+		return false;
+	}
+
+	// The address can't be used for anything
+	// but loading/storing an element
+	for (User* user : gep->users())
+	{
+		if (StoreInst* store = dyn_cast<StoreInst>(user))
+		{
+			if (store->getValueOperand() == gep)
+			{
+				return false;
+			}
+			access.mIsStore = true;
+		}
+		else if (!isa<LoadInst>(user))
+		{
+			return false;
+		}
+	}
+
+	mAccesses.push_back(access);
+	return true;
+}
+
+bool LoopVectorizer::analyzeDependences()
+{
+	for (ArrayAccess& store : mAccesses)
+	{
+		if (!store.mIsStore)
+		{
+			continue;
+		}
+
+		for (ArrayAccess& other : mAccesses)
+		{
+			// An element stored in one iteration can't be
+			// accessed by any other iteration
+			if (other.mBase == store.mBase)
+			{
+				if (other.mOffset != store.mOffset)
+				{
+					return false;
+				}
+				continue;
+			}
+
+			// A local/global is never the same array as another
+			// one, or an array passed in as an argument
+			Value* storeObject = GetUnderlyingObject(store.mBase);
+			Value* otherObject = GetUnderlyingObject(other.mBase);
+			if (storeObject != otherObject &&
+				(isIdentifiedObject(storeObject) || isIdentifiedObject(otherObject)) &&
+				!(isa<GlobalVariable>(storeObject) && isa<Argument>(otherObject)) &&
+				!(isa<Argument>(storeObject) && isa<GlobalVariable>(otherObject)))
+			{
+				continue;
+			}
+
+			auto check = std::make_pair(store.mBase, other.mBase);
+			auto reversed = std::make_pair(other.mBase, store.mBase);
+			if (std::find(mChecks.begin(), mChecks.end(), check) == mChecks.end() &&
+				std::find(mChecks.begin(), mChecks.end(), reversed) == mChecks.end())
+			{
+				mChecks.push_back(check);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool LoopVectorizer::getOffset(Value* index, int64_t& offset)
+{
+	if (index == mCounter)
+	{
+		offset = 0;
+		return true;
+	}
+
+	BinaryOperator* binOp = dyn_cast<BinaryOperator>(index);
+	if (binOp == nullptr || (binOp->getOpcode() != Instruction::Add &&
+							 binOp->getOpcode() != Instruction::Sub))
+	{
+		return false;
+	}
+
+	ConstantInt* constant = dyn_cast<ConstantInt>(binOp->getOperand(1));
+	Value* other = binOp->getOperand(0);
+	if (constant == nullptr && binOp->getOpcode() == Instruction::Add)
+	{
+		constant = dyn_cast<ConstantInt>(binOp->getOperand(0));
+		other = binOp->getOperand(1);
+	}
+	if (constant == nullptr || !getOffset(other, offset))
+	{
+		return false;
+	}
+
+	if (binOp->getOpcode() == Instruction::Add)
+	{
+		offset += constant->getSExtValue();
+	}
+	else
+	{
+		offset -= constant->getSExtValue();
+	}
+	return true;
+}
+
+void LoopVectorizer::vectorize()
+{
+	Function* func = mHeader->getParent();
+	LLVMContext& ctx = func->getContext();
+	Type* counterType = mCounter->getType();
+
+	// preheader -> vector.ph -> vector.body -> middle.block -> scalar.ph -> header
+	//          \_____________________________________________/
+	mVectorPreheader = BasicBlock::Create(ctx, "vector.ph", func, mHeader);
+	BasicBlock* vectorBody = BasicBlock::Create(ctx, "vector.body", func, mHeader);
+	BasicBlock* middle = BasicBlock::Create(ctx, "middle.block", func, mHeader);
+	BasicBlock* scalarPreheader = BasicBlock::Create(ctx, "scalar.ph", func, mHeader);
+	BranchInst::Create(vectorBody, mVectorPreheader);
+
+	// The vector loop only runs if there's at least one whole vector
+	// of iterations. It runs the iterations up to the last multiple
+	// of the width, and the loop runs the rest.
+	TerminatorInst* preheaderBr = mPreheader->getTerminator();
+	IRBuilder<> preheaderBuild(preheaderBr);
+	Value* tripCount = mEnd;
+	if (!isa<ConstantInt>(mStart) || !cast<ConstantInt>(mStart)->isZero())
+	{
+		tripCount = preheaderBuild.CreateSub(mEnd, mStart, "trip.count");
+	}
+	Value* vectorCount = preheaderBuild.CreateAnd(tripCount,
+												  ConstantInt::get(counterType, -static_cast<int64_t>(mWidth)),
+												  "n.vec");
+	Value* vectorEnd = createAdd(preheaderBuild, mStart, vectorCount, "ind.end");
+	Value* canVectorize = preheaderBuild.CreateAnd(
+		preheaderBuild.CreateICmpSLT(mStart, mEnd),
+		preheaderBuild.CreateICmpUGE(tripCount, ConstantInt::get(counterType, mWidth)),
+		"min.iters.check");
+	if (!mChecks.empty())
+	{
+		canVectorize = preheaderBuild.CreateAnd(canVectorize, emitOverlapChecks(preheaderBuild),
+												"vector.check");
+	}
+	preheaderBuild.CreateCondBr(canVectorize, mVectorPreheader, scalarPreheader);
+	preheaderBr->eraseFromParent();
+
+	mBuild.SetInsertPoint(vectorBody);
+	PHINode* index = mBuild.CreatePHI(counterType, 2, "index");
+	for (Reduction& reduction : mReductions)
+	{
+		VectorType* type = VectorType::get(reduction.mPhi->getType(), mWidth);
+		reduction.mVectorPhi = mBuild.CreatePHI(type, 2, "vec.phi");
+		mWidened[reduction.mPhi] = reduction.mVectorPhi;
+	}
+	mLaneCounter = createAdd(mBuild, mStart, index, "offset.idx");
+
+	// Memory is accessed in the same order as the loop does, and
+	// everything else is widened when it's needed
+	for (Instruction& instr : *mBody)
+	{
+		if (LoadInst* load = dyn_cast<LoadInst>(&instr))
+		{
+			Value* address = getVectorAddress(getAccess(load->getPointerOperand()));
+			unsigned align = load->getType()->getScalarSizeInBits() / 8;
+			mWidened[load] = mBuild.CreateAlignedLoad(address, align, "wide.load");
+		}
+		else if (StoreInst* store = dyn_cast<StoreInst>(&instr))
+		{
+			Value* value = widen(store->getValueOperand());
+			Value* address = getVectorAddress(getAccess(store->getPointerOperand()));
+			unsigned align = store->getValueOperand()->getType()->getScalarSizeInBits() / 8;
+			mBuild.CreateAlignedStore(value, address, align);
+		}
+	}
+	for (Reduction& reduction : mReductions)
+	{
+		reduction.mVectorNext = widen(reduction.mPhi->getIncomingValueForBlock(mBody));
+	}
+
+	// The index is at most end - start, which only fits in an int if
+	// start isn't negative (and then IndVars can use it to step
+	// through the arrays)
+	ConstantInt* constantStart = dyn_cast<ConstantInt>(mStart);
+	bool noWrap = constantStart != nullptr && !constantStart->isNegative();
+	Value* nextIndex = mBuild.CreateAdd(index, ConstantInt::get(counterType, mWidth), "index.next",
+										false, noWrap);
+	mBuild.CreateCondBr(mBuild.CreateICmpEQ(nextIndex, vectorCount), middle, vectorBody);
+	index->addIncoming(ConstantInt::get(counterType, 0), mVectorPreheader);
+	index->addIncoming(nextIndex, vectorBody);
+
+	// The loop picks up where the vector loop left off (or
+	// from the start if the vector loop didn't run)
+	IRBuilder<> middleBuild(middle);
+	IRBuilder<> scalarBuild(scalarPreheader);
+	PHINode* resume = scalarBuild.CreatePHI(counterType, 2, "bc.resume.val");
+	resume->addIncoming(mStart, mPreheader);
+	resume->addIncoming(vectorEnd, middle);
+	mCounter->setIncomingBlock(mCounter->getBasicBlockIndex(mPreheader), scalarPreheader);
+	mCounter->setIncomingValue(mCounter->getBasicBlockIndex(scalarPreheader), resume);
+
+	for (Reduction& reduction : mReductions)
+	{
+		PHINode* phi = reduction.mPhi;
+		Value* initial = phi->getIncomingValueForBlock(mPreheader);
+		reduction.mVectorPhi->addIncoming(reduction.mVectorNext, vectorBody);
+
+		// The first lane starts at the initial value, and the
+		// others with the identity, which doesn't change the result
+		IRBuilder<> build(mVectorPreheader->getTerminator());
+		Constant* identity = ConstantInt::get(phi->getType(), reduction.mOp == Instruction::Mul ? 1 : 0);
+		Value* vectorInitial = build.CreateInsertElement(build.CreateVectorSplat(mWidth, identity),
+														 initial, build.getInt32(0));
+		reduction.mVectorPhi->addIncoming(vectorInitial, mVectorPreheader);
+
+		Value* result = reduce(middleBuild, reduction.mVectorNext, reduction.mOp);
+		PHINode* resumeResult = scalarBuild.CreatePHI(phi->getType(), 2, "bc.merge.rdx");
+		resumeResult->addIncoming(initial, mPreheader);
+		resumeResult->addIncoming(result, middle);
+		phi->setIncomingBlock(phi->getBasicBlockIndex(mPreheader), scalarPreheader);
+		phi->setIncomingValue(phi->getBasicBlockIndex(scalarPreheader), resumeResult);
+	}
+	middleBuild.CreateBr(scalarPreheader);
+	scalarBuild.CreateBr(mHeader);
+}
+
+Value* LoopVectorizer::widen(Value* value)
+{
+	auto found = mWidened.find(value);
+	if (found != mWidened.end())
+	{
+		return found->second;
+	}
+
+	// The same in every lane, which is set up before the loop
+	Value* widened = nullptr;
+	Instruction* instr = dyn_cast<Instruction>(value);
+	if (instr == nullptr || !mLoop->contains(instr))
+	{
+		IRBuilder<> build(mVectorPreheader->getTerminator());
+		widened = build.CreateVectorSplat(mWidth, value, "broadcast");
+	}
+	else if (value == mCounter)
+	{
+		// Each lane is one iteration later than the one before it
+		std::vector<Constant*> steps;
+		for (unsigned i = 0; i < mWidth; i++)
+		{
+			steps.push_back(ConstantInt::get(mCounter->getType(), i));
+		}
+		widened = mBuild.CreateAdd(mBuild.CreateVectorSplat(mWidth, mLaneCounter),
+								   ConstantVector::get(steps), "vec.ind");
+	}
+	else if (BinaryOperator* binOp = dyn_cast<BinaryOperator>(instr))
+	{
+		// The lanes that aren't used by the loop can overflow
+		// (and a reduction adds in a different order), so
+		// these can't keep the nsw flag
+		widened = mBuild.CreateBinOp(binOp->getOpcode(), widen(binOp->getOperand(0)),
+									 widen(binOp->getOperand(1)));
+	}
+	else if (ICmpInst* cmp = dyn_cast<ICmpInst>(instr))
+	{
+		widened = mBuild.CreateICmp(cmp->getPredicate(), widen(cmp->getOperand(0)),
+									widen(cmp->getOperand(1)));
+	}
+	else if (SelectInst* select = dyn_cast<SelectInst>(instr))
+	{
+		widened = mBuild.CreateSelect(widen(select->getCondition()),
+									  widen(select->getTrueValue()),
+									  widen(select->getFalseValue()));
+	}
+	else if (CastInst* cast = dyn_cast<CastInst>(instr))
+	{
+		// A char computed as an int is truncated back to a char, so
+		// if it only adds/multiplies chars it can be computed as
+		// a char, which fits four times as many in a vector
+		Type* destType = cast->getDestTy();
+		if (isa<TruncInst>(cast) && canNarrow(cast->getOperand(0), destType))
+		{
+			widened = narrow(cast->getOperand(0), destType);
+		}
+		else
+		{
+			widened = mBuild.CreateCast(cast->getOpcode(), widen(cast->getOperand(0)),
+										VectorType::get(destType, mWidth));
+		}
+	}
+
+	mWidened[value] = widened;
+	return widened;
+}
+
+bool LoopVectorizer::canNarrow(Value* value, Type* type)
+{
+	if (isa<ConstantInt>(value))
+	{
+		return true;
+	}
+	else if (isa<SExtInst>(value) || isa<ZExtInst>(value))
+	{
+		return cast<CastInst>(value)->getSrcTy() == type;
+	}
+
+	// The low bits of these only depend on the low bits of the operands
+	BinaryOperator* binOp = dyn_cast<BinaryOperator>(value);
+	if (binOp == nullptr || !mLoop->contains(binOp))
+	{
+		return false;
+	}
+	switch (binOp->getOpcode())
+	{
+	case Instruction::Add:
+	case Instruction::Sub:
+	case Instruction::Mul:
+	case Instruction::And:
+	case Instruction::Or:
+	case Instruction::Xor:
+		return canNarrow(binOp->getOperand(0), type) && canNarrow(binOp->getOperand(1), type);
+	default:
+		return false;
+	}
+}
+
+Value* LoopVectorizer::narrow(Value* value, Type* type)
+{
+	auto key = std::make_pair(value, type);
+	auto found = mNarrowed.find(key);
+	if (found != mNarrowed.end())
+	{
+		return found->second;
+	}
+
+	Value* narrowed = nullptr;
+	if (ConstantInt* constant = dyn_cast<ConstantInt>(value))
+	{
+		narrowed = ConstantVector::getSplat(mWidth, ConstantExpr::getTrunc(constant, type));
+	}
+	else if (CastInst* cast = dyn_cast<CastInst>(value))
+	{
+		narrowed = widen(cast->getOperand(0));
+	}
+	else
+	{
+		BinaryOperator* binOp = llvm::cast<BinaryOperator>(value);
+		narrowed = mBuild.CreateBinOp(binOp->getOpcode(), narrow(binOp->getOperand(0), type),
+									  narrow(binOp->getOperand(1), type));
+	}
+
+	mNarrowed[key] = narrowed;
+	return narrowed;
+}
+
+Value* LoopVectorizer::getVectorAddress(const ArrayAccess& access)
+{
+	// The element for the first lane, and the ones after it
+	auto found = mAddresses.find(access.mAddress);
+	if (found != mAddresses.end())
+	{
+		return found->second;
+	}
+	Value* laneIndex = createAdd(mBuild, mLaneCounter,
+								 ConstantInt::get(mCounter->getType(), access.mOffset));
+	Value* element = mBuild.CreateInBoundsGEP(access.mBase, laneIndex);
+	Type* type = access.mAddress->getType()->getPointerElementType();
+	Value* address = mBuild.CreateBitCast(element,
+										  PointerType::getUnqual(VectorType::get(type, mWidth)));
+	mAddresses[access.mAddress] = address;
+	return address;
+}
+
+Value* LoopVectorizer::reduce(IRBuilder<>& build, Value* vector, Instruction::BinaryOps op)
+{
+	// Each step combines the upper half of the lanes that
+	// are left with the lower half, until one lane is left
+	for (unsigned half = mWidth / 2; half > 0; half /= 2)
+	{
+		std::vector<Constant*> mask;
+		for (unsigned i = 0; i < mWidth; i++)
+		{
+			if (i < half)
+			{
+				mask.push_back(build.getInt32(i + half));
+			}
+			else
+			{
+				mask.push_back(UndefValue::get(build.getInt32Ty()));
+			}
+		}
+		Value* upper = build.CreateShuffleVector(vector, UndefValue::get(vector->getType()),
+												 ConstantVector::get(mask), "rdx.shuf");
+		vector = build.CreateBinOp(op, vector, upper, "bin.rdx");
+	}
+	return build.CreateExtractElement(vector, build.getInt32(0), "rdx");
+}
+
+Value* LoopVectorizer::emitOverlapChecks(IRBuilder<>& build)
+{
+	// The range of each array that's accessed, from the first
+	// element to the one after the last (as byte addresses)
+	std::map<Value*, std::pair<Value*, Value*>> bounds;
+	for (auto& check : mChecks)
+	{
+		for (Value* base : { check.first, check.second })
+		{
+			if (bounds.find(base) == bounds.end())
+			{
+				bounds[base] = emitBounds(build, base);
+			}
+		}
+	}
+
+	Value* noOverlap = nullptr;
+	for (auto& check : mChecks)
+	{
+		auto& first = bounds[check.first];
+		auto& second = bounds[check.second];
+		Value* disjoint = build.CreateOr(build.CreateICmpULE(first.second, second.first),
+										 build.CreateICmpULE(second.second, first.first),
+										 "no.overlap");
+		noOverlap = (noOverlap != nullptr) ? build.CreateAnd(noOverlap, disjoint) : disjoint;
+	}
+	return noOverlap;
+}
+
+std::pair<Value*, Value*> LoopVectorizer::emitBounds(IRBuilder<>& build, Value* base)
+{
+	int64_t minOffset = 0;
+	int64_t maxOffset = 0;
+	bool found = false;
+	for (ArrayAccess& access : mAccesses)
+	{
+		if (access.mBase == base)
+		{
+			minOffset = found ? std::min(minOffset, access.mOffset) : access.mOffset;
+			maxOffset = found ? std::max(maxOffset, access.mOffset) : access.mOffset;
+			found = true;
+		}
+	}
+
+	// The loop accesses base[start + offset] up to base[end - 1 + offset]
+	// (which can't be inbounds, in case the loop doesn't run)
+	Type* counterType = mCounter->getType();
+	Value* lowIndex = createAdd(build, mStart, ConstantInt::get(counterType, minOffset));
+	Value* highIndex = createAdd(build, mEnd, ConstantInt::get(counterType, maxOffset));
+	Value* low = build.CreateBitCast(build.CreateGEP(base, lowIndex), build.getInt8PtrTy());
+	Value* high = build.CreateBitCast(build.CreateGEP(base, highIndex), build.getInt8PtrTy());
+	return std::make_pair(low, high);
+}
+
+bool LoopVectorizer::isAccess(Value* address)
+{
+	return std::any_of(mAccesses.begin(), mAccesses.end(),
+		[address](const ArrayAccess& access) { return access.mAddress == address; });
+}
+
+LoopVectorizer::ArrayAccess& LoopVectorizer::getAccess(Value* address)
+{
+	auto iter = std::find_if(mAccesses.begin(), mAccesses.end(),
+		[address](const ArrayAccess& access) { return access.mAddress == address; });
+	assert(iter != mAccesses.end() && "Address was never added to the accesses");
+	return *iter;
+}
+
+} // anonymous
+
+namespace uscc
+{
+namespace opt
+{
+
+bool Vectorizer::runOnFunction(Function& F)
+{
+	// Only innermost loops can be vectorized
+	LoopInfo& loopInfo = getAnalysis<LoopInfo>();
+	std::vector<Loop*> worklist(loopInfo.begin(), loopInfo.end());
+	std::vector<Loop*> innermost;
+	while (!worklist.empty())
+	{
+		Loop* loop = worklist.back();
+		worklist.pop_back();
+		if (loop->getSubLoops().empty())
+		{
+			innermost.push_back(loop);
+		}
+		worklist.insert(worklist.end(), loop->getSubLoops().begin(), loop->getSubLoops().end());
+	}
+
+	bool changed = false;
+	for (Loop* loop : innermost)
+	{
+		LoopVectorizer vectorizer(loop);
+		if (vectorizer.canVectorize())
+		{
+			vectorizer.vectorize();
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void Vectorizer::getAnalysisUsage(AnalysisUsage& Info) const
+{
+	// This adds blocks and loops, so LoopInfo isn't preserved
+	Info.addRequired<LoopInfo>();
+}
+
+} // opt
+} // uscc
+
+char uscc::opt::Vectorizer::ID = 0;
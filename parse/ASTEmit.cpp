@@ -100,7 +100,7 @@ AST_EMIT(ASTFunction)
 		std::vector<llvm::Type*> args;
 		for (auto arg : mArgs)
 		{
-			args.push_back(arg->getIdent().llvmType());
+			args.push_back(arg->getIdent().llvmType(ctx.mGlobal));
 		}
 		
 		funcType = FunctionType::get(retType, args, false);
@@ -375,16 +375,18 @@ AST_EMIT(ASTBinaryMathOp)
     IRBuilder<> builder(ctx.mBlock);
     Value * rhs = mRHS->emitIR(ctx);
     Value * lhs = mLHS->emitIR(ctx);
+    // Signed overflow is undefined, so these are all nsw, which
+    // lets IndVars turn array indices into pointer increments
     switch (mOp)
     {
     case scan::Token::Plus:
-        retVal = builder.CreateAdd(lhs, rhs, "add");
+        retVal = builder.CreateNSWAdd(lhs, rhs, "add");
         break;
     case scan::Token::Minus:
-        retVal = builder.CreateSub(lhs, rhs, "sub");
+        retVal = builder.CreateNSWSub(lhs, rhs, "sub");
         break;
     case scan::Token::Mult:
-        retVal = builder.CreateMul(lhs, rhs, "mul");
+        retVal = builder.CreateNSWMul(lhs, rhs, "mul");
         break;
     case scan::Token::Div:
         retVal = builder.CreateSDiv(lhs, rhs, "div");
@@ -508,7 +510,9 @@ AST_EMIT(ASTIncExpr)
 	// PA3: Implement
     IRBuilder<> builder(ctx.mBlock);
     auto value = mIdent.readFrom(ctx);
-    value = builder.CreateAdd(value, ConstantInt::get(value->getType(), 1), "inc"); // use the same type as value
+    // Only an int can't overflow, a char just wraps around
+    bool nsw = value->getType()->isIntegerTy(32);
+    value = builder.CreateAdd(value, ConstantInt::get(value->getType(), 1), "inc", false, nsw); // use the same type as value
     mIdent.writeTo(ctx, value);
     retVal = value;
 
@@ -522,7 +526,8 @@ AST_EMIT(ASTDecExpr)
 	// PA3: Implement
     IRBuilder<> builder(ctx.mBlock);
     auto value = mIdent.readFrom(ctx);
-    value = builder.CreateSub(value, ConstantInt::get(value->getType(), 1), "dec");
+    bool nsw = value->getType()->isIntegerTy(32);
+    value = builder.CreateSub(value, ConstantInt::get(value->getType(), 1), "dec", false, nsw);
     mIdent.writeTo(ctx, value);
     retVal = value;
     
@@ -557,22 +562,26 @@ AST_EMIT(ASTDecl)
 		Value* declExpr = mExpr->emitIR(ctx);
 		
 		IRBuilder<> build(ctx.mBlock);
-		// If this is a string, we have to memcpy
+		// If this is a string, we have to memcpy (unless the array is
+		// never written to, in which case it just reads the string)
 		if (declExpr->getType()->isPointerTy())
 		{
-			// This address should already be saved
-			Value* arrayLoc = mIdent.readFrom(ctx);
-			
-			// GEP the address of the src
-			std::vector<llvm::Value*> gepIdx;
-			gepIdx.push_back(ctx.mZero);
-			gepIdx.push_back(ctx.mZero);
-			
-			Value*  src = build.CreateGEP(declExpr, gepIdx);
-			
-			// Memcpy into the array
-			// memcpy(dest, src, size, align, volatile)
-			build.CreateMemCpy(arrayLoc, src, mIdent.getArrayCount(), 1);
+			if (!mIdent.isReadOnlyString())
+			{
+				// This address should already be saved
+				Value* arrayLoc = mIdent.readFrom(ctx);
+				
+				// GEP the address of the src
+				std::vector<llvm::Value*> gepIdx;
+				gepIdx.push_back(ctx.mZero);
+				gepIdx.push_back(ctx.mZero);
+				
+				Value*  src = build.CreateGEP(declExpr, gepIdx);
+				
+				// Memcpy into the array
+				// memcpy(dest, src, size, align, volatile)
+				build.CreateMemCpy(arrayLoc, src, mIdent.getArrayCount(), 1);
+			}
 		}
 		else
 		{
@@ -123,7 +123,7 @@ ASTStringExpr::ASTStringExpr(const std::string& str, StringTable& tbl)
 	mString = tbl.getString(actStr);
 }
 
-void ASTFuncExpr::addArg(std::shared_ptr<ASTExpr> arg) noexcept
+void ASTFuncExpr::addArg(ASTExpr* arg) noexcept
 {
 	mArgs.push_back(arg);
 }
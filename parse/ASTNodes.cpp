@@ -16,15 +16,14 @@
 #include "ASTNodes.h"
 
 using namespace uscc::parse;
-using std::shared_ptr;
 
-void ASTProgram::addFunction(shared_ptr<ASTFunction> func) noexcept
+void ASTProgram::addFunction(ASTFunction* func) noexcept
 {
 	mFuncs.push_back(func);
 }
 
 // Add an argument to this function
-void ASTFunction::addArg(shared_ptr<ASTArgDecl> arg) noexcept
+void ASTFunction::addArg(ASTArgDecl* arg) noexcept
 {
 	mArgs.push_back(arg);
 }
@@ -55,8 +54,13 @@ Type ASTFunction::getArgType(unsigned int argNum) const noexcept
 	}
 }
 
+Identifier& ASTFunction::getArgIdent(unsigned int argNum) noexcept
+{
+	return mArgs[argNum - 1]->getIdent();
+}
+
 // Set the compound statement body
-void ASTFunction::setBody(shared_ptr<ASTCompoundStmt> body) noexcept
+void ASTFunction::setBody(ASTCompoundStmt* body) noexcept
 {
 	mBody = body;
 }
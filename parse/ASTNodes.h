@@ -8,6 +8,10 @@
 //  Each AST node supports pretty-printing its node
 //  contents as well as generating the LLVM IR.
 //
+//  Nodes are allocated from the Parser's Arena and refer
+//  to each other with raw pointers; the whole tree is
+//  freed along with the Parser.
+//
 //---------------------------------------------------------
 //  Copyright (c) 2014, Sanjay Madhav
 //  All rights reserved.
@@ -20,10 +24,7 @@
 
 #include <ostream>
 #include <string>
-#include <memory>
-#include <list>
-#include <vector>
-
+#include "Arena.h"
 #include "Types.h"
 #include "Symbols.h"
 #include "../scan/Tokens.h"
@@ -62,10 +63,14 @@ class ASTFunction;
 class ASTProgram : public ASTNode
 {
 public:
-	void addFunction(std::shared_ptr<ASTFunction> func) noexcept;
+	ASTProgram(Arena& arena) noexcept
+	: mFuncs(arena)
+	{ }
+	
+	void addFunction(ASTFunction* func) noexcept;
 	AST_DECL_PRINT_EMIT();
 private:
-	std::list<std::shared_ptr<ASTFunction>> mFuncs;
+	ArenaList<ASTFunction> mFuncs;
 };
 	
 // Function AST Nodes
@@ -76,17 +81,20 @@ class ASTExpr;
 class ASTFunction : public ASTNode
 {
 public:
-	ASTFunction(Identifier& ident, Type returnType, SymbolTable::ScopeTable& scopeTable) noexcept
-	: mIdent(ident)
+	ASTFunction(Arena& arena, Identifier& ident, Type returnType,
+				SymbolTable::ScopeTable& scopeTable) noexcept
+	: mBody(nullptr)
+	, mArgs(arena)
+	, mIdent(ident)
 	, mReturnType(returnType)
 	, mScopeTable(scopeTable)
 	{ }
 	
 	// Add an argument to this function
-	void addArg(std::shared_ptr<ASTArgDecl> arg) noexcept;
+	void addArg(ASTArgDecl* arg) noexcept;
 		
 	// Set the compound statement body
-	void setBody(std::shared_ptr<ASTCompoundStmt> body) noexcept;
+	void setBody(ASTCompoundStmt* body) noexcept;
 	
 	Type getReturnType() const noexcept
 	{
@@ -105,10 +113,13 @@ public:
 	
 	Type getArgType(unsigned int argNum) const noexcept;
 	
+	// Returns the identifier declared for that argument
+	Identifier& getArgIdent(unsigned int argNum) noexcept;
+	
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTCompoundStmt> mBody;
-	std::vector<std::shared_ptr<ASTArgDecl>> mArgs;
+	ASTCompoundStmt* mBody;
+	ArenaList<ASTArgDecl> mArgs;
 	Identifier& mIdent;
 	SymbolTable::ScopeTable& mScopeTable;
 	Type mReturnType;
@@ -158,7 +169,7 @@ protected:
 class ASTArraySub : public ASTNode
 {
 public:
-	ASTArraySub(Identifier& ident, std::shared_ptr<ASTExpr> expr) noexcept
+	ASTArraySub(Identifier& ident, ASTExpr* expr) noexcept
 	: mIdent(ident)
 	, mExpr(expr)
 	{ }
@@ -168,10 +179,15 @@ public:
 		return mIdent.getType();
 	}
 	
+	Identifier& getIdent() noexcept
+	{
+		return mIdent;
+	}
+	
 	AST_DECL_PRINT_EMIT();
 private:
 	Identifier& mIdent;
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 
 // "Bad" expr is returned if a () subexpr fails, so at least
@@ -185,12 +201,17 @@ public:
 class ASTLogicalAnd : public ASTExpr
 {
 public:
+	ASTLogicalAnd() noexcept
+	: mLHS(nullptr)
+	, mRHS(nullptr)
+	{ }
+	
 	// We need to be able to manually set the lhs/rhs
-	void setLHS(std::shared_ptr<ASTExpr> lhs) noexcept
+	void setLHS(ASTExpr* lhs) noexcept
 	{
 		mLHS = lhs;
 	}
-	void setRHS(std::shared_ptr<ASTExpr> rhs) noexcept
+	void setRHS(ASTExpr* rhs) noexcept
 	{
 		mRHS = rhs;
 	}
@@ -203,19 +224,24 @@ public:
 	
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mLHS;
-	std::shared_ptr<ASTExpr> mRHS;
+	ASTExpr* mLHS;
+	ASTExpr* mRHS;
 };
 
 class ASTLogicalOr : public ASTExpr
 {
 public:
+	ASTLogicalOr() noexcept
+	: mLHS(nullptr)
+	, mRHS(nullptr)
+	{ }
+	
 	// We need to be able to manually set the lhs/rhs
-	void setLHS(std::shared_ptr<ASTExpr> lhs) noexcept
+	void setLHS(ASTExpr* lhs) noexcept
 	{
 		mLHS = lhs;
 	}
-	void setRHS(std::shared_ptr<ASTExpr> rhs) noexcept
+	void setRHS(ASTExpr* rhs) noexcept
 	{
 		mRHS = rhs;
 	}
@@ -228,8 +254,8 @@ public:
 	
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mLHS;
-	std::shared_ptr<ASTExpr> mRHS;
+	ASTExpr* mLHS;
+	ASTExpr* mRHS;
 };
 
 class ASTBinaryCmpOp : public ASTExpr
@@ -237,14 +263,16 @@ class ASTBinaryCmpOp : public ASTExpr
 public:
 	ASTBinaryCmpOp(scan::Token::Tokens op) noexcept
 	: mOp(op)
+	, mLHS(nullptr)
+	, mRHS(nullptr)
 	{ }
 	
 	// We need to be able to manually set the lhs/rhs
-	void setLHS(std::shared_ptr<ASTExpr> lhs) noexcept
+	void setLHS(ASTExpr* lhs) noexcept
 	{
 		mLHS = lhs;
 	}
-	void setRHS(std::shared_ptr<ASTExpr> rhs) noexcept
+	void setRHS(ASTExpr* rhs) noexcept
 	{
 		mRHS = rhs;
 	}
@@ -258,8 +286,8 @@ public:
 	AST_DECL_PRINT_EMIT();
 private:
 	scan::Token::Tokens mOp;
-	std::shared_ptr<ASTExpr> mLHS;
-	std::shared_ptr<ASTExpr> mRHS;
+	ASTExpr* mLHS;
+	ASTExpr* mRHS;
 };
 	
 class ASTBinaryMathOp : public ASTExpr
@@ -267,14 +295,16 @@ class ASTBinaryMathOp : public ASTExpr
 public:
 	ASTBinaryMathOp(scan::Token::Tokens op) noexcept
 	: mOp(op)
+	, mLHS(nullptr)
+	, mRHS(nullptr)
 	{ }
 	
 	// We need to be able to manually set the lhs/rhs
-	void setLHS(std::shared_ptr<ASTExpr> lhs) noexcept
+	void setLHS(ASTExpr* lhs) noexcept
 	{
 		mLHS = lhs;
 	}
-	void setRHS(std::shared_ptr<ASTExpr> rhs) noexcept
+	void setRHS(ASTExpr* rhs) noexcept
 	{
 		mRHS = rhs;
 	}
@@ -288,8 +318,8 @@ public:
 	AST_DECL_PRINT_EMIT();
 private:
 	scan::Token::Tokens mOp;
-	std::shared_ptr<ASTExpr> mLHS;
-	std::shared_ptr<ASTExpr> mRHS;
+	ASTExpr* mLHS;
+	ASTExpr* mRHS;
 };
 
 // Value -->
@@ -298,14 +328,14 @@ private:
 class ASTNotExpr : public ASTExpr
 {
 public:
-	ASTNotExpr(std::shared_ptr<ASTExpr> expr) noexcept
+	ASTNotExpr(ASTExpr* expr) noexcept
 	: mExpr(expr)
 	{
 		mType = mExpr->getType();
 	}
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 	
 // Factor -->
@@ -343,6 +373,11 @@ public:
 		return mString->getText().size();
 	}
 	
+	ConstStr* getString() noexcept
+	{
+		return mString;
+	}
+	
 	AST_DECL_PRINT_EMIT();
 private:
 	ConstStr* mString;
@@ -356,6 +391,12 @@ public:
 	{
 		mType = mIdent.getType();
 	}
+	
+	Identifier& getIdent() noexcept
+	{
+		return mIdent;
+	}
+	
 	AST_DECL_PRINT_EMIT();
 private:
 	Identifier& mIdent;
@@ -365,7 +406,7 @@ private:
 class ASTArrayExpr : public ASTExpr
 {
 public:
-	ASTArrayExpr(std::shared_ptr<ASTArraySub> array) noexcept
+	ASTArrayExpr(ASTArraySub* array) noexcept
 	: mArray(array)
 	{
 		if (mArray->getType() == Type::IntArray)
@@ -379,15 +420,16 @@ public:
 	}
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTArraySub> mArray;
+	ASTArraySub* mArray;
 };
 
 // id ( FuncCallArgs )
 class ASTFuncExpr : public ASTExpr
 {
 public:
-	ASTFuncExpr(Identifier& ident) noexcept
+	ASTFuncExpr(Arena& arena, Identifier& ident) noexcept
 	: mIdent(ident)
+	, mArgs(arena)
 	{
 		if (mIdent.getFunction())
 		{
@@ -399,7 +441,7 @@ public:
 		}
 	}
 	
-	void addArg(std::shared_ptr<ASTExpr> arg) noexcept;
+	void addArg(ASTExpr* arg) noexcept;
 	size_t getNumArgs() const noexcept
 	{
 		return mArgs.size();
@@ -408,7 +450,7 @@ public:
 	AST_DECL_PRINT_EMIT();
 private:
 	Identifier& mIdent;
-	std::list<std::shared_ptr<ASTExpr>> mArgs;
+	ArenaList<ASTExpr> mArgs;
 };
 
 // ++ id
@@ -442,68 +484,74 @@ private:
 class ASTAddrOfArray : public ASTExpr
 {
 public:
-	ASTAddrOfArray(std::shared_ptr<ASTArraySub> array) noexcept
+	ASTAddrOfArray(ASTArraySub* array) noexcept
 	: mArray(array)
 	{
 		mType = mArray->getType();
 	}
+	
+	ASTArraySub* getArray() noexcept
+	{
+		return mArray;
+	}
+	
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTArraySub> mArray;
+	ASTArraySub* mArray;
 };
 
 // Used for type conversion from char to int
 class ASTToIntExpr : public ASTExpr
 {
 public:
-	ASTToIntExpr(std::shared_ptr<ASTExpr> expr) noexcept
+	ASTToIntExpr(ASTExpr* expr) noexcept
 	: mExpr(expr)
 	{
 		mType = Type::Int;
 	}
 	
-	std::shared_ptr<ASTExpr> getChild() noexcept
+	ASTExpr* getChild() noexcept
 	{
 		return mExpr;
 	}
 	
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 
 // Used for type conversion from int to char
 class ASTToCharExpr : public ASTExpr
 {
 public:
-	ASTToCharExpr(std::shared_ptr<ASTExpr> expr) noexcept
+	ASTToCharExpr(ASTExpr* expr) noexcept
 	: mExpr(expr)
 	{
 		mType = Type::Char;
 	}
 	
-	std::shared_ptr<ASTExpr> getChild() noexcept
+	ASTExpr* getChild() noexcept
 	{
 		return mExpr;
 	}
 	
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 
 // Declaration Node
 class ASTDecl : public ASTNode
 {
 public:
-	ASTDecl(Identifier& ident, std::shared_ptr<ASTExpr> expr = nullptr) noexcept
+	ASTDecl(Identifier& ident, ASTExpr* expr = nullptr) noexcept
 	: mIdent(ident)
 	, mExpr(expr)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
 	Identifier& mIdent;
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 	
 // Statement AST Nodes
@@ -515,91 +563,96 @@ class ASTStmt : public ASTNode
 class ASTCompoundStmt : public ASTStmt
 {
 public:
+	ASTCompoundStmt(Arena& arena) noexcept
+	: mDecls(arena)
+	, mStmts(arena)
+	{ }
+	
 	AST_DECL_PRINT_EMIT();
-	void addDecl(std::shared_ptr<ASTDecl> decl) noexcept;
-	void addStmt(std::shared_ptr<ASTStmt> stmt) noexcept;
-	std::shared_ptr<ASTStmt> getLastStmt() noexcept;
+	void addDecl(ASTDecl* decl) noexcept;
+	void addStmt(ASTStmt* stmt) noexcept;
+	ASTStmt* getLastStmt() noexcept;
 private:
-	std::list<std::shared_ptr<ASTDecl>> mDecls;
-	std::list<std::shared_ptr<ASTStmt>> mStmts;
+	ArenaList<ASTDecl> mDecls;
+	ArenaList<ASTStmt> mStmts;
 };
 
 class ASTAssignStmt : public ASTStmt
 {
 public:
-	ASTAssignStmt(Identifier& ident, std::shared_ptr<ASTExpr> expr) noexcept
+	ASTAssignStmt(Identifier& ident, ASTExpr* expr) noexcept
 	: mIdent(ident)
 	, mExpr(expr)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
 	Identifier& mIdent;
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 	
 class ASTAssignArrayStmt : public ASTStmt
 {
 public:
-	ASTAssignArrayStmt(std::shared_ptr<ASTArraySub> array,
-					   std::shared_ptr<ASTExpr> expr) noexcept
+	ASTAssignArrayStmt(ASTArraySub* array,
+					   ASTExpr* expr) noexcept
 	: mArray(array)
 	, mExpr(expr)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTArraySub> mArray;
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTArraySub* mArray;
+	ASTExpr* mExpr;
 };
 
 class ASTIfStmt : public ASTStmt
 {
 public:
-	ASTIfStmt(std::shared_ptr<ASTExpr> expr, std::shared_ptr<ASTStmt> thenStmt,
-			  std::shared_ptr<ASTStmt> elseStmt = nullptr) noexcept
+	ASTIfStmt(ASTExpr* expr, ASTStmt* thenStmt,
+			  ASTStmt* elseStmt = nullptr) noexcept
 	: mExpr(expr)
 	, mThenStmt(thenStmt)
 	, mElseStmt(elseStmt)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
-	std::shared_ptr<ASTStmt> mThenStmt;
-	std::shared_ptr<ASTStmt> mElseStmt;
+	ASTExpr* mExpr;
+	ASTStmt* mThenStmt;
+	ASTStmt* mElseStmt;
 };
 
 class ASTWhileStmt : public ASTStmt
 {
 public:
-	ASTWhileStmt(std::shared_ptr<ASTExpr> expr, std::shared_ptr<ASTStmt> loopStmt) noexcept
+	ASTWhileStmt(ASTExpr* expr, ASTStmt* loopStmt) noexcept
 	: mExpr(expr)
 	, mLoopStmt(loopStmt)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
-	std::shared_ptr<ASTStmt> mLoopStmt;
+	ASTExpr* mExpr;
+	ASTStmt* mLoopStmt;
 };
 	
 class ASTReturnStmt : public ASTStmt
 {
 public:
-	ASTReturnStmt(std::shared_ptr<ASTExpr> expr) noexcept
+	ASTReturnStmt(ASTExpr* expr) noexcept
 	: mExpr(expr)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 
 class ASTExprStmt : public ASTStmt
 {
 public:
-	ASTExprStmt(std::shared_ptr<ASTExpr> expr) noexcept
+	ASTExprStmt(ASTExpr* expr) noexcept
 	: mExpr(expr)
 	{ }
 	AST_DECL_PRINT_EMIT();
 private:
-	std::shared_ptr<ASTExpr> mExpr;
+	ASTExpr* mExpr;
 };
 
 class ASTNullStmt : public ASTStmt
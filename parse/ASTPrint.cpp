@@ -18,8 +18,6 @@
 using namespace uscc::parse;
 using namespace uscc::scan;
 
-using std::shared_ptr;
-
 // DON'T TRY THIS AT HOME
 #define AST_PRINT(a) void a::printNode(std::ostream& output, int depth) const noexcept \
 { \
@@ -16,19 +16,17 @@
 
 using namespace uscc::parse;
 
-using std::shared_ptr;
-
-void ASTCompoundStmt::addDecl(shared_ptr<ASTDecl> decl) noexcept
+void ASTCompoundStmt::addDecl(ASTDecl* decl) noexcept
 {
 	mDecls.push_back(decl);
 }
 
-void ASTCompoundStmt::addStmt(shared_ptr<ASTStmt> stmt) noexcept
+void ASTCompoundStmt::addStmt(ASTStmt* stmt) noexcept
 {
 	mStmts.push_back(stmt);
 }
 
-shared_ptr<ASTStmt> ASTCompoundStmt::getLastStmt() noexcept
+ASTStmt* ASTCompoundStmt::getLastStmt() noexcept
 {
 	if (mStmts.size() > 0)
 	{
@@ -0,0 +1,58 @@
+//
+//  Arena.cpp
+//  uscc
+//
+//  Implements the AST bump allocator.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#include "Arena.h"
+#include <cstdlib>
+
+using namespace uscc::parse;
+
+// Size of each block, unless a single request is bigger
+static const size_t kBlockSize = 64 * 1024;
+
+Arena::Arena() noexcept
+: mCurr(nullptr)
+, mEnd(nullptr)
+, mReserved(0)
+{ }
+
+Arena::~Arena()
+{
+	for (char* block : mBlocks)
+	{
+		std::free(block);
+	}
+}
+
+// Starts a new block that can fit the request
+void* Arena::allocateSlow(size_t size, size_t align)
+{
+	size_t blockSize = kBlockSize;
+	if (size + align > blockSize)
+	{
+		blockSize = size + align;
+	}
+
+	char* block = static_cast<char*>(std::malloc(blockSize));
+	if (block == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	mBlocks.push_back(block);
+	mReserved += blockSize;
+	mCurr = block;
+	mEnd = block + blockSize;
+
+	return allocate(size, align);
+}
@@ -0,0 +1,148 @@
+//
+//  Arena.h
+//  uscc
+//
+//  Declares the bump allocator that owns every AST node
+//  of a file, along with the contiguous child arrays the
+//  nodes use to hold their children.
+//
+//  Nodes never own heap memory, so the arena releases the
+//  whole tree in one shot without running any destructors.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace uscc
+{
+namespace parse
+{
+
+class Arena
+{
+public:
+	Arena() noexcept;
+	~Arena();
+
+	// Returns size bytes with the requested alignment
+	void* allocate(size_t size, size_t align)
+	{
+		uintptr_t p = (reinterpret_cast<uintptr_t>(mCurr) + align - 1) & ~(align - 1);
+		if (p + size > reinterpret_cast<uintptr_t>(mEnd))
+		{
+			return allocateSlow(size, align);
+		}
+
+		mCurr = reinterpret_cast<char*>(p + size);
+		return reinterpret_cast<void*>(p);
+	}
+
+	// Constructs a T in the arena.
+	// Its destructor will never be called.
+	template <typename T, typename... Args>
+	T* make(Args&&... args)
+	{
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// Returns the total number of bytes reserved
+	size_t getBytesReserved() const noexcept
+	{
+		return mReserved;
+	}
+private:
+	// Disallow copy/assignment
+	Arena(const Arena& copy);
+	Arena& operator=(const Arena& rhs);
+
+	// Starts a new block that can fit the request
+	void* allocateSlow(size_t size, size_t align);
+
+	std::vector<char*> mBlocks;
+	char* mCurr;
+	char* mEnd;
+	size_t mReserved;
+};
+
+// Growable array of child nodes whose storage lives in
+// the arena. Growing abandons the old storage, which is
+// fine since the arena is freed all at once anyway.
+template <typename T>
+class ArenaList
+{
+public:
+	ArenaList(Arena& arena) noexcept
+	: mArena(arena)
+	, mData(nullptr)
+	, mSize(0)
+	, mCapacity(0)
+	{ }
+
+	void push_back(T* node)
+	{
+		if (mSize == mCapacity)
+		{
+			uint32_t newCap = mCapacity ? mCapacity * 2 : 4;
+			T** newData = static_cast<T**>(mArena.allocate(newCap * sizeof(T*), alignof(T*)));
+			if (mSize > 0)
+			{
+				std::memcpy(newData, mData, mSize * sizeof(T*));
+			}
+			mData = newData;
+			mCapacity = newCap;
+		}
+
+		mData[mSize++] = node;
+	}
+
+	size_t size() const noexcept
+	{
+		return mSize;
+	}
+
+	bool empty() const noexcept
+	{
+		return mSize == 0;
+	}
+
+	T* operator[](size_t idx) const noexcept
+	{
+		return mData[idx];
+	}
+
+	T* back() const noexcept
+	{
+		return mData[mSize - 1];
+	}
+
+	T* const* begin() const noexcept
+	{
+		return mData;
+	}
+
+	T* const* end() const noexcept
+	{
+		return mData + mSize;
+	}
+private:
+	Arena& mArena;
+	T** mData;
+	uint32_t mSize;
+	uint32_t mCapacity;
+};
+
+} // parse
+} // uscc
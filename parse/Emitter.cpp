@@ -25,7 +25,9 @@
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Bitcode/BitcodeWriterPass.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/raw_os_ostream.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/DataLayout.h>
@@ -41,14 +43,16 @@
 #include <llvm/Support//FileSystem.h>
 #include <llvm/Support/SourceMgr.h>
 #include <llvm/MC/SubtargetFeature.h>
+#include <llvm/ADT/Triple.h>
+#include <memory>
 #include "../opt/Passes.h"
 #pragma clang diagnostic pop
 
 using namespace uscc::parse;
 using namespace llvm;
 
-CodeContext::CodeContext(StringTable& strings)
-: mGlobal(getGlobalContext())
+CodeContext::CodeContext(StringTable& strings, LLVMContext& context)
+: mGlobal(context)
 , mModule(nullptr)
 , mBlock(nullptr)
 , mStrings(strings)
@@ -59,8 +63,8 @@ CodeContext::CodeContext(StringTable& strings)
 	
 }
 
-Emitter::Emitter(Parser& parser) noexcept
-: mContext(parser.mStrings)
+Emitter::Emitter(Parser& parser, LLVMContext& context) noexcept
+: mContext(parser.mStrings, context)
 {
 	if (parser.mNeedPrintf)
 	{
@@ -74,17 +78,30 @@ Emitter::Emitter(Parser& parser) noexcept
 	parser.mRoot->emitIR(mContext);
 }
 
-void Emitter::optimize() noexcept
+Emitter::~Emitter() noexcept
 {
+	// The context may outlive this emitter (and compile other files)
+	delete mContext.mModule;
+}
+
+void Emitter::optimize(int inlineThreshold, bool vectorize,
+					   std::ostream* inlineReport) noexcept
+{
+	std::unique_ptr<raw_os_ostream> report;
+	if (inlineReport != nullptr)
+	{
+		report.reset(new raw_os_ostream(*inlineReport));
+	}
 	legacy::PassManager pm;
-	uscc::opt::registerOptPasses(pm);
+	uscc::opt::registerOptPasses(pm, inlineThreshold, vectorize, report.get());
 	pm.run(*mContext.mModule);
 }
 
-void Emitter::print() noexcept
+void Emitter::print(std::ostream& output) noexcept
 {
+	raw_os_ostream stream(output);
 	legacy::PassManager pm;
-	pm.add(createPrintModulePass(outs()));
+	pm.add(createPrintModulePass(stream));
 	pm.run(*mContext.mModule);
 }
 
@@ -103,10 +120,119 @@ bool Emitter::verify() noexcept
 }
 
 // This function will take the bitcode emitted by uscc and convert it to assembly
-bool Emitter::writeAsm(const char *fileName) noexcept
+bool Emitter::writeAsm(const char *fileName, std::ostream& output,
+					   std::ostream* stats) noexcept
+{
+	return writeNative(fileName, false, output, stats);
+}
+
+// Same as writeAsm, except it writes an object file
+bool Emitter::writeObj(const char *fileName, std::ostream& output,
+					   std::ostream* stats) noexcept
+{
+	return writeNative(fileName, true, output, stats);
+}
+
+// Registers the host target with LLVM, which is needed before
+// any native code can be generated. Only needs to be called once.
+void Emitter::initNativeTarget() noexcept
+{
+	InitializeNativeTarget();
+	InitializeNativeTargetAsmPrinter();
+	InitializeNativeTargetAsmParser();
+}
+
+// Makes uscc's register allocator ("color", "linear" or "ssa")
+// the one used for every native compile. Returns false if the
+// allocator name isn't valid.
+bool Emitter::setRegAlloc(const std::string& allocator, unsigned numColors,
+						  unsigned linearScanThreshold) noexcept
+{
+	uscc::opt::RegAllocKind kind;
+	if (allocator == "color")
+	{
+		kind = uscc::opt::RegAllocKind::GraphColor;
+	}
+	else if (allocator == "linear")
+	{
+		kind = uscc::opt::RegAllocKind::LinearScan;
+	}
+	else if (allocator == "ssa")
+	{
+		kind = uscc::opt::RegAllocKind::SSA;
+	}
+	else
+	{
+		return false;
+	}
+	
+	uscc::opt::registerRegAlloc(kind, numColors, linearScanThreshold);
+	return true;
+}
+
+// Runs the host target's code generator on the module
+bool Emitter::writeNative(const char* fileName, bool isObj, std::ostream& output,
+						  std::ostream* stats) noexcept
 {
-	// 11/20/2014 - This function removed because it doesn't work with LLVM 3.5.0...
+	Module& module = *mContext.mModule;
+	std::string triple = sys::getDefaultTargetTriple();
+	
+	std::string err;
+	const Target* target = TargetRegistry::lookupTarget(triple, err);
+	if (target == nullptr)
+	{
+		return false;
+	}
+	
+	TargetOptions options;
+	std::unique_ptr<TargetMachine> machine(
+		target->createTargetMachine(triple, sys::getHostCPUName(), "", options));
+	if (!machine)
+	{
+		return false;
+	}
+	
+	// The module has to know what it's being compiled for
+	module.setTargetTriple(triple);
+	if (const DataLayout* layout = machine->getDataLayout())
+	{
+		module.setDataLayout(layout);
+	}
+	
+	tool_output_file file(fileName, err, isObj ? sys::fs::F_None : sys::fs::F_Text);
+	if (!err.empty())
+	{
+		return false;
+	}
+	
+	legacy::PassManager pm;
+	pm.add(new TargetLibraryInfo(Triple(triple)));
+	machine->addAnalysisPasses(pm);
+	pm.add(new DataLayoutPass(&module));
+	
+	formatted_raw_ostream stream(file.os());
+	TargetMachine::CodeGenFileType type = isObj ? TargetMachine::CGFT_ObjectFile
+												: TargetMachine::CGFT_AssemblyFile;
+	if (machine->addPassesToEmitFile(pm, stream, type))
+	{
+		// The target can't emit this type of file
+		return false;
+	}
+	
+	{
+		raw_os_ostream allocOutput(output);
+		std::unique_ptr<raw_os_ostream> allocStats;
+		if (stats)
+		{
+			allocStats.reset(new raw_os_ostream(*stats));
+		}
+		uscc::opt::setRegAllocOutput(&allocOutput, allocStats.get());
+		pm.run(module);
+		uscc::opt::setRegAllocOutput(nullptr, nullptr);
+	}
 	
+	// Don't delete the file now that it's complete
+	file.keep();
 	return true;
 }
 
@@ -123,9 +249,10 @@ void Emitter::doDCE()
     pm.run(*mContext.mModule);
 }
 
-void Emitter::doLiveness()
+void Emitter::doLiveness(std::ostream& output)
 {
+    raw_os_ostream stream(output);
     legacy::PassManager pm;
-    pm.add(createLivenessPass());
+    pm.add(createLivenessPass(&stream));
     pm.run(*mContext.mModule);
 }
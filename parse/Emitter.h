@@ -20,6 +20,9 @@
 #include <llvm/IR/Value.h>
 #pragma clang diagnostic pop
 
+#include <ostream>
+#include <string>
+
 #include "Types.h"
 #include "../opt/SSABuilder.h"
 
@@ -33,12 +36,12 @@ class Identifier;
 
 struct CodeContext
 {
-	CodeContext(StringTable& strings);
+	CodeContext(StringTable& strings, llvm::LLVMContext& context);
 	
 	// Used for our SSA construction algorithm
 	opt::SSABuilder mSSA;
 	
-	// Global context for LLVM
+	// LLVM context to emit into (each thread compiling needs its own)
 	llvm::LLVMContext& mGlobal;
 	
 	// Module for this program
@@ -65,16 +68,33 @@ class Parser;
 class Emitter
 {
 public:
-	Emitter(Parser& parser) noexcept;
-	void optimize() noexcept;
-	void print() noexcept;
+	Emitter(Parser& parser, llvm::LLVMContext& context) noexcept;
+	~Emitter() noexcept;
+	// Calls with an inline cost of at most inlineThreshold are
+	// inlined, and listed in inlineReport (if it's set). Loops
+	// are only vectorized if vectorize is set.
+	void optimize(int inlineThreshold, bool vectorize,
+				  std::ostream* inlineReport = nullptr) noexcept;
+	void print(std::ostream& output) noexcept;
 	void writeBitcode(const char* fileName) noexcept;
 	bool verify() noexcept;
-	bool writeAsm(const char* fileName) noexcept;
-    void registerAnalysis();
+	// The register allocator reports what it did to output, and
+	// its time and spills per function to stats (if it's set)
+	bool writeAsm(const char* fileName, std::ostream& output,
+				  std::ostream* stats = nullptr) noexcept;
+	bool writeObj(const char* fileName, std::ostream& output,
+				  std::ostream* stats = nullptr) noexcept;
+	static void initNativeTarget() noexcept;
+	static bool setRegAlloc(const std::string& allocator, unsigned numColors,
+							unsigned linearScanThreshold) noexcept;
+    static void registerAnalysis();
     void doDCE();
-    void doLiveness();
+    void doLiveness(std::ostream& output);
 private:
+	// Generates assembly or object code for the host
+	bool writeNative(const char* fileName, bool isObj, std::ostream& output,
+					 std::ostream* stats) noexcept;
+	
 	CodeContext mContext;
 };
 
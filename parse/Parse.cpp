@@ -15,7 +15,8 @@
 //---------------------------------------------------------
 
 #include "Parse.h"
-#include <FlexLexer.h>
+#include "../scan/FastLexer.h"
+#include "../scan/FlexScanner.h"
 #include "Symbols.h"
 
 // Used if you want to see each token
@@ -28,28 +29,39 @@
 
 using namespace uscc::parse;
 using namespace uscc::scan;
-using std::shared_ptr;
-using std::make_shared;
 
 // Constructor takes in a file name and performs the parse
 Parser::Parser(const char* fileName, std::ostream* errStream,
-			   std::ostream* ASTStream, bool outputSymbols)
-: mCurrToken(Token::Unknown)
+			   std::ostream* ASTStream, bool outputSymbols,
+			   bool useFlex /* = false */)
+: mRoot(nullptr)
+, mTokenIdx(static_cast<size_t>(-1))
 , mFileName(fileName)
 , mFileStream(fileName)
 , mErrStream(errStream)
 , mASTStream(ASTStream)
-, mLineNumber(1)
-, mColNumber(1)
-, mUnusedIdent(nullptr)
 , mNeedPrintf(false)
 , mCheckSemant(true) // PA2: Change to true
 , mOutputSymbols(outputSymbols)
 {
 	if (mFileStream.is_open())
 	{
-		mLexer = new yyFlexLexer(&mFileStream);
-				
+		// Scan the whole file up front
+		if (useFlex)
+		{
+			FlexScanner lexer(&mFileStream);
+			mTokens.fill(lexer);
+		}
+		else
+		{
+			FastLexer lexer(fileName);
+			if (!lexer.isOpen())
+			{
+				throw FileNotFound();
+			}
+			mTokens.fill(lexer);
+		}
+		
 		try
 		{
 			// Get the first token
@@ -77,16 +89,16 @@ Parser::Parser(const char* fileName, std::ostream* errStream,
 // Destructor not virtual; I don't expect any inheritance
 Parser::~Parser()
 {
-	delete mLexer;
+	
 }
 
 // Returns the string for the current token's text
 const char* Parser::getTokenTxt() const noexcept
 {
 	const char* retVal = "";
-	if (mCurrToken != Token::Unknown && mCurrToken != Token::EndOfFile)
+	if (peekToken() != Token::Unknown && peekToken() != Token::EndOfFile)
 	{
-		retVal = mLexer->YYText();
+		retVal = mTokens.getText(mTokenIdx);
 	}
 	
 	return retVal;
@@ -99,64 +111,85 @@ const char* Parser::getTokenTxt() const noexcept
 // if unknownIsExcept is true
 void Parser::consumeToken(bool unknownIsExcept)
 {
-	// Add to the column number once we move past
-	// this token.
-	if (mCurrToken != Token::Unknown)
-	{
-		int len = Token::Lengths[mCurrToken];
-		if (len != -1)
-		{
-			mColNumber += len;
-		}
-		else
-		{
-			mColNumber += mLexer->YYLeng();
-		}
-	}
-	
 	do
 	{
-		mCurrToken = static_cast<Token::Tokens>(mLexer->yylex());
-#if DEBUG_PRINT_TOKENS
-		if (mCurrToken == Token::Comment)
-		{
-			std::cout << Token::Names[mCurrToken] << ": " << mLexer->YYText();
-		}
-		else if (mCurrToken != Token::Newline && mCurrToken != Token::Space &&
-				 mCurrToken != Token::Tab)
+		// The last token is always EndOfFile, so never move past it.
+		// (Before the first call, mTokenIdx is -1 so this wraps to 0.)
+		if (mTokenIdx + 1 < mTokens.size())
 		{
-			std::cout << Token::Names[mCurrToken] << ": " << mLexer->YYText() << "\n";
+			mTokenIdx++;
 		}
+#if DEBUG_PRINT_TOKENS
+		std::cout << Token::Names[peekToken()] << ": " << mTokens.getText(mTokenIdx) << "\n";
 #endif
-		if (mCurrToken == Token::Newline || mCurrToken == Token::Comment)
-		{
-			mLineNumber++;
-			mColNumber = 1;
-		}
-		else if (mCurrToken == Token::Space || mCurrToken == Token::Tab)
-		{
-			mColNumber++;
-		}
-		else if (mCurrToken == Token::Unknown)
+		if (peekToken() == Token::Unknown)
 		{
 			// We don't want to always throw an exception, in case we are in
 			// error recovery mode.
 			if (unknownIsExcept)
 			{
-				throw UnknownToken(mLexer->YYText(), mColNumber);
+				throw UnknownToken(mTokens.getText(mTokenIdx));
 			}
 			else
 			{
 				std::string msg("Invalid symbol: ");
-				msg += mLexer->YYText();
+				msg += mTokens.getText(mTokenIdx);
 				reportError(msg);
-				mColNumber++;
 			}
 		}
 	}
-	while(mCurrToken == Token::Newline || mCurrToken == Token::Comment ||
-		  mCurrToken == Token::Space || mCurrToken == Token::Tab ||
-		  mCurrToken == Token::Unknown);
+	while (peekToken() == Token::Unknown);
+}
+
+// Looks past "id" or "id [ ... ]" starting at the current token,
+// and returns true if it's followed by an =.
+bool Parser::isAssignAhead() const noexcept
+{
+	if (peekToken() != Token::Identifier)
+	{
+		return false;
+	}
+	
+	// Unknown tokens are skipped here; they'll be reported
+	// when they're actually consumed
+	size_t i = mTokenIdx + 1;
+	size_t last = mTokens.size() - 1;
+	while (i < last && mTokens.getKind(i) == Token::Unknown)
+	{
+		i++;
+	}
+	
+	if (mTokens.getKind(i) == Token::LBracket)
+	{
+		// Find the matching ]
+		int depth = 0;
+		for (; i < last; i++)
+		{
+			Token::Tokens t = mTokens.getKind(i);
+			if (t == Token::LBracket)
+			{
+				depth++;
+			}
+			else if (t == Token::RBracket && --depth == 0)
+			{
+				break;
+			}
+			else if (t == Token::SemiColon || t == Token::LBrace ||
+					 t == Token::RBrace)
+			{
+				// Can't be part of a subscript
+				return false;
+			}
+		}
+		
+		i++;
+		while (i < last && mTokens.getKind(i) == Token::Unknown)
+		{
+			i++;
+		}
+	}
+	
+	return i <= last && mTokens.getKind(i) == Token::Assign;
 }
 
 // Sees if the token matches the requested.
@@ -166,7 +199,7 @@ void Parser::consumeToken(bool unknownIsExcept)
 // Throws an exception if next token is Unknown
 bool Parser::peekAndConsume(Token::Tokens desired)
 {
-	if (mCurrToken == desired)
+	if (peekToken() == desired)
 	{
 		consumeToken();
 		return true;
@@ -199,7 +232,7 @@ void Parser::matchToken(Token::Tokens desired)
 {
 	if (!peekAndConsume(desired))
 	{
-		throw TokenMismatch(desired, mCurrToken, getTokenTxt());
+		throw TokenMismatch(desired, peekToken(), getTokenTxt());
 	}
 }
 
@@ -222,7 +255,7 @@ void Parser::matchTokenSeq(const std::initializer_list<Token::Tokens>& list)
 	{
 		if (!peekAndConsume(t))
 		{
-			throw TokenMismatch(t, mCurrToken, getTokenTxt());
+			throw TokenMismatch(t, peekToken(), getTokenTxt());
 		}
 	}
 }
@@ -232,7 +265,7 @@ void Parser::matchTokenSeq(const std::initializer_list<Token::Tokens>& list)
 // Throws an exception if next token is Unknown
 void Parser::consumeUntil(Token::Tokens desired) noexcept
 {
-	while (mCurrToken != desired && mCurrToken != Token::EndOfFile)
+	while (peekToken() != desired && peekToken() != Token::EndOfFile)
 	{
 		consumeToken(false);
 	}
@@ -243,7 +276,7 @@ void Parser::consumeUntil(Token::Tokens desired) noexcept
 // Throws an exception if next token is Unknown
 void Parser::consumeUntil(const std::initializer_list<Token::Tokens>& list) noexcept
 {
-	if (mCurrToken == Token::EndOfFile)
+	if (peekToken() == Token::EndOfFile)
 	{
 		return;
 	}
@@ -252,7 +285,7 @@ void Parser::consumeUntil(const std::initializer_list<Token::Tokens>& list) noex
 	{
 		for (auto t : list)
 		{
-			if (mCurrToken == t)
+			if (peekToken() == t)
 			{
 				return;
 			}
@@ -260,7 +293,7 @@ void Parser::consumeUntil(const std::initializer_list<Token::Tokens>& list) noex
 		
 		consumeToken(false);
 	}
-	while (mCurrToken != Token::EndOfFile);
+	while (peekToken() != Token::EndOfFile);
 }
 			
 // Helper functions to report syntax errors
@@ -268,12 +301,12 @@ void Parser::reportError(const ParseExcept& except) noexcept
 {
 	std::stringstream errStrm;
 	except.printException(errStrm);
-	mErrors.push_back(std::make_shared<Error>(errStrm.str(), mLineNumber, mColNumber));
+	mErrors.push_back(std::make_shared<Error>(errStrm.str(), getLineNumber(), getColNumber()));
 }
 			
 void Parser::reportError(const std::string& msg) noexcept
 {
-	mErrors.push_back(std::make_shared<Error>(msg, mLineNumber, mColNumber));
+	mErrors.push_back(std::make_shared<Error>(msg, getLineNumber(), getColNumber()));
 }
 	
 void Parser::reportSemantError(const std::string& msg, int colOverride, int lineOverride) noexcept
@@ -283,7 +316,7 @@ void Parser::reportSemantError(const std::string& msg, int colOverride, int line
 		int col;
 		if (colOverride == -1)
 		{
-			col = mColNumber;
+			col = getColNumber();
 		}
 		else
 		{
@@ -293,14 +326,14 @@ void Parser::reportSemantError(const std::string& msg, int colOverride, int line
 		int line;
 		if (lineOverride == -1)
 		{
-			line = mLineNumber;
+			line = getLineNumber();
 		}
 		else
 		{
 			line = lineOverride;
 		}
 		
-		mErrors.push_back(make_shared<Error>(msg, line, col));
+		mErrors.push_back(std::make_shared<Error>(msg, line, col));
 	}
 }
 
@@ -385,54 +418,95 @@ const char* Parser::getTypeText(Type type) const noexcept
 // Takes the expression, and if it's a char expression, converts it to an int type
 // expression.
 // Otherwise it doesn't do anything.
-std::shared_ptr<ASTExpr> Parser::charToInt(std::shared_ptr<ASTExpr> expr) noexcept
+ASTExpr* Parser::charToInt(ASTExpr* expr) noexcept
 {
-	std::shared_ptr<ASTExpr> retVal = expr;
+	ASTExpr* retVal = expr;
 	
 	// PA2: Implement
 	if (expr->getType() == Type::Char)
 	{
-		if (auto e = std::dynamic_pointer_cast<ASTConstantExpr>(expr))
+		if (auto e = dynamic_cast<ASTConstantExpr*>(expr))
 		{
 			e->changeToInt();
 			retVal = e;
 		}
 		else
-			retVal = make_shared<ASTToIntExpr>(expr);
+			retVal = mArena.make<ASTToIntExpr>(expr);
 	}
 
 	return retVal;
 }
 
 // Like the above, but in reverse
-std::shared_ptr<ASTExpr> Parser::intToChar(std::shared_ptr<ASTExpr> expr) noexcept
+ASTExpr* Parser::intToChar(ASTExpr* expr) noexcept
 {
-	std::shared_ptr<ASTExpr> retVal = expr;
+	ASTExpr* retVal = expr;
 	
 	// PA2: Implement
 	if (expr->getType() == Type::Int)
 	{
-		if (auto e = std::dynamic_pointer_cast<ASTToIntExpr>(expr))
+		if (auto e = dynamic_cast<ASTToIntExpr*>(expr))
 			return e->getChild();
-		if (auto e = std::dynamic_pointer_cast<ASTConstantExpr>(expr))
+		if (auto e = dynamic_cast<ASTConstantExpr*>(expr))
 		{
 			e->changeToChar();
 			retVal = e;
 		}
 		else
-			retVal = make_shared<ASTToCharExpr>(expr);
+			retVal = mArena.make<ASTToCharExpr>(expr);
 	}
 	
 	return retVal;
 }
 
+// If the expression is a whole array (a), or the address of one
+// of its elements (&a[i]), returns the array. Otherwise nullptr.
+Identifier* Parser::getArrayArg(ASTExpr* expr) noexcept
+{
+	if (auto e = dynamic_cast<ASTIdentExpr*>(expr))
+	{
+		if (e->getIdent().isArray())
+		{
+			return &e->getIdent();
+		}
+	}
+	else if (auto e = dynamic_cast<ASTAddrOfArray*>(expr))
+	{
+		return &e->getArray()->getIdent();
+	}
+
+	return nullptr;
+}
+
+// Marks every array passed to a function argument that's written
+// to as written to, also
+void Parser::markWrittenArrays() noexcept
+{
+	// An argument can be written to by being passed on to another
+	// function (possibly a recursive call), so this has to repeat
+	// until nothing changes
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (auto& arg : mArrayArgs)
+		{
+			if (arg.second->isWrittenTo() && !arg.first->isWrittenTo())
+			{
+				arg.first->setWrittenTo();
+				changed = true;
+			}
+		}
+	}
+}
+
 // The entry point for the parser
-shared_ptr<ASTProgram> Parser::parseProgram()
+ASTProgram* Parser::parseProgram()
 {
 	// Create our base program node.
-	shared_ptr<ASTProgram> retVal = make_shared<ASTProgram>();
+	ASTProgram* retVal = mArena.make<ASTProgram>(mArena);
 	
-	shared_ptr<ASTFunction> func = parseFunction();
+	ASTFunction* func = parseFunction();
 	
 	while (func)
 	{
@@ -445,6 +519,8 @@ shared_ptr<ASTProgram> Parser::parseProgram()
 		reportError("Expected end of file");
 	}
 	
+	markWrittenArrays();
+	
 	if (IsValid())
 	{
 		if (mASTStream)
@@ -460,9 +536,9 @@ shared_ptr<ASTProgram> Parser::parseProgram()
 	return retVal;
 }
 	
-shared_ptr<ASTFunction> Parser::parseFunction()
+ASTFunction* Parser::parseFunction()
 {
-	shared_ptr<ASTFunction> retVal;
+	ASTFunction* retVal = nullptr;
 	
 	// Check for a return type
 	if (peekIsOneOf({Token::Key_void, Token::Key_int, Token::Key_char}))
@@ -489,9 +565,10 @@ shared_ptr<ASTFunction> Parser::parseFunction()
 		
 		// Add a useful message if they're trying to return
 		// an array, which USC doesn't allow
-		if (peekAndConsume(Token::LBracket))
+		if (peekToken() == Token::LBracket)
 		{
-			reportSemantError("USC does not allow return of array types", mColNumber - 1);
+			reportSemantError("USC does not allow return of array types");
+			consumeToken();
 			consumeUntil(Token::RBracket);
 			if (peekToken() == Token::EndOfFile)
 			{
@@ -552,7 +629,7 @@ shared_ptr<ASTFunction> Parser::parseFunction()
 		// since arguments count as the function's main body scope
 		SymbolTable::ScopeTable* table = mSymbols.enterScope();
 		
-		retVal = make_shared<ASTFunction>(*ident, retType, *table);
+		retVal = mArena.make<ASTFunction>(mArena, *ident, retType, *table);
 		
 		// If this isn't the dummy function, hook up the node
 		if (!ident->isDummy())
@@ -564,7 +641,7 @@ shared_ptr<ASTFunction> Parser::parseFunction()
 		{
 			try
 			{
-				shared_ptr<ASTArgDecl> arg = parseArgDecl();
+				ASTArgDecl* arg = parseArgDecl();
 				while (arg)
 				{
 					retVal->addArg(arg);
@@ -612,7 +689,7 @@ shared_ptr<ASTFunction> Parser::parseFunction()
 		}
 		
 		// Grab the compound statement for this function
-		shared_ptr<ASTCompoundStmt> funcCompoundStmt;
+		ASTCompoundStmt* funcCompoundStmt = nullptr;
 		try
 		{
 			funcCompoundStmt = parseCompoundStmt(true);
@@ -646,9 +723,9 @@ shared_ptr<ASTFunction> Parser::parseFunction()
 	return retVal;
 }
 	
-shared_ptr<ASTArgDecl> Parser::parseArgDecl()
+ASTArgDecl* Parser::parseArgDecl()
 {
-	shared_ptr<ASTArgDecl> retVal;
+	ASTArgDecl* retVal = nullptr;
 	
 	if (peekIsOneOf({Token::Key_int, Token::Key_char}))
 	{
@@ -706,7 +783,7 @@ shared_ptr<ASTArgDecl> Parser::parseArgDecl()
 		}
 		ident->setType(varType);
 		
-		retVal = make_shared<ASTArgDecl>(*ident);
+		retVal = mArena.make<ASTArgDecl>(*ident);
 	}
 	
 	return retVal;
@@ -21,16 +21,17 @@
 #pragma once
 
 #include "../scan/Tokens.h"
+#include "../scan/TokenBuffer.h"
 #include <initializer_list>
 #include <fstream>
 #include <memory>
 #include <list>
+#include <utility>
+#include <vector>
 #include "ASTNodes.h"
 #include "ParseExcept.h"
 #include "Symbols.h"
 
-class FlexLexer;
-
 namespace uscc
 {
 namespace parse
@@ -43,8 +44,11 @@ class Parser
 	friend class Emitter;
 public:
 	// Constructor takes in a file name and performs the parse
+	// If useFlex is true, the flex-generated scanner is used instead
+	// of the memory-mapped FastLexer
 	Parser(const char* fileName, std::ostream* errStream,
-		   std::ostream* ASTStream, bool outputSymbols);
+		   std::ostream* ASTStream, bool outputSymbols,
+		   bool useFlex = false);
 	
 	// Destructor not virtual; I don't expect any inheritance
 	~Parser();
@@ -66,12 +70,29 @@ protected:
 	// Returns the current token
 	scan::Token::Tokens peekToken() const noexcept
 	{
-		return mCurrToken;
+		return mTokens.getKind(mTokenIdx);
+	}
+	
+	// Returns the line/column of the current token
+	unsigned int getLineNumber() const noexcept
+	{
+		return mTokens.getLine(mTokenIdx);
+	}
+	
+	unsigned int getColNumber() const noexcept
+	{
+		return mTokens.getCol(mTokenIdx);
 	}
 	
 	// Returns the string for the current token's text
 	const char* getTokenTxt() const noexcept;
 	
+	// Looks past "id" or "id [ ... ]" starting at the current token,
+	// and returns true if it's followed by an =.
+	// This resolves the AssignStmt/Factor ambiguity without
+	// consuming anything.
+	bool isAssignAhead() const noexcept;
+	
 	// Consumes the current token, and moves to the next
 	// token that's not a NewLine or Comment.
 	//
@@ -157,90 +178,98 @@ protected:
 	// Takes the expression, and if it's an char expression, converts it to an int type
 	// expression.
 	// Otherwise it doesn't do anything.
-	std::shared_ptr<ASTExpr> charToInt(std::shared_ptr<ASTExpr> expr) noexcept;
+	ASTExpr* charToInt(ASTExpr* expr) noexcept;
 	
 	// Like the above, but in reverse
-	std::shared_ptr<ASTExpr> intToChar(std::shared_ptr<ASTExpr> expr) noexcept;
+	ASTExpr* intToChar(ASTExpr* expr) noexcept;
+	
+	// If the expression is a whole array (a), or the address of one
+	// of its elements (&a[i]), returns the array. Otherwise nullptr.
+	Identifier* getArrayArg(ASTExpr* expr) noexcept;
+	
+	// Marks every array passed to a function argument that's written
+	// to as written to, also. Called once the whole program is parsed.
+	void markWrittenArrays() noexcept;
 	
 protected:
 	// These are all the mutually recursive parse functions
 	
 	// The entry point for the parser (in Parse.cpp)
-	std::shared_ptr<ASTProgram> parseProgram();
+	ASTProgram* parseProgram();
 	
 	// Functions (in Parse.cpp)
-	std::shared_ptr<ASTFunction> parseFunction();
-	std::shared_ptr<ASTArgDecl> parseArgDecl();
+	ASTFunction* parseFunction();
+	ASTArgDecl* parseArgDecl();
 	
 	// Declaration (in ParseStmt.cpp)
-	std::shared_ptr<ASTDecl> parseDecl();
+	ASTDecl* parseDecl();
 	
 	// Statements (in ParseStmt.cpp)
-	std::shared_ptr<ASTStmt> parseStmt();
+	ASTStmt* parseStmt();
 	// If the compound statement is a function body, then the symbol table scope
 	// change will happen at a higher level, so it shouldn't happen in
 	// parseCompoundStmt.
-	std::shared_ptr<ASTCompoundStmt> parseCompoundStmt(bool isFuncBody = false);
-	std::shared_ptr<ASTStmt> parseAssignStmt();
-	std::shared_ptr<ASTIfStmt> parseIfStmt();
-	std::shared_ptr<ASTWhileStmt> parseWhileStmt();
-	std::shared_ptr<ASTReturnStmt> parseReturnStmt();
-	std::shared_ptr<ASTExprStmt> parseExprStmt();
-	std::shared_ptr<ASTNullStmt> parseNullStmt();
+	ASTCompoundStmt* parseCompoundStmt(bool isFuncBody = false);
+	ASTStmt* parseAssignStmt();
+	ASTIfStmt* parseIfStmt();
+	ASTWhileStmt* parseWhileStmt();
+	ASTReturnStmt* parseReturnStmt();
+	ASTExprStmt* parseExprStmt();
+	ASTNullStmt* parseNullStmt();
 	
 	// Expressions (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseExpr();
-	std::shared_ptr<ASTLogicalOr> parseExprPrime(std::shared_ptr<ASTExpr> lhs);
+	ASTExpr* parseExpr();
+	ASTLogicalOr* parseExprPrime(ASTExpr* lhs);
 	
 	// AndTerm (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseAndTerm();
-	std::shared_ptr<ASTLogicalAnd> parseAndTermPrime(std::shared_ptr<ASTExpr> lhs);
+	ASTExpr* parseAndTerm();
+	ASTLogicalAnd* parseAndTermPrime(ASTExpr* lhs);
 	
 	// RelExpr (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseRelExpr();
-	std::shared_ptr<ASTBinaryCmpOp> parseRelExprPrime(std::shared_ptr<ASTExpr> lhs);
+	ASTExpr* parseRelExpr();
+	ASTBinaryCmpOp* parseRelExprPrime(ASTExpr* lhs);
 	
 	// NumExpr (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseNumExpr();
-	std::shared_ptr<ASTBinaryMathOp> parseNumExprPrime(std::shared_ptr<ASTExpr> lhs);
+	ASTExpr* parseNumExpr();
+	ASTBinaryMathOp* parseNumExprPrime(ASTExpr* lhs);
 	
 	// Term (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseTerm();
-	std::shared_ptr<ASTBinaryMathOp> parseTermPrime(std::shared_ptr<ASTExpr> lhs);
+	ASTExpr* parseTerm();
+	ASTBinaryMathOp* parseTermPrime(ASTExpr* lhs);
 	
 	// Value (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseValue();
+	ASTExpr* parseValue();
 	
 	// Factor (in ParseExpr.cpp)
-	std::shared_ptr<ASTExpr> parseFactor();
-	std::shared_ptr<ASTExpr> parseParenFactor();
-	std::shared_ptr<ASTConstantExpr> parseConstantFactor();
-	std::shared_ptr<ASTStringExpr> parseStringFactor();
+	ASTExpr* parseFactor();
+	ASTExpr* parseParenFactor();
+	ASTConstantExpr* parseConstantFactor();
+	ASTStringExpr* parseStringFactor();
 	// parseIdentFactor parses id, id [Expr], and id (FunCallArgs)
-	std::shared_ptr<ASTExpr> parseIdentFactor();
-	std::shared_ptr<ASTExpr> parseIncFactor();
-	std::shared_ptr<ASTExpr> parseDecFactor();
-	std::shared_ptr<ASTExpr> parseAddrOfArrayFactor();
+	ASTExpr* parseIdentFactor();
+	ASTExpr* parseIncFactor();
+	ASTExpr* parseDecFactor();
+	ASTExpr* parseAddrOfArrayFactor();
 	
 private:
 	// Disallow copy/assignment
 	Parser(const Parser& copy) { }
 	Parser& operator=(const Parser& rhs) { return *this; }
 	
-	// Pointer to the root of our AST root
-	std::shared_ptr<ASTProgram> mRoot;
+	// Owns every node of the AST
+	Arena mArena;
 	
-	// Used to resolve AsisgnStmt/Factor ambiguity
-	Identifier* mUnusedIdent;
-	std::shared_ptr<ASTArraySub> mUnusedArray;
+	// Pointer to the root of our AST root
+	ASTProgram* mRoot;
 	
 	// Symbol table corresponding to the parsed file
 	SymbolTable mSymbols;
 	// String table for this file
 	StringTable mStrings;
 	
-	// Flex wrapper class
-	FlexLexer* mLexer;
+	// Every token in the file, and the index of the current one
+	scan::TokenBuffer mTokens;
+	size_t mTokenIdx;
 
 	// Name of the file we're parsing
 	const char* mFileName;
@@ -254,17 +283,13 @@ private:
 	// Tracks the return type of the current function
 	Type mCurrReturnType;
 	
-	// Current active token
-	uscc::scan::Token::Tokens mCurrToken;
-	
-	// Keeps track of the line number in the file
-	unsigned int mLineNumber;
-	// Keeps track of the column number in the current line
-	unsigned int mColNumber;
-	
 	// List used to store all of the errors
 	std::list<std::shared_ptr<Error>> mErrors;
 	
+	// Every array passed to a function, and the argument it's
+	// passed to (printf doesn't have any, since it never writes)
+	std::vector<std::pair<Identifier*, Identifier*>> mArrayArgs;
+	
 	// Track whether we need printf
 	bool mNeedPrintf;
 	
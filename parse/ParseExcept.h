@@ -73,16 +73,10 @@ public:
 class UnknownToken : public virtual ParseExcept
 {
 public:
-	UnknownToken(const char* tokStr, unsigned int& colNum)
+	UnknownToken(const char* tokStr)
 	: mToken(tokStr)
-	, mColNum(colNum)
 	{ }
 	
-	virtual ~UnknownToken() override
-	{
-		mColNum++;
-	}
-	
 	virtual const char* what() const noexcept override
 	{
 		return "Unknown token";
@@ -91,7 +85,6 @@ public:
 	virtual void printException(std::ostream& output) const noexcept override;
 private:
 	const char* mToken;
-	unsigned int& mColNum;
 };
 	
 class TokenMismatch : public virtual ParseExcept
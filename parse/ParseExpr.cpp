@@ -21,22 +21,20 @@
 using namespace uscc::parse;
 using namespace uscc::scan;
 
-using std::shared_ptr;
-using std::make_shared;
 
-shared_ptr<ASTExpr> Parser::parseExpr()
+ASTExpr* Parser::parseExpr()
 {
-	shared_ptr<ASTExpr> retVal;
+	ASTExpr* retVal = nullptr;
 	
 	// We should first get a AndTerm
-	shared_ptr<ASTExpr> andTerm = parseAndTerm();
+	ASTExpr* andTerm = parseAndTerm();
 	
 	// If we didn't get an andTerm, then this isn't an Expr
 	if (andTerm)
 	{
 		retVal = andTerm;
 		// Check if this is followed by an op (optional)
-		shared_ptr<ASTLogicalOr> exprPrime = parseExprPrime(retVal);
+		ASTLogicalOr* exprPrime = parseExprPrime(retVal);
 		
 		if (exprPrime)
 		{
@@ -48,19 +46,19 @@ shared_ptr<ASTExpr> Parser::parseExpr()
 	return retVal;
 }
 
-shared_ptr<ASTLogicalOr> Parser::parseExprPrime(shared_ptr<ASTExpr> lhs)
+ASTLogicalOr* Parser::parseExprPrime(ASTExpr* lhs)
 {
-	shared_ptr<ASTLogicalOr> retVal;
+	ASTLogicalOr* retVal = nullptr;
 	
 	// Must be ||
 	if (peekToken() == Token::Or)
 	{
 		// Make the binary cmp op
 		Token::Tokens op = peekToken();
-		retVal = make_shared<ASTLogicalOr>();
+		retVal = mArena.make<ASTLogicalOr>();
 
 		// PA2 mine
-		int col = mColNumber;
+		int col = getColNumber();
 
 		consumeToken();
 		
@@ -68,7 +66,7 @@ shared_ptr<ASTLogicalOr> Parser::parseExprPrime(shared_ptr<ASTExpr> lhs)
 		retVal->setLHS(lhs);
 		
 		// We MUST get a AndTerm as the RHS of this operand
-		shared_ptr<ASTExpr> rhs = parseAndTerm();
+		ASTExpr* rhs = parseAndTerm();
 		if (!rhs)
 		{
 			throw OperandMissing(op);
@@ -87,7 +85,7 @@ shared_ptr<ASTLogicalOr> Parser::parseExprPrime(shared_ptr<ASTExpr> lhs)
 		}
 
 		// See comment in parseTermPrime if you're confused by this
-		shared_ptr<ASTLogicalOr> exprPrime = parseExprPrime(retVal);
+		ASTLogicalOr* exprPrime = parseExprPrime(retVal);
 		if (exprPrime)
 		{
 			retVal = exprPrime;
@@ -98,10 +96,10 @@ shared_ptr<ASTLogicalOr> Parser::parseExprPrime(shared_ptr<ASTExpr> lhs)
 }
 
 // AndTerm -->
-shared_ptr<ASTExpr> Parser::parseAndTerm()
+ASTExpr* Parser::parseAndTerm()
 {
-	shared_ptr<ASTExpr> retVal;
-	shared_ptr<ASTLogicalAnd> prime;
+	ASTExpr* retVal = nullptr;
+	ASTLogicalAnd* prime = nullptr;
 
 	// PA1: This should not directly check factor
 	// but instead implement the proper grammar rule
@@ -117,19 +115,19 @@ shared_ptr<ASTExpr> Parser::parseAndTerm()
 	return retVal;
 }
 
-shared_ptr<ASTLogicalAnd> Parser::parseAndTermPrime(shared_ptr<ASTExpr> lhs)
+ASTLogicalAnd* Parser::parseAndTermPrime(ASTExpr* lhs)
 {
-	shared_ptr<ASTLogicalAnd> retVal;
-	shared_ptr<ASTLogicalAnd> recursion;
-	shared_ptr<ASTExpr> rhs;
+	ASTLogicalAnd* retVal = nullptr;
+	ASTLogicalAnd* recursion = nullptr;
+	ASTExpr* rhs = nullptr;
 
 	// PA1: Implement
 	if (peekToken() == Token::And)
 	{
-		retVal = make_shared<ASTLogicalAnd>();
+		retVal = mArena.make<ASTLogicalAnd>();
 		retVal->setLHS(lhs);
 
-		int col = mColNumber;
+		int col = getColNumber();
 
 		consumeToken();
 
@@ -156,10 +154,10 @@ shared_ptr<ASTLogicalAnd> Parser::parseAndTermPrime(shared_ptr<ASTExpr> lhs)
 }
 
 // RelExpr -->
-shared_ptr<ASTExpr> Parser::parseRelExpr()
+ASTExpr* Parser::parseRelExpr()
 {
-	shared_ptr<ASTExpr> retVal;
-	shared_ptr<ASTBinaryCmpOp> prime;
+	ASTExpr* retVal = nullptr;
+	ASTBinaryCmpOp* prime = nullptr;
 
 	// PA1: Implement
 	auto v = parseNumExpr();
@@ -174,19 +172,19 @@ shared_ptr<ASTExpr> Parser::parseRelExpr()
 	return retVal;
 }
 
-shared_ptr<ASTBinaryCmpOp> Parser::parseRelExprPrime(shared_ptr<ASTExpr> lhs)
+ASTBinaryCmpOp* Parser::parseRelExprPrime(ASTExpr* lhs)
 {
-	shared_ptr<ASTBinaryCmpOp> retVal;
-	shared_ptr<ASTBinaryCmpOp> recursion;
-	shared_ptr<ASTExpr> rhs;
+	ASTBinaryCmpOp* retVal = nullptr;
+	ASTBinaryCmpOp* recursion = nullptr;
+	ASTExpr* rhs = nullptr;
 	
 	// PA1: Implement
 	if (peekIsOneOf({Token::EqualTo, Token::NotEqual, Token::LessThan, Token::GreaterThan}))
 	{
 		auto token = peekToken();
-		retVal = make_shared<ASTBinaryCmpOp>(token);
+		retVal = mArena.make<ASTBinaryCmpOp>(token);
 
-		int col = mColNumber;
+		int col = getColNumber();
 
 		consumeToken();
 		retVal->setLHS(lhs);
@@ -214,10 +212,10 @@ shared_ptr<ASTBinaryCmpOp> Parser::parseRelExprPrime(shared_ptr<ASTExpr> lhs)
 }
 
 // NumExpr -->
-shared_ptr<ASTExpr> Parser::parseNumExpr()
+ASTExpr* Parser::parseNumExpr()
 {
-	shared_ptr<ASTExpr> retVal;
-	shared_ptr<ASTBinaryMathOp> prime;
+	ASTExpr* retVal = nullptr;
+	ASTBinaryMathOp* prime = nullptr;
 	
 	// PA1: Implement
 
@@ -233,19 +231,19 @@ shared_ptr<ASTExpr> Parser::parseNumExpr()
 	return retVal;
 }
 
-shared_ptr<ASTBinaryMathOp> Parser::parseNumExprPrime(shared_ptr<ASTExpr> lhs)
+ASTBinaryMathOp* Parser::parseNumExprPrime(ASTExpr* lhs)
 {
-	shared_ptr<ASTBinaryMathOp> retVal;
-	shared_ptr<ASTBinaryMathOp> recursion;
-	shared_ptr<ASTExpr> rhs;
+	ASTBinaryMathOp* retVal = nullptr;
+	ASTBinaryMathOp* recursion = nullptr;
+	ASTExpr* rhs = nullptr;
 
 	// PA1: Implement
 	if (peekIsOneOf({Token::Plus, Token::Minus}))
 	{
 		auto token = peekToken();
-		retVal = make_shared<ASTBinaryMathOp>(token);
+		retVal = mArena.make<ASTBinaryMathOp>(token);
 
-		int col = mColNumber;
+		int col = getColNumber();
 
 		consumeToken();
 		retVal->setLHS(lhs);
@@ -272,10 +270,10 @@ shared_ptr<ASTBinaryMathOp> Parser::parseNumExprPrime(shared_ptr<ASTExpr> lhs)
 }
 
 // Term -->
-shared_ptr<ASTExpr> Parser::parseTerm()
+ASTExpr* Parser::parseTerm()
 {
-	shared_ptr<ASTExpr> retVal;
-	shared_ptr<ASTBinaryMathOp> prime;
+	ASTExpr* retVal = nullptr;
+	ASTBinaryMathOp* prime = nullptr;
 
 	// PA1: Implement
 	auto v = parseValue();
@@ -290,19 +288,19 @@ shared_ptr<ASTExpr> Parser::parseTerm()
 	return retVal;
 }
 
-shared_ptr<ASTBinaryMathOp> Parser::parseTermPrime(shared_ptr<ASTExpr> lhs)
+ASTBinaryMathOp* Parser::parseTermPrime(ASTExpr* lhs)
 {
-	shared_ptr<ASTBinaryMathOp> retVal;
-	shared_ptr<ASTBinaryMathOp> recursion;
-	shared_ptr<ASTExpr> rhs;
+	ASTBinaryMathOp* retVal = nullptr;
+	ASTBinaryMathOp* recursion = nullptr;
+	ASTExpr* rhs = nullptr;
 
 	// PA1: Implement
 	if (peekIsOneOf({Token::Mult, Token::Div, Token::Mod}))
 	{
 		auto token = peekToken();
-		retVal = make_shared<ASTBinaryMathOp>(token);
+		retVal = mArena.make<ASTBinaryMathOp>(token);
 
-		int col = mColNumber;
+		int col = getColNumber();
 
 		consumeToken();
 		retVal->setLHS(lhs);
@@ -329,16 +327,16 @@ shared_ptr<ASTBinaryMathOp> Parser::parseTermPrime(shared_ptr<ASTExpr> lhs)
 }
 
 // Value -->
-shared_ptr<ASTExpr> Parser::parseValue()
+ASTExpr* Parser::parseValue()
 {
-	shared_ptr<ASTExpr> retVal;
+	ASTExpr* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Not))
 	{
 		auto f = parseFactor();
 		if (f)
-			retVal = make_shared<ASTNotExpr>(f);
+			retVal = mArena.make<ASTNotExpr>(f);
 		else
 			throw ParseExceptMsg("! must be followed by an expression.");
 	}
@@ -349,13 +347,9 @@ shared_ptr<ASTExpr> Parser::parseValue()
 }
 
 // Factor -->
-shared_ptr<ASTExpr> Parser::parseFactor()
+ASTExpr* Parser::parseFactor()
 {
-	shared_ptr<ASTExpr> retVal;
-	
-	// Try parse identifier factors FIRST so
-	// we make sure to consume the mUnusedIdents
-	// before we try any other rules
+	ASTExpr* retVal = nullptr;
 	
 	if ((retVal = parseIdentFactor()))
 		;
@@ -377,9 +371,9 @@ shared_ptr<ASTExpr> Parser::parseFactor()
 }
 
 // ( Expr )
-shared_ptr<ASTExpr> Parser::parseParenFactor()
+ASTExpr* Parser::parseParenFactor()
 {
-	shared_ptr<ASTExpr> retVal;
+	ASTExpr* retVal = nullptr;
 
 	// PA1: Implement
 	if (peekAndConsume(Token::LParen))
@@ -394,14 +388,14 @@ shared_ptr<ASTExpr> Parser::parseParenFactor()
 }
 
 // constant
-shared_ptr<ASTConstantExpr> Parser::parseConstantFactor()
+ASTConstantExpr* Parser::parseConstantFactor()
 {
-	shared_ptr<ASTConstantExpr> retVal;
+	ASTConstantExpr* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekIsOneOf({Token::Constant}))
 	{
-		retVal = make_shared<ASTConstantExpr>(getTokenTxt());
+		retVal = mArena.make<ASTConstantExpr>(getTokenTxt());
 		consumeToken();
 	}
 
@@ -409,14 +403,14 @@ shared_ptr<ASTConstantExpr> Parser::parseConstantFactor()
 }
 
 // string
-shared_ptr<ASTStringExpr> Parser::parseStringFactor()
+ASTStringExpr* Parser::parseStringFactor()
 {
-	shared_ptr<ASTStringExpr> retVal;
+	ASTStringExpr* retVal = nullptr;
 
 	// PA1: Implement
 	if (peekIsOneOf({Token::String}))
 	{
-		retVal = make_shared<ASTStringExpr>(getTokenTxt(), mStrings);
+		retVal = mArena.make<ASTStringExpr>(getTokenTxt(), mStrings);
 		consumeToken();
 	}
 
@@ -426,235 +420,217 @@ shared_ptr<ASTStringExpr> Parser::parseStringFactor()
 // id
 // id [ Expr ]
 // id ( FuncCallArgs )
-shared_ptr<ASTExpr> Parser::parseIdentFactor()
+ASTExpr* Parser::parseIdentFactor()
 {
-	shared_ptr<ASTExpr> retVal;
-	if (peekToken() == Token::Identifier ||
-		mUnusedIdent != nullptr || mUnusedArray != nullptr)
+	ASTExpr* retVal = nullptr;
+	if (peekToken() == Token::Identifier)
 	{
-		if (mUnusedArray)
-		{
-			// "unused array" means that AssignStmt looked at this array
-			// and decided it didn't want it, so it's already made an
-			// array sub node
-			retVal = make_shared<ASTArrayExpr>(mUnusedArray);
-			mUnusedArray = nullptr;
-		}
-		else
+		Identifier* ident = getVariable(getTokenTxt());
+		consumeToken();
+		
+		// Now we need to look ahead and see if this is an array
+		// or function call reference, since id is a common
+		// left prefix.
+		if (peekToken() == Token::LBracket)
 		{
-			Identifier* ident = nullptr;
-			
-			// If we have an "unused identifier," which means that
-			// AssignStmt looked at this and decided it didn't want it,
-			// that means we're already a token AFTER the identifier.
-			if (mUnusedIdent)
+			// Check to make sure this is an array
+			if (mCheckSemant && ident->getType() != Type::IntArray &&
+				ident->getType() != Type::CharArray &&
+				!ident->isDummy())
 			{
-				ident = mUnusedIdent;
-				mUnusedIdent = nullptr;
+				std::string err("'");
+				err += ident->getName();
+				err += "' is not an array";
+				reportSemantError(err);
+				consumeUntil(Token::RBracket);
+				if (peekToken() == Token::EndOfFile)
+				{
+					throw EOFExcept();
+				}
+				
+				matchToken(Token::RBracket);
+				
+				// Just return our error variable
+				retVal = mArena.make<ASTIdentExpr>(*mSymbols.getIdentifier("@@variable"));
 			}
 			else
 			{
-				ident = getVariable(getTokenTxt());
 				consumeToken();
-			}
-			
-			// Now we need to look ahead and see if this is an array
-			// or function call reference, since id is a common
-			// left prefix.
-			if (peekToken() == Token::LBracket)
-			{
-				// Check to make sure this is an array
-				if (mCheckSemant && ident->getType() != Type::IntArray &&
-					ident->getType() != Type::CharArray &&
-					!ident->isDummy())
+				try
 				{
-					std::string err("'");
-					err += ident->getName();
-					err += "' is not an array";
-					reportSemantError(err);
-					consumeUntil(Token::RBracket);
-					if (peekToken() == Token::EndOfFile)
+					ASTExpr* expr = parseExpr();
+					if (!expr)
 					{
-						throw EOFExcept();
+						throw ParseExceptMsg("Valid expression required inside [ ].");
 					}
 					
-					matchToken(Token::RBracket);
-					
-					// Just return our error variable
-					retVal = make_shared<ASTIdentExpr>(*mSymbols.getIdentifier("@@variable"));
+					ASTArraySub* array = mArena.make<ASTArraySub>(*ident, expr);
+					retVal = mArena.make<ASTArrayExpr>(array);
 				}
-				else
+				catch (ParseExcept& e)
 				{
-					consumeToken();
-					try
-					{
-						shared_ptr<ASTExpr> expr = parseExpr();
-						if (!expr)
-						{
-							throw ParseExceptMsg("Valid expression required inside [ ].");
-						}
-						
-						shared_ptr<ASTArraySub> array = make_shared<ASTArraySub>(*ident, expr);
-						retVal = make_shared<ASTArrayExpr>(array);
-					}
-					catch (ParseExcept& e)
+					// If this expr is bad, consume until RBracket
+					reportError(e);
+					consumeUntil(Token::RBracket);
+					if (peekToken() == Token::EndOfFile)
 					{
-						// If this expr is bad, consume until RBracket
-						reportError(e);
-						consumeUntil(Token::RBracket);
-						if (peekToken() == Token::EndOfFile)
-						{
-							throw EOFExcept();
-						}
+						throw EOFExcept();
 					}
-					
-					matchToken(Token::RBracket);
 				}
+				
+				matchToken(Token::RBracket);
 			}
-			else if (peekToken() == Token::LParen)
+		}
+		else if (peekToken() == Token::LParen)
+		{
+			// Check to make sure this is a function
+			if (mCheckSemant && ident->getType() != Type::Function &&
+				!ident->isDummy())
 			{
-				// Check to make sure this is a function
-				if (mCheckSemant && ident->getType() != Type::Function &&
-					!ident->isDummy())
+				std::string err("'");
+				err += ident->getName();
+				err += "' is not a function";
+				reportSemantError(err);
+				consumeUntil(Token::RParen);
+				if (peekToken() == Token::EndOfFile)
 				{
-					std::string err("'");
-					err += ident->getName();
-					err += "' is not a function";
-					reportSemantError(err);
-					consumeUntil(Token::RParen);
-					if (peekToken() == Token::EndOfFile)
-					{
-						throw EOFExcept();
-					}
-					
-					matchToken(Token::RParen);
-					
-					// Just return our error variable
-					retVal = make_shared<ASTIdentExpr>(*mSymbols.getIdentifier("@@variable"));
+					throw EOFExcept();
 				}
-				else
+				
+				matchToken(Token::RParen);
+				
+				// Just return our error variable
+				retVal = mArena.make<ASTIdentExpr>(*mSymbols.getIdentifier("@@variable"));
+			}
+			else
+			{
+				consumeToken();
+				// A function call can have zero or more arguments
+				ASTFuncExpr* funcCall = mArena.make<ASTFuncExpr>(mArena, *ident);
+				retVal = funcCall;
+				
+				// Get the number of arguments for this function
+				ASTFunction* func = ident->getFunction();
+				
+				try
 				{
-					consumeToken();
-					// A function call can have zero or more arguments
-					shared_ptr<ASTFuncExpr> funcCall = make_shared<ASTFuncExpr>(*ident);
-					retVal = funcCall;
-					
-					// Get the number of arguments for this function
-					shared_ptr<ASTFunction> func = ident->getFunction();
-					
-					try
+					int currArg = 1;
+					int col = getColNumber();
+					ASTExpr* arg = parseExpr();
+					while (arg)
 					{
-						int currArg = 1;
-						int col = mColNumber;
-						shared_ptr<ASTExpr> arg = parseExpr();
-						while (arg)
+						// Check for validity of this argument (for non-dummy functions)
+						if (!ident->isDummy())
 						{
-							// Check for validity of this argument (for non-dummy functions)
-							if (!ident->isDummy())
+							// Special case for "printf" since we don't make a node for it
+							if (ident->getName() == "printf")
 							{
-								// Special case for "printf" since we don't make a node for it
-								if (ident->getName() == "printf")
+								mNeedPrintf = true;
+								if (currArg == 1 && arg->getType() != Type::CharArray)
 								{
-									mNeedPrintf = true;
-									if (currArg == 1 && arg->getType() != Type::CharArray)
-									{
-										reportSemantError("The first parameter to printf must be a char[]");
-									}
+									reportSemantError("The first parameter to printf must be a char[]");
+								}
+							}
+							else if (mCheckSemant)
+							{
+								if (currArg > func->getNumArgs())
+								{
+									std::string err("Function ");
+									err += ident->getName();
+									err += " takes only ";
+									std::ostringstream ss;
+									ss << func->getNumArgs();
+									err += ss.str();
+									err += " arguments";
+									reportSemantError(err, col);
 								}
-								else if (mCheckSemant)
+								else if (!func->checkArgType(currArg, arg->getType()))
 								{
-									if (currArg > func->getNumArgs())
+									// If we have an int and the expected arg type is a char,
+									// we can do a conversion
+									if (arg->getType() == Type::Int &&
+										func->getArgType(currArg) == Type::Char)
 									{
-										std::string err("Function ");
-										err += ident->getName();
-										err += " takes only ";
-										std::ostringstream ss;
-										ss << func->getNumArgs();
-										err += ss.str();
-										err += " arguments";
-										reportSemantError(err, col);
+										arg = intToChar(arg);
 									}
-									else if (!func->checkArgType(currArg, arg->getType()))
+									else
 									{
-										// If we have an int and the expected arg type is a char,
-										// we can do a conversion
-										if (arg->getType() == Type::Int &&
-											func->getArgType(currArg) == Type::Char)
-										{
-											arg = intToChar(arg);
-										}
-										else
-										{
-											std::string err("Expected expression of type ");
-											err += getTypeText(func->getArgType(currArg));
-											reportSemantError(err, col);
-										}
+										std::string err("Expected expression of type ");
+										err += getTypeText(func->getArgType(currArg));
+										reportSemantError(err, col);
 									}
 								}
-							}
-							
-							funcCall->addArg(arg);
-							
-							currArg++;
-							
-							if (peekAndConsume(Token::Comma))
-							{
-								col = mColNumber;
-								arg = parseExpr();
-								if (!arg)
+								else if (Identifier* array = getArrayArg(arg))
 								{
-									throw
-									ParseExceptMsg("Comma must be followed by expression in function call");
+									// If the callee writes to this argument,
+									// it writes to the array
+									mArrayArgs.push_back(std::make_pair(array,
+										&func->getArgIdent(currArg)));
 								}
 							}
-							else
+						}
+						
+						funcCall->addArg(arg);
+						
+						currArg++;
+						
+						if (peekAndConsume(Token::Comma))
+						{
+							col = getColNumber();
+							arg = parseExpr();
+							if (!arg)
 							{
-								break;
+								throw
+								ParseExceptMsg("Comma must be followed by expression in function call");
 							}
 						}
-					}
-					catch (ParseExcept& e)
-					{
-						reportError(e);
-						consumeUntil(Token::RParen);
-						if (peekToken() == Token::EndOfFile)
+						else
 						{
-							throw EOFExcept();
+							break;
 						}
 					}
-					
-					// Now make sure we have the correct number of arguments
-					if (!ident->isDummy())
+				}
+				catch (ParseExcept& e)
+				{
+					reportError(e);
+					consumeUntil(Token::RParen);
+					if (peekToken() == Token::EndOfFile)
 					{
-						// Special case for printf
-						if (ident->getName() == "printf")
-						{
-							if (funcCall->getNumArgs() == 0)
-							{
-								reportSemantError("printf requires a minimum of one argument");
-							}
-						}
-						else if (mCheckSemant && funcCall->getNumArgs() < func->getNumArgs())
+						throw EOFExcept();
+					}
+				}
+				
+				// Now make sure we have the correct number of arguments
+				if (!ident->isDummy())
+				{
+					// Special case for printf
+					if (ident->getName() == "printf")
+					{
+						if (funcCall->getNumArgs() == 0)
 						{
-							std::string err("Function ");
-							err += ident->getName();
-							err += " requires ";
-							std::ostringstream ss;
-							ss << func->getNumArgs();
-							err += ss.str();
-							err += " arguments";
-							reportSemantError(err);
+							reportSemantError("printf requires a minimum of one argument");
 						}
 					}
-					
-					matchToken(Token::RParen);
+					else if (mCheckSemant && funcCall->getNumArgs() < func->getNumArgs())
+					{
+						std::string err("Function ");
+						err += ident->getName();
+						err += " requires ";
+						std::ostringstream ss;
+						ss << func->getNumArgs();
+						err += ss.str();
+						err += " arguments";
+						reportSemantError(err);
+					}
 				}
+				
+				matchToken(Token::RParen);
 			}
-			else
-			{
-				// Just a plain old ident
-				retVal = make_shared<ASTIdentExpr>(*ident);
-			}
+		}
+		else
+		{
+			// Just a plain old ident
+			retVal = mArena.make<ASTIdentExpr>(*ident);
 		}
 	}
 
@@ -665,14 +641,14 @@ shared_ptr<ASTExpr> Parser::parseIdentFactor()
 }
 
 // ++ id
-shared_ptr<ASTExpr> Parser::parseIncFactor()
+ASTExpr* Parser::parseIncFactor()
 {
-	shared_ptr<ASTExpr> retVal;
+	ASTExpr* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Inc))
 	{
-		retVal = make_shared<ASTIncExpr>(*getVariable(getTokenTxt()));
+		retVal = mArena.make<ASTIncExpr>(*getVariable(getTokenTxt()));
 		matchToken(Token::Identifier);
 	}
 
@@ -683,14 +659,14 @@ shared_ptr<ASTExpr> Parser::parseIncFactor()
 }
 
 // -- id
-shared_ptr<ASTExpr> Parser::parseDecFactor()
+ASTExpr* Parser::parseDecFactor()
 {
-	shared_ptr<ASTExpr> retVal;
+	ASTExpr* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Dec))
 	{
-		retVal = make_shared<ASTDecExpr>(*getVariable(getTokenTxt()));
+		retVal = mArena.make<ASTDecExpr>(*getVariable(getTokenTxt()));
 		matchToken(Token::Identifier);
 	}
 
@@ -701,9 +677,9 @@ shared_ptr<ASTExpr> Parser::parseDecFactor()
 }
 
 // & id [ Expr ]
-shared_ptr<ASTExpr> Parser::parseAddrOfArrayFactor()
+ASTExpr* Parser::parseAddrOfArrayFactor()
 {
-	shared_ptr<ASTExpr> retVal;
+	ASTExpr* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Addr))
@@ -717,7 +693,7 @@ shared_ptr<ASTExpr> Parser::parseAddrOfArrayFactor()
 		if (!expr)
 			throw ParseExceptMsg("Missing required subscript expression.");
 		matchToken(Token::RBracket);
-		retVal = make_shared<ASTAddrOfArray>(make_shared<ASTArraySub>(*ident, expr));
+		retVal = mArena.make<ASTAddrOfArray>(mArena.make<ASTArraySub>(*ident, expr));
 	}
 	
 	return retVal;
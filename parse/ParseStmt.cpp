@@ -19,12 +19,10 @@
 using namespace uscc::parse;
 using namespace uscc::scan;
 
-using std::shared_ptr;
-using std::make_shared;
 
-shared_ptr<ASTDecl> Parser::parseDecl()
+ASTDecl* Parser::parseDecl()
 {
-	shared_ptr<ASTDecl> retVal;
+	ASTDecl* retVal = nullptr;
 	// A decl MUST start with int or char
 	if (peekIsOneOf({Token::Key_int, Token::Key_char}))
 	{
@@ -63,7 +61,7 @@ shared_ptr<ASTDecl> Parser::parseDecl()
 			// Is this an array declaration?
 			if (peekAndConsume(Token::LBracket))
 			{
-				shared_ptr<ASTConstantExpr> constExpr;
+				ASTConstantExpr* constExpr = nullptr;
 				if (declType == Type::Int)
 				{
 					declType = Type::IntArray;
@@ -118,11 +116,11 @@ shared_ptr<ASTDecl> Parser::parseDecl()
 			
 			ident->setType(declType);
 			
-			shared_ptr<ASTExpr> assignExpr;
+			ASTExpr* assignExpr = nullptr;
 			
 			// Optionally, this decl may have an assignment
 			// PA2 mine
-			int col = mColNumber;
+			int col = getColNumber();
 				
 			if (peekAndConsume(Token::Assign))
 			{
@@ -157,9 +155,11 @@ shared_ptr<ASTDecl> Parser::parseDecl()
 				// If this is a character array, we need to do extra checks
 				if (ident->getType() == Type::CharArray)
 				{
-					ASTStringExpr* strExpr = dynamic_cast<ASTStringExpr*>(assignExpr.get());
+					ASTStringExpr* strExpr = dynamic_cast<ASTStringExpr*>(assignExpr);
 					if (strExpr != nullptr)
 					{
+						ident->setInitString(strExpr->getString());
+						
 						// If we have a declared size, we need to make sure
 						// there's enough room to fit the requested string.
 						// Otherwise, we need to set our size
@@ -181,7 +181,7 @@ shared_ptr<ASTDecl> Parser::parseDecl()
 			
 			matchToken(Token::SemiColon);
 			
-			retVal = make_shared<ASTDecl>(*ident, assignExpr);
+			retVal = mArena.make<ASTDecl>(*ident, assignExpr);
 		}
 		catch (ParseExcept& e)
 		{
@@ -201,16 +201,16 @@ shared_ptr<ASTDecl> Parser::parseDecl()
 			// Put in a decl here with the bogus identifier
 			// "@@error". This is so the parse will continue to the
 			// next decl, if there is one.
-			retVal = make_shared<ASTDecl>(*(ident));
+			retVal = mArena.make<ASTDecl>(*(ident));
 		}
 	}
 	
 	return retVal;
 }
 
-shared_ptr<ASTStmt> Parser::parseStmt()
+ASTStmt* Parser::parseStmt()
 {
-	shared_ptr<ASTStmt> retVal;
+	ASTStmt* retVal = nullptr;
 	try
 	{
 		// NOTE: AssignStmt HAS to go before ExprStmt!!
@@ -253,7 +253,7 @@ shared_ptr<ASTStmt> Parser::parseStmt()
 		
 		// Put in a null statement here
 		// so we can try to continue.
-		retVal = make_shared<ASTNullStmt>();
+		retVal = mArena.make<ASTNullStmt>();
 	}
 	
 	return retVal;
@@ -262,9 +262,9 @@ shared_ptr<ASTStmt> Parser::parseStmt()
 // If the compound statement is a function body, then the symbol table scope
 // change will happen at a higher level, so it shouldn't happen in
 // parseCompoundStmt.
-shared_ptr<ASTCompoundStmt> Parser::parseCompoundStmt(bool isFuncBody)
+ASTCompoundStmt* Parser::parseCompoundStmt(bool isFuncBody)
 {
-	shared_ptr<ASTCompoundStmt> retVal;
+	ASTCompoundStmt* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::LBrace))
@@ -273,8 +273,8 @@ shared_ptr<ASTCompoundStmt> Parser::parseCompoundStmt(bool isFuncBody)
 		if (!isFuncBody)
 			mSymbols.enterScope();
 
-		retVal = make_shared<ASTCompoundStmt>();
-		shared_ptr<ASTDecl> decl;
+		retVal = mArena.make<ASTCompoundStmt>(mArena);
+		ASTDecl* decl = nullptr;
 		decl = parseDecl();
 		while (decl != nullptr)
 		{
@@ -282,7 +282,8 @@ shared_ptr<ASTCompoundStmt> Parser::parseCompoundStmt(bool isFuncBody)
 			decl = parseDecl();
 		}
 
-		shared_ptr<ASTStmt> stmt, lastStmt; // preserve the last statment for check
+		ASTStmt* stmt = nullptr;
+		ASTStmt* lastStmt = nullptr; // preserve the last statment for check
 		stmt = parseStmt();
 		while (stmt != nullptr)
 		{
@@ -292,10 +293,10 @@ shared_ptr<ASTCompoundStmt> Parser::parseCompoundStmt(bool isFuncBody)
 		}
 
 		// PA2 mine
-		if (!std::dynamic_pointer_cast<ASTReturnStmt>(lastStmt) && isFuncBody)
+		if (!dynamic_cast<ASTReturnStmt*>(lastStmt) && isFuncBody)
 		{
 			if (mCurrReturnType == Type::Void)
-				retVal->addStmt(make_shared<ASTReturnStmt>(nullptr));
+				retVal->addStmt(mArena.make<ASTReturnStmt>(nullptr));
 			else
 				reportSemantError("USC requires non-void functions to end with a return");
 		}
@@ -310,12 +311,22 @@ shared_ptr<ASTCompoundStmt> Parser::parseCompoundStmt(bool isFuncBody)
 	return retVal;
 }
 
-shared_ptr<ASTStmt> Parser::parseAssignStmt()
+ASTStmt* Parser::parseAssignStmt()
 {
-	shared_ptr<ASTStmt> retVal;
-	shared_ptr<ASTArraySub> arraySub;
+	ASTStmt* retVal = nullptr;
+	ASTArraySub* arraySub = nullptr;
 	
-	if (peekToken() == Token::Identifier)
+	// Just because we got an identifier DOES NOT necessarily mean
+	// this is an assign statement.
+	// This is because there is a common left prefix between
+	// AssignStmt and an ExprStmt with statements like:
+	// id ;
+	// id [ Expr ] ;
+	// id ( FuncCallArgs ) ;
+	
+	// So... We look ahead for the =, and if there isn't one
+	// we leave the tokens for parseFactor to match.
+	if (isAssignAhead())
 	{
 		Identifier* ident = getVariable(getTokenTxt());
 		
@@ -326,13 +337,13 @@ shared_ptr<ASTStmt> Parser::parseAssignStmt()
 		{
 			try
 			{
-				shared_ptr<ASTExpr> expr = parseExpr();
+				ASTExpr* expr = parseExpr();
 				if (!expr)
 				{
 					throw ParseExceptMsg("Valid expression required inside [ ].");
 				}
 				
-				arraySub = make_shared<ASTArraySub>(*ident, expr);
+				arraySub = mArena.make<ASTArraySub>(*ident, expr);
 			}
 			catch (ParseExcept& e)
 			{
@@ -348,106 +359,83 @@ shared_ptr<ASTStmt> Parser::parseAssignStmt()
 			matchToken(Token::RBracket);
 		}
 		
-		// Just because we got an identifier DOES NOT necessarily mean
-		// this is an assign statement.
-		// This is because there is a common left prefix between
-		// AssignStmt and an ExprStmt with statements like:
-		// id ;
-		// id [ Expr ] ;
-		// id ( FuncCallArgs ) ;
+		int col = getColNumber();
+		matchToken(Token::Assign);
+		
+		ASTExpr* expr = parseExpr();
 		
-		// So... We see if the next token is a =. If it is, then this is
-		// an AssignStmt. Otherwise, we set the "unused" variables
-		// so parseFactor will later find it and be able to match
-		int col = mColNumber;
-		if (peekAndConsume(Token::Assign))
+		if (!expr)
 		{
-			shared_ptr<ASTExpr> expr = parseExpr();
-			
-			if (!expr)
+			throw ParseExceptMsg("= must be followed by an expression");
+		}
+		
+		// If we matched an array, we want to make an array assign stmt
+		if (arraySub)
+		{
+			// Make sure the type of this expression matches the declared type
+			Type subType;
+			if (arraySub->getType() == Type::IntArray)
 			{
-				throw ParseExceptMsg("= must be followed by an expression");
+				subType = Type::Int;
 			}
-			
-			// If we matched an array, we want to make an array assign stmt
-			if (arraySub)
+			else
 			{
-				// Make sure the type of this expression matches the declared type
-				Type subType;
-				if (arraySub->getType() == Type::IntArray)
-				{
-					subType = Type::Int;
-				}
-				else
-				{
-					subType = Type::Char;
-				}
-				if (mCheckSemant && subType != expr->getType())
-				{
-					// We can do a conversion if it's from int to char
-					if (subType == Type::Char &&
-						expr->getType() == Type::Int)
-					{
-						expr = intToChar(expr);
-					}
-					else
-					{
-						std::string err("Cannot assign an expression of type ");
-						err += getTypeText(expr->getType());
-						err += " to ";
-						err += getTypeText(subType);
-						reportSemantError(err, col);
-					}
-				}
-				retVal = make_shared<ASTAssignArrayStmt>(arraySub, expr);
+				subType = Type::Char;
 			}
-			else
+			if (mCheckSemant && subType != expr->getType())
 			{
-				// PA2: Check for semantic errors
-				if (ident->getType() == Type::Char)
+				// We can do a conversion if it's from int to char
+				if (subType == Type::Char &&
+					expr->getType() == Type::Int)
 				{
-					if (expr->getType() == Type::Int)
-						expr = intToChar(expr);
+					expr = intToChar(expr);
 				}
-
-				// after conversion if still not match
-				if (ident->getType() != expr->getType())
+				else
 				{
 					std::string err("Cannot assign an expression of type ");
 					err += getTypeText(expr->getType());
 					err += " to ";
-					err += getTypeText(ident->getType());
+					err += getTypeText(subType);
 					reportSemantError(err, col);
 				}
-
-				if (ident->getType() == Type::IntArray || ident->getType() == Type::CharArray)
-					reportSemantError("Reassignment of arrays is not allowed", col);
-
-				retVal = make_shared<ASTAssignStmt>(*ident, expr);
 			}
-			
-			matchToken(Token::SemiColon);
+			ident->setWrittenTo();
+			retVal = mArena.make<ASTAssignArrayStmt>(arraySub, expr);
 		}
 		else
 		{
-			// We either have an unused array, or an unused ident
-			if (arraySub)
+			// PA2: Check for semantic errors
+			if (ident->getType() == Type::Char)
 			{
-				mUnusedArray = arraySub;
+				if (expr->getType() == Type::Int)
+					expr = intToChar(expr);
 			}
-			else
+
+			// after conversion if still not match
+			if (ident->getType() != expr->getType())
 			{
-				mUnusedIdent = ident;
+				std::string err("Cannot assign an expression of type ");
+				err += getTypeText(expr->getType());
+				err += " to ";
+				err += getTypeText(ident->getType());
+				reportSemantError(err, col);
 			}
+
+			if (ident->getType() == Type::IntArray || ident->getType() == Type::CharArray)
+				reportSemantError("Reassignment of arrays is not allowed", col);
+
+			retVal = mArena.make<ASTAssignStmt>(*ident, expr);
 		}
+		
+		matchToken(Token::SemiColon);
 	}
 	
 	return retVal;
 }
 
-shared_ptr<ASTIfStmt> Parser::parseIfStmt()
+ASTIfStmt* Parser::parseIfStmt()
 {
-	shared_ptr<ASTIfStmt> retVal;
+	ASTIfStmt* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Key_if))
@@ -459,24 +447,24 @@ shared_ptr<ASTIfStmt> Parser::parseIfStmt()
 		matchToken(Token::RParen);
 
 		auto stmt = parseStmt();
-		shared_ptr<ASTStmt> elseStmt;
+		ASTStmt* elseStmt = nullptr;
 		if (peekAndConsume(Token::Key_else))
 			elseStmt = parseStmt();
-		retVal = make_shared<ASTIfStmt>(expr, stmt, elseStmt);
+		retVal = mArena.make<ASTIfStmt>(expr, stmt, elseStmt);
 	}
 	
 	return retVal;
 }
 
-shared_ptr<ASTWhileStmt> Parser::parseWhileStmt()
+ASTWhileStmt* Parser::parseWhileStmt()
 {
-	shared_ptr<ASTWhileStmt> retVal;
+	ASTWhileStmt* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Key_while))
 	{
-		shared_ptr<ASTExpr> expr;
-		shared_ptr<ASTStmt> stmt;
+		ASTExpr* expr = nullptr;
+		ASTStmt* stmt = nullptr;
 		matchToken(Token::LParen);
 		expr = parseExpr();
 		if (!expr)
@@ -484,22 +472,22 @@ shared_ptr<ASTWhileStmt> Parser::parseWhileStmt()
 		matchToken(Token::RParen);
 
 		stmt = parseStmt();
-		retVal = make_shared<ASTWhileStmt>(expr, stmt);
+		retVal = mArena.make<ASTWhileStmt>(expr, stmt);
 	}
 	
 	return retVal;
 }
 
-shared_ptr<ASTReturnStmt> Parser::parseReturnStmt()
+ASTReturnStmt* Parser::parseReturnStmt()
 {
-	shared_ptr<ASTReturnStmt> retVal;
+	ASTReturnStmt* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::Key_return))
 	{
 		if (peekIsOneOf({Token::SemiColon}))
 		{
-			retVal = make_shared<ASTReturnStmt>(nullptr);
+			retVal = mArena.make<ASTReturnStmt>(nullptr);
 
 			// PA2 mine
 			if (mCurrReturnType != Type::Void)
@@ -509,7 +497,7 @@ shared_ptr<ASTReturnStmt> Parser::parseReturnStmt()
 		else
 		{
 			// PA2 mine
-			int col = mColNumber;
+			int col = getColNumber();
 			auto expr = parseExpr();
 			
 			// PA2 mine
@@ -528,7 +516,7 @@ shared_ptr<ASTReturnStmt> Parser::parseReturnStmt()
 				reportSemantError(err, col);
 			}
 
-			retVal = make_shared<ASTReturnStmt>(expr);
+			retVal = mArena.make<ASTReturnStmt>(expr);
 			matchToken(Token::SemiColon);
 		}
 	}
@@ -536,28 +524,28 @@ shared_ptr<ASTReturnStmt> Parser::parseReturnStmt()
 	return retVal;
 }
 
-shared_ptr<ASTExprStmt> Parser::parseExprStmt()
+ASTExprStmt* Parser::parseExprStmt()
 {
-	shared_ptr<ASTExprStmt> retVal;
+	ASTExprStmt* retVal = nullptr;
 	
 	// PA1: Implement
 	auto e = parseExpr();
 	if (e)
 	{
-		retVal = make_shared<ASTExprStmt>(e);
+		retVal = mArena.make<ASTExprStmt>(e);
 		matchToken(Token::SemiColon);
 	}
 	
 	return retVal;
 }
 
-shared_ptr<ASTNullStmt> Parser::parseNullStmt()
+ASTNullStmt* Parser::parseNullStmt()
 {
-	shared_ptr<ASTNullStmt> retVal;
+	ASTNullStmt* retVal = nullptr;
 	
 	// PA1: Implement
 	if (peekAndConsume(Token::SemiColon))
-		retVal = make_shared<ASTNullStmt>();
+		retVal = mArena.make<ASTNullStmt>();
 	
 	return retVal;
 }
@@ -29,14 +29,17 @@
 
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <new>
 #include <ostream>
+#include <type_traits>
 
 using namespace uscc::parse;
 
-llvm::Type* Identifier::llvmType(bool treatArrayAsPtr /* = true */) noexcept
+llvm::Type* Identifier::llvmType(llvm::LLVMContext& context,
+								 bool treatArrayAsPtr /* = true */) noexcept
 {
 	llvm::Type* type = nullptr;
-	llvm::LLVMContext& context = llvm::getGlobalContext();
 	switch (mType)
 	{
 		case Type::Char:
@@ -118,8 +121,107 @@ void Identifier::writeTo(CodeContext& ctx, llvm::Value* value) noexcept
 	// }
 }
 
+bool Identifier::isReadOnlyString() const noexcept
+{
+	// A declared size with room to spare means the rest of the
+	// array is for the program to fill in
+	return mInitString != nullptr && !mWrittenTo &&
+		mArrayCount == mInitString->getText().size() + 1;
+}
+
+// Number of identifiers in each slab
+static const size_t kSlabSize = 256;
+
+NameTable::NameTable() noexcept
+: mSlots(64, 0)
+{ }
+
+// FNV-1a
+static uint32_t hashName(const char* name, size_t len) noexcept
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+	{
+		hash ^= static_cast<unsigned char>(name[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Returns the atom for this name, adding it if it's new
+NameTable::Atom NameTable::intern(const char* name)
+{
+	size_t len = std::strlen(name);
+	uint32_t hash = hashName(name, len);
+	size_t slot = findSlot(name, len, hash);
+	if (mSlots[slot] != 0)
+	{
+		return mSlots[slot] - 1;
+	}
+	
+	Atom atom = static_cast<Atom>(mNames.size());
+	mNames.emplace_back(name, len);
+	mHashes.push_back(hash);
+	mSlots[slot] = atom + 1;
+	
+	// Keep the load factor under 1/2
+	if (mNames.size() * 2 > mSlots.size())
+	{
+		grow();
+	}
+	
+	return atom;
+}
+
+// Returns the atom for this name, or kNoAtom if the name
+// has never been interned
+NameTable::Atom NameTable::find(const char* name) const noexcept
+{
+	size_t len = std::strlen(name);
+	size_t slot = findSlot(name, len, hashName(name, len));
+	return mSlots[slot] - 1;
+}
+
+// Returns the slot that holds this name, or the empty
+// slot where it would go
+size_t NameTable::findSlot(const char* name, size_t len, uint32_t hash) const noexcept
+{
+	size_t mask = mSlots.size() - 1;
+	size_t slot = hash & mask;
+	while (mSlots[slot] != 0)
+	{
+		Atom atom = mSlots[slot] - 1;
+		if (mHashes[atom] == hash && mNames[atom].size() == len &&
+			std::memcmp(mNames[atom].data(), name, len) == 0)
+		{
+			break;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+// Doubles the number of slots and rehashes
+void NameTable::grow()
+{
+	std::vector<uint32_t> slots(mSlots.size() * 2, 0);
+	size_t mask = slots.size() - 1;
+	for (Atom atom = 0; atom < mNames.size(); atom++)
+	{
+		size_t slot = mHashes[atom] & mask;
+		while (slots[slot] != 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+		slots[slot] = atom + 1;
+	}
+	mSlots.swap(slots);
+}
+
 SymbolTable::SymbolTable() noexcept
 : mCurrScope(nullptr)
+, mScopeDepth(-1)
+, mSlabUsed(kSlabSize)
 {
 	// PA2: Implement
 	mCurrScope = enterScope();
@@ -134,7 +236,21 @@ SymbolTable::SymbolTable() noexcept
 SymbolTable::~SymbolTable() noexcept
 {
 	// PA2: Implement
-	delete mCurrScope;
+	// (Deleting the global scope deletes all of its children)
+	ScopeTable* root = mCurrScope;
+	while (root && root->getParent())
+	{
+		root = root->getParent();
+	}
+	delete root;
+	
+	// Identifiers are trivially destructible, so just free the slabs
+	static_assert(std::is_trivially_destructible<Identifier>::value,
+				  "Identifier slabs don't run destructors");
+	for (auto slab : mSlabs)
+	{
+		::operator delete(slab);
+	}
 }
 
 // Returns true if this variable is already declared
@@ -144,7 +260,15 @@ SymbolTable::~SymbolTable() noexcept
 bool SymbolTable::isDeclaredInScope(const char* name) const noexcept
 {
 	// PA2: Implement
-	return mCurrScope->searchInScope(name) != nullptr;
+	NameTable::Atom atom = mNames.find(name);
+	if (atom == NameTable::kNoAtom || atom >= mBindings.size())
+	{
+		return false;
+	}
+	
+	// The innermost declaration is the only one that can be in this scope
+	Identifier* ident = mBindings[atom];
+	return ident != nullptr && ident->mScopeDepth == mScopeDepth;
 }
 
 // Creates the requested identifier, and returns a pointer
@@ -153,11 +277,26 @@ bool SymbolTable::isDeclaredInScope(const char* name) const noexcept
 // This means you should first check with isDeclaredInScope.
 Identifier* SymbolTable::createIdentifier(const char* name)
 {
-	Identifier* ident = new Identifier(name);
+	NameTable::Atom atom = mNames.intern(name);
+	Identifier* ident = newIdentifier(atom);
+	
+	if (atom >= mBindings.size())
+	{
+		mBindings.resize(mNames.size(), nullptr);
+	}
 	
 	// PA2: Add to current scope table
-	if (!isDeclaredInScope(name))	
+	// (unless it's a redeclaration in this scope)
+	Identifier* prev = mBindings[atom];
+	if (prev == nullptr || prev->mScopeDepth != mScopeDepth)
+	{
+		// Push it on this name's shadow stack
+		ident->mScopeDepth = mScopeDepth;
+		ident->mShadowed = prev;
+		mBindings[atom] = ident;
+		
 		mCurrScope->addIdentifier(ident);
+	}
 
 	return ident;
 }
@@ -167,7 +306,13 @@ Identifier* SymbolTable::createIdentifier(const char* name)
 Identifier* SymbolTable::getIdentifier(const char* name)
 {
 	// PA2: Implement properly
-	return mCurrScope->search(name);
+	NameTable::Atom atom = mNames.find(name);
+	if (atom == NameTable::kNoAtom || atom >= mBindings.size())
+	{
+		return nullptr;
+	}
+	
+	return mBindings[atom];
 }
 
 // Enters a new scope, and returns a pointer to this scope table
@@ -175,6 +320,7 @@ SymbolTable::ScopeTable* SymbolTable::enterScope()
 {
 	// PA2: Implement
 	mCurrScope = new ScopeTable(mCurrScope);
+	mScopeDepth++;
 	return mCurrScope;
 }
 
@@ -193,7 +339,30 @@ void SymbolTable::print(std::ostream& output) const noexcept
 void SymbolTable::exitScope()
 {
 	// PA2: Implement
+	// Pop this scope's declarations off their shadow stacks
+	const std::vector<Identifier*>& symbols = mCurrScope->getSymbols();
+	for (auto iter = symbols.rbegin(); iter != symbols.rend(); ++iter)
+	{
+		mBindings[(*iter)->mAtom] = (*iter)->mShadowed;
+	}
+	
 	mCurrScope = mCurrScope->getParent();
+	mScopeDepth--;
+}
+
+// Allocates a new identifier from the slab
+Identifier* SymbolTable::newIdentifier(NameTable::Atom atom)
+{
+	if (mSlabUsed == kSlabSize)
+	{
+		mSlabs.push_back(static_cast<Identifier*>(
+			::operator new(kSlabSize * sizeof(Identifier))));
+		mSlabUsed = 0;
+	}
+	
+	Identifier* ident = mSlabs.back() + mSlabUsed;
+	mSlabUsed++;
+	return new (ident) Identifier(mNames.getName(atom), atom);
 }
 
 SymbolTable::ScopeTable::ScopeTable(ScopeTable* parent) noexcept
@@ -215,40 +384,15 @@ SymbolTable::ScopeTable::~ScopeTable() noexcept
 void SymbolTable::ScopeTable::addIdentifier(Identifier* ident)
 {
 	// PA2: Implement
-	mSymbols.emplace(ident->getName(), ident);
-}
-
-// Searches this scope for an identifier with
-// the requested name. Returns nullptr if not found.
-Identifier* SymbolTable::ScopeTable::searchInScope(const char* name) noexcept
-{
-	// PA2: Implement
-	auto search = mSymbols.find(name);
-	if (search != mSymbols.end())
-		return search->second;
-	return nullptr;
-}
-
-// Searches this scope first, and if not found searches
-// through parent scopes. Returns nullptr if not found.
-Identifier* SymbolTable::ScopeTable::search(const char* name) noexcept
-{
-	// PA2: Implement
-	auto ret = searchInScope(name);
-	if (ret)
-		return ret;
-	if (mParent)
-		return mParent->search(name);
-	return nullptr;
+	mSymbols.push_back(ident);
 }
 
 void SymbolTable::ScopeTable::emitIR(CodeContext& ctx)
 {
 	// The ONLY thing we should alloca now are arrays of a specified size
 	// First emit all the symbols in this scope
-	for (auto sym : mSymbols)
+	for (auto ident : mSymbols)
 	{
-		Identifier* ident = sym.second;
 		llvm::IRBuilder<> build(ctx.mBlock);
 
 		llvm::Value* decl = nullptr;
@@ -257,9 +401,20 @@ void SymbolTable::ScopeTable::emitIR(CodeContext& ctx)
 		
 		// It's -1 if it's an array that's passed into a function,
 		// in which case we don't allocate it
-		if (ident->isArray() && ident->getArrayCount() != -1)
+		if (ident->isReadOnlyString())
+		{
+			// Reads come straight from the string constant, so
+			// there's nothing to allocate (or copy into)
+			std::vector<llvm::Value*> gepIdx;
+			gepIdx.push_back(ctx.mZero);
+			gepIdx.push_back(ctx.mZero);
+			
+			decl = build.CreateInBoundsGEP(ident->getInitString()->getValue(), gepIdx);
+			ident->writeTo(ctx, decl);
+		}
+		else if (ident->isArray() && ident->getArrayCount() != -1)
 		{
-			llvm::Type* type = ident->llvmType(false);
+			llvm::Type* type = ident->llvmType(ctx.mGlobal, false);
 			// Note we pass in "nullptr" for the array size because that's
 			// handled by the type
 			decl = build.CreateAlloca(type, nullptr, name);
@@ -287,11 +442,7 @@ void SymbolTable::ScopeTable::emitIR(CodeContext& ctx)
 // Prints the scope table to the specified stream
 void SymbolTable::ScopeTable::print(std::ostream& output, int depth) const noexcept
 {
-	std::vector<Identifier*> idents;
-	for (const auto& sym : mSymbols)
-	{
-		idents.push_back(sym.second);
-	}
+	std::vector<Identifier*> idents(mSymbols);
 
 	std::sort(idents.begin(), idents.end(), [](Identifier* a, Identifier* b) {
 		return a->getName() < b->getName();
@@ -14,10 +14,12 @@
 //---------------------------------------------------------
 
 #pragma once
+#include <cstdint>
 #include <string>
-#include <memory>
 #include <unordered_map>
+#include <deque>
 #include <list>
+#include <vector>
 
 #include "Types.h"
 
@@ -25,6 +27,7 @@ namespace llvm
 {
 	class Value;
 	class Type;
+	class LLVMContext;
 }
 
 namespace uscc
@@ -33,8 +36,51 @@ namespace parse
 {
 
 class ASTFunction;
+class ConstStr;
 struct CodeContext;
 
+// Interns identifier names, so each distinct name is stored
+// once and maps to a small dense integer (an atom)
+class NameTable
+{
+public:
+	typedef uint32_t Atom;
+	static const Atom kNoAtom = 0xffffffff;
+	
+	NameTable() noexcept;
+	
+	// Returns the atom for this name, adding it if it's new
+	Atom intern(const char* name);
+	
+	// Returns the atom for this name, or kNoAtom if the name
+	// has never been interned
+	Atom find(const char* name) const noexcept;
+	
+	const std::string& getName(Atom atom) const noexcept
+	{
+		return mNames[atom];
+	}
+	
+	size_t size() const noexcept
+	{
+		return mNames.size();
+	}
+private:
+	// Returns the slot that holds this name, or the empty
+	// slot where it would go
+	size_t findSlot(const char* name, size_t len, uint32_t hash) const noexcept;
+	
+	// Doubles the number of slots and rehashes
+	void grow();
+	
+	// Indexed by atom (a deque so references stay valid)
+	std::deque<std::string> mNames;
+	std::vector<uint32_t> mHashes;
+	
+	// Open-addressed hash of atom + 1 (0 is an empty slot)
+	std::vector<uint32_t> mSlots;
+};
+
 // An identifier is constructed per each entry in the symbol table
 class Identifier
 {
@@ -69,18 +115,44 @@ public:
 				mType == Type::IntArray);
 	}
 	
+	// For char arrays declared with a string literal
+	void setInitString(ConstStr* str) noexcept
+	{
+		mInitString = str;
+	}
+	ConstStr* getInitString() const noexcept
+	{
+		return mInitString;
+	}
+	
+	// Marks an array whose elements are assigned to, or that's
+	// passed to a function that may assign to them
+	void setWrittenTo() noexcept
+	{
+		mWrittenTo = true;
+	}
+	bool isWrittenTo() const noexcept
+	{
+		return mWrittenTo;
+	}
+	
+	// Returns true if this array is initialized with a string literal
+	// that fills it, and never written to. Such an array doesn't need a
+	// copy of the string, it can just read the string constant.
+	bool isReadOnlyString() const noexcept;
+	
 	// For function identifiers
 	bool isFunction() const noexcept
 	{
 		return mType == Type::Function;
 	}
 	
-	std::shared_ptr<ASTFunction> getFunction() const noexcept
+	ASTFunction* getFunction() const noexcept
 	{
 		return mFunctionNode;
 	}
 	
-	void setFunction(std::shared_ptr<ASTFunction> func) noexcept
+	void setFunction(ASTFunction* func) noexcept
 	{
 		mFunctionNode = func;
 	}
@@ -100,7 +172,7 @@ public:
 		mAddress = value;
 	}
 	
-	llvm::Type* llvmType(bool treatArrayAsPtr = true) noexcept;
+	llvm::Type* llvmType(llvm::LLVMContext& context, bool treatArrayAsPtr = true) noexcept;
 	
 	llvm::Value* readFrom(CodeContext& ctx) noexcept;
 	
@@ -108,19 +180,35 @@ public:
 	
 private:
 	// Private constructor so only the symbol table can create
-	Identifier(const char* name)
+	Identifier(const std::string& name, NameTable::Atom atom)
 	: mName(name)
+	, mAtom(atom)
+	, mScopeDepth(-1)
+	, mShadowed(nullptr)
 	, mFunctionNode(nullptr)
 	, mAddress(nullptr)
 	, mType(Type::Void)
 	, mArrayCount(-1)
+	, mInitString(nullptr)
+	, mWrittenTo(false)
 	{ }
 	
-	std::string mName;
-	std::shared_ptr<ASTFunction> mFunctionNode;
+	// Interned name
+	const std::string& mName;
+	NameTable::Atom mAtom;
+	
+	// Nesting depth of the scope this identifier is declared in,
+	// and the declaration of the same name it hides while that
+	// scope is active
+	int mScopeDepth;
+	Identifier* mShadowed;
+	
+	ASTFunction* mFunctionNode;
 	llvm::Value* mAddress;
 	Type mType;
 	size_t mArrayCount;
+	ConstStr* mInitString;
+	bool mWrittenTo;
 };
 
 // NOTE: I don't use shared_ptrs for the symbol table
@@ -170,14 +258,6 @@ public:
 		// Adds the requested identifier to the table
 		void addIdentifier(Identifier* ident);
 		
-		// Searches this scope for an identifier with
-		// the requested name. Returns nullptr if not found.
-		Identifier* searchInScope(const char* name) noexcept;
-		
-		// Searches this scope first, and if not found searches
-		// through parent scopes. Returns nullptr if not found.
-		Identifier* search(const char* name) noexcept;
-		
 		// Emits declarations for ALL non-function symbols
 		// in this scope. Used to front-load all stack-based variables
 		// to the start of the function
@@ -190,9 +270,16 @@ public:
 		{
 			return mParent;
 		}
+		
+		// Identifiers declared in this scope, in declaration order
+		const std::vector<Identifier*>& getSymbols() const noexcept
+		{
+			return mSymbols;
+		}
 	private:
-		// Hash table contains all the identifiers in this scope
-		std::unordered_map<std::string, Identifier*> mSymbols;
+		// All the identifiers in this scope. Lookups go through
+		// SymbolTable, this just remembers what to emit/print/pop
+		std::vector<Identifier*> mSymbols;
 		
 		// List of the child tables
 		std::list<ScopeTable*> mChildren;
@@ -202,8 +289,24 @@ public:
 	};
 	
 private:
-	// Pointer to the current scope table
+	// Allocates a new identifier from the slab
+	Identifier* newIdentifier(NameTable::Atom atom);
+	
+	// Pointer to the current scope table, and its nesting depth
 	ScopeTable* mCurrScope;
+	int mScopeDepth;
+	
+	// Interned names of every identifier
+	NameTable mNames;
+	
+	// Innermost visible declaration of each name, indexed by atom.
+	// Each entry is the top of a shadow stack, linked through
+	// Identifier::mShadowed, which exitScope pops.
+	std::vector<Identifier*> mBindings;
+	
+	// Slab storage for all identifiers
+	std::vector<Identifier*> mSlabs;
+	size_t mSlabUsed;
 };
 	
 // Used to store/reference constant strings
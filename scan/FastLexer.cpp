@@ -0,0 +1,583 @@
+//
+//  FastLexer.cpp
+//  uscc
+//
+//  Implements the memory-mapped, SIMD-assisted scanner.
+//
+//  The matching rules mirror usc.l exactly, including its
+//  quirks (for example "-5" is a single Constant token, and
+//  a "//" comment must be terminated by a newline).
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#include "FastLexer.h"
+#include <cstring>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define USCC_SIMD_LEXER 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define USCC_SIMD_LEXER 1
+#endif
+
+using namespace uscc::scan;
+
+namespace
+{
+
+#if defined(__AVX2__)
+
+typedef __m256i Vec;
+const ptrdiff_t kStride = 32;
+const uint32_t kFullMask = 0xFFFFFFFFu;
+
+inline Vec load(const char* p)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+inline Vec splat(char c)
+{
+	return _mm256_set1_epi8(c);
+}
+
+inline uint32_t eqMask(Vec v, char c)
+{
+	return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, splat(c))));
+}
+
+// Bit i is set if lo <= v[i] <= hi (as unsigned bytes)
+inline uint32_t rangeMask(Vec v, char lo, char hi)
+{
+	Vec off = _mm256_sub_epi8(v, splat(lo));
+	Vec clamped = _mm256_min_epu8(off, splat(static_cast<char>(hi - lo)));
+	return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(clamped, off)));
+}
+
+inline Vec toLower(Vec v)
+{
+	return _mm256_or_si256(v, splat(0x20));
+}
+
+#elif defined(__SSE2__)
+
+typedef __m128i Vec;
+const ptrdiff_t kStride = 16;
+const uint32_t kFullMask = 0xFFFFu;
+
+inline Vec load(const char* p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline Vec splat(char c)
+{
+	return _mm_set1_epi8(c);
+}
+
+inline uint32_t eqMask(Vec v, char c)
+{
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, splat(c))));
+}
+
+// Bit i is set if lo <= v[i] <= hi (as unsigned bytes)
+inline uint32_t rangeMask(Vec v, char lo, char hi)
+{
+	Vec off = _mm_sub_epi8(v, splat(lo));
+	Vec clamped = _mm_min_epu8(off, splat(static_cast<char>(hi - lo)));
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(clamped, off)));
+}
+
+inline Vec toLower(Vec v)
+{
+	return _mm_or_si128(v, splat(0x20));
+}
+
+#endif
+
+#if USCC_SIMD_LEXER
+// Bit i is set if p[i] is [a-zA-Z0-9_]
+inline uint32_t identMask(Vec v)
+{
+	return rangeMask(toLower(v), 'a', 'z') | rangeMask(v, '0', '9') | eqMask(v, '_');
+}
+#endif
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline bool isIdentStart(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool isIdentChar(char c)
+{
+	return isIdentStart(c) || isDigit(c);
+}
+
+// Returns the first position in [p, end) that isn't an identifier character
+const char* skipIdent(const char* p, const char* end)
+{
+#if USCC_SIMD_LEXER
+	while (end - p >= kStride)
+	{
+		uint32_t stop = ~identMask(load(p)) & kFullMask;
+		if (stop != 0)
+		{
+			return p + __builtin_ctz(stop);
+		}
+		p += kStride;
+	}
+#endif
+	while (p < end && isIdentChar(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+// Returns the first position in [p, end) that isn't a digit
+const char* skipDigits(const char* p, const char* end)
+{
+#if USCC_SIMD_LEXER
+	while (end - p >= kStride)
+	{
+		uint32_t stop = ~rangeMask(load(p), '0', '9') & kFullMask;
+		if (stop != 0)
+		{
+			return p + __builtin_ctz(stop);
+		}
+		p += kStride;
+	}
+#endif
+	while (p < end && isDigit(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+// Returns the first position in [p, end) that is either a or b,
+// or end if there is none
+const char* findEither(const char* p, const char* end, char a, char b)
+{
+#if USCC_SIMD_LEXER
+	while (end - p >= kStride)
+	{
+		Vec v = load(p);
+		uint32_t hit = eqMask(v, a) | eqMask(v, b);
+		if (hit != 0)
+		{
+			return p + __builtin_ctz(hit);
+		}
+		p += kStride;
+	}
+#endif
+	while (p < end && *p != a && *p != b)
+	{
+		++p;
+	}
+	return p;
+}
+
+// Returns the first position in [p, end) that is c, or end if there is none
+inline const char* findChar(const char* p, const char* end, char c)
+{
+	return findEither(p, end, c, c);
+}
+
+// Keyword lookup for an identifier span
+Token::Tokens keywordOrIdent(const char* p, size_t len)
+{
+	switch (len)
+	{
+		case 2:
+			if (p[0] == 'i' && p[1] == 'f')
+			{
+				return Token::Key_if;
+			}
+			break;
+		case 3:
+			if (memcmp(p, "int", 3) == 0)
+			{
+				return Token::Key_int;
+			}
+			break;
+		case 4:
+			if (memcmp(p, "char", 4) == 0)
+			{
+				return Token::Key_char;
+			}
+			else if (memcmp(p, "else", 4) == 0)
+			{
+				return Token::Key_else;
+			}
+			else if (memcmp(p, "void", 4) == 0)
+			{
+				return Token::Key_void;
+			}
+			break;
+		case 5:
+			if (memcmp(p, "while", 5) == 0)
+			{
+				return Token::Key_while;
+			}
+			break;
+		case 6:
+			if (memcmp(p, "return", 6) == 0)
+			{
+				return Token::Key_return;
+			}
+			break;
+		default:
+			break;
+	}
+
+	return Token::Identifier;
+}
+
+} // anonymous
+
+FastLexer::FastLexer(const char* fileName)
+: mBegin(nullptr)
+, mEnd(nullptr)
+, mPos(nullptr)
+, mLineStart(nullptr)
+, mLineNumber(1)
+, mTokStart(nullptr)
+, mTokLen(0)
+, mTokLine(1)
+, mTokCol(1)
+, mTokTxtValid(false)
+, mMapping(nullptr)
+, mMapSize(0)
+{
+#ifndef _WIN32
+	int fd = open(fileName, O_RDONLY);
+	if (fd != -1)
+	{
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+		{
+			mMapSize = static_cast<size_t>(st.st_size);
+			if (mMapSize == 0)
+			{
+				// mmap rejects empty mappings
+				mBegin = "";
+			}
+			else
+			{
+				void* mapping = mmap(nullptr, mMapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapping != MAP_FAILED)
+				{
+					madvise(mapping, mMapSize, MADV_SEQUENTIAL);
+					mMapping = mapping;
+					mBegin = static_cast<const char*>(mapping);
+				}
+			}
+		}
+		close(fd);
+	}
+#else
+	std::ifstream file(fileName, std::ios::in | std::ios::binary);
+	if (file.is_open())
+	{
+		mBuffer.assign(std::istreambuf_iterator<char>(file),
+					   std::istreambuf_iterator<char>());
+		mMapSize = mBuffer.size();
+		mBegin = mBuffer.empty() ? "" : mBuffer.data();
+	}
+#endif
+
+	if (mBegin)
+	{
+		mEnd = mBegin + mMapSize;
+		mPos = mBegin;
+		mLineStart = mBegin;
+	}
+}
+
+FastLexer::~FastLexer()
+{
+#ifndef _WIN32
+	if (mMapping)
+	{
+		munmap(mMapping, mMapSize);
+	}
+#endif
+}
+
+Token::Tokens FastLexer::nextToken()
+{
+	skipTrivia();
+
+	mTokStart = mPos;
+	mTokLine = mLineNumber;
+	mTokCol = static_cast<unsigned int>(mPos - mLineStart) + 1;
+	mTokTxtValid = false;
+
+	Token::Tokens token = Token::EndOfFile;
+	mTokLen = 0;
+	if (mPos < mEnd)
+	{
+		token = scanToken(mTokLen);
+		mPos += mTokLen;
+	}
+
+	return token;
+}
+
+const char* FastLexer::getTokenTxt() const noexcept
+{
+	if (!mTokTxtValid)
+	{
+		mTokTxt.assign(mTokStart, mTokLen);
+		mTokTxtValid = true;
+	}
+
+	return mTokTxt.c_str();
+}
+
+// Skips white space, newlines and comments,
+// updating the line count as it goes
+void FastLexer::skipTrivia() noexcept
+{
+	const char* p = mPos;
+	while (p < mEnd)
+	{
+#if USCC_SIMD_LEXER
+		// Consume whole blocks of ' ', '\t' and '\n'
+		while (mEnd - p >= kStride)
+		{
+			Vec v = load(p);
+			uint32_t newlines = eqMask(v, '\n');
+			uint32_t blank = eqMask(v, ' ') | eqMask(v, '\t') | newlines;
+			uint32_t stop = ~blank & kFullMask;
+			uint32_t skipped = stop ? __builtin_ctz(stop) : static_cast<uint32_t>(kStride);
+
+			// Only count the newlines in the skipped prefix
+			if (skipped < 32)
+			{
+				newlines &= (1u << skipped) - 1;
+			}
+			if (newlines != 0)
+			{
+				mLineNumber += __builtin_popcount(newlines);
+				mLineStart = p + (31 - __builtin_clz(newlines)) + 1;
+			}
+
+			p += skipped;
+			if (stop != 0)
+			{
+				break;
+			}
+		}
+		if (p >= mEnd)
+		{
+			break;
+		}
+#endif
+		char c = *p;
+		if (c == ' ' || c == '\t')
+		{
+			++p;
+		}
+		else if (c == '\n')
+		{
+			++p;
+			mLineNumber++;
+			mLineStart = p;
+		}
+		else if (c == '\r' && p + 1 < mEnd && p[1] == '\n')
+		{
+			p += 2;
+			mLineNumber++;
+			mLineStart = p;
+		}
+		else if (c == '/' && p + 1 < mEnd && p[1] == '/')
+		{
+			// A comment only counts if it's terminated by a newline,
+			// otherwise it scans as two Divs
+			const char* nl = findChar(p + 2, mEnd, '\n');
+			if (nl == mEnd)
+			{
+				break;
+			}
+			p = nl + 1;
+			mLineNumber++;
+			mLineStart = p;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	mPos = p;
+}
+
+// Scans the token starting at mPos, and returns its
+// type and length
+Token::Tokens FastLexer::scanToken(size_t& len) const noexcept
+{
+	const char* p = mPos;
+	char next = (p + 1 < mEnd) ? p[1] : '\0';
+
+	len = 1;
+	switch (*p)
+	{
+		case '=':
+			if (next == '=')
+			{
+				len = 2;
+				return Token::EqualTo;
+			}
+			return Token::Assign;
+		case '+':
+			if (next == '+')
+			{
+				len = 2;
+				return Token::Inc;
+			}
+			return Token::Plus;
+		case '-':
+			if (next == '-')
+			{
+				len = 2;
+				return Token::Dec;
+			}
+			else if (next == '0')
+			{
+				len = 2;
+				return Token::Constant;
+			}
+			else if (isDigit(next))
+			{
+				len = skipDigits(p + 1, mEnd) - p;
+				return Token::Constant;
+			}
+			return Token::Minus;
+		case '*':
+			return Token::Mult;
+		case '/':
+			return Token::Div;
+		case '%':
+			return Token::Mod;
+		case '[':
+			return Token::LBracket;
+		case ']':
+			return Token::RBracket;
+		case '!':
+			if (next == '=')
+			{
+				len = 2;
+				return Token::NotEqual;
+			}
+			return Token::Not;
+		case '|':
+			if (next == '|')
+			{
+				len = 2;
+				return Token::Or;
+			}
+			return Token::Unknown;
+		case '&':
+			if (next == '&')
+			{
+				len = 2;
+				return Token::And;
+			}
+			return Token::Addr;
+		case '<':
+			return Token::LessThan;
+		case '>':
+			return Token::GreaterThan;
+		case '(':
+			return Token::LParen;
+		case ')':
+			return Token::RParen;
+		case ';':
+			return Token::SemiColon;
+		case '{':
+			return Token::LBrace;
+		case '}':
+			return Token::RBrace;
+		case ',':
+			return Token::Comma;
+		case '\'':
+			// '\t', '\n' or any single character but a newline
+			if (mEnd - p >= 4 && next == '\\' && (p[2] == 't' || p[2] == 'n') &&
+				p[3] == '\'')
+			{
+				len = 4;
+				return Token::Constant;
+			}
+			else if (mEnd - p >= 3 && next != '\n' && p[2] == '\'')
+			{
+				len = 3;
+				return Token::Constant;
+			}
+			return Token::Unknown;
+		case '"':
+		{
+			// Anything but \ or ", plus the escapes \n and \t
+			const char* q = p + 1;
+			while (true)
+			{
+				q = findEither(q, mEnd, '"', '\\');
+				if (q == mEnd)
+				{
+					return Token::Unknown;
+				}
+				else if (*q == '"')
+				{
+					len = q + 1 - p;
+					return Token::String;
+				}
+				else if (q + 1 < mEnd && (q[1] == 'n' || q[1] == 't'))
+				{
+					q += 2;
+				}
+				else
+				{
+					return Token::Unknown;
+				}
+			}
+		}
+		case '0':
+			return Token::Constant;
+		default:
+			if (isDigit(*p))
+			{
+				len = skipDigits(p + 1, mEnd) - p;
+				return Token::Constant;
+			}
+			else if (isIdentStart(*p))
+			{
+				len = skipIdent(p + 1, mEnd) - p;
+				return keywordOrIdent(p, len);
+			}
+			return Token::Unknown;
+	}
+}
@@ -0,0 +1,102 @@
+//
+//  FastLexer.h
+//  uscc
+//
+//  Declares a hand-written scanner that works directly on
+//  a memory-mapped copy of the source file. It produces the
+//  same tokens as the flex scanner generated from usc.l, but
+//  classifies runs of white space, identifier characters,
+//  digits and comment text 16 (SSE2) or 32 (AVX2) bytes at
+//  a time.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#pragma once
+
+#include "Lexer.h"
+#include <string>
+#include <vector>
+
+namespace uscc
+{
+namespace scan
+{
+
+class FastLexer : public Lexer
+{
+public:
+	FastLexer(const char* fileName);
+	virtual ~FastLexer();
+
+	// Returns false if the file could not be opened/mapped
+	bool isOpen() const noexcept
+	{
+		return mBegin != nullptr;
+	}
+
+	virtual Token::Tokens nextToken() override;
+	virtual const char* getTokenTxt() const noexcept override;
+
+	virtual size_t getTokenLen() const noexcept override
+	{
+		return mTokLen;
+	}
+
+	virtual unsigned int getLine() const noexcept override
+	{
+		return mTokLine;
+	}
+
+	virtual unsigned int getCol() const noexcept override
+	{
+		return mTokCol;
+	}
+private:
+	// Disallow copy/assignment
+	FastLexer(const FastLexer& copy);
+	FastLexer& operator=(const FastLexer& rhs);
+
+	// Skips white space, newlines and comments,
+	// updating the line count as it goes
+	void skipTrivia() noexcept;
+
+	// Scans the token starting at mPos, and returns its
+	// type and length
+	Token::Tokens scanToken(size_t& len) const noexcept;
+
+	// Bounds of the mapped file
+	const char* mBegin;
+	const char* mEnd;
+
+	// Current scan position
+	const char* mPos;
+
+	// Start of the current line (for column numbers)
+	const char* mLineStart;
+	unsigned int mLineNumber;
+
+	// Current token
+	const char* mTokStart;
+	size_t mTokLen;
+	unsigned int mTokLine;
+	unsigned int mTokCol;
+
+	// The mapped file isn't null-terminated, so the token text is
+	// copied here the first time it's requested
+	mutable std::string mTokTxt;
+	mutable bool mTokTxtValid;
+
+	// mmap bookkeeping (or a plain buffer where mmap is unavailable)
+	void* mMapping;
+	size_t mMapSize;
+	std::vector<char> mBuffer;
+};
+
+} // scan
+} // uscc
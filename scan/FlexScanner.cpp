@@ -0,0 +1,74 @@
+//
+//  FlexScanner.cpp
+//  uscc
+//
+//  Implements the Lexer interface on top of yyFlexLexer.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#include "FlexScanner.h"
+#include <FlexLexer.h>
+
+using namespace uscc::scan;
+
+FlexScanner::FlexScanner(std::istream* input)
+: mLexer(new yyFlexLexer(input))
+, mLineNumber(1)
+, mColNumber(1)
+, mTokLine(1)
+, mTokCol(1)
+{
+
+}
+
+FlexScanner::~FlexScanner()
+{
+	delete mLexer;
+}
+
+Token::Tokens FlexScanner::nextToken()
+{
+	Token::Tokens token;
+
+	while (true)
+	{
+		token = static_cast<Token::Tokens>(mLexer->yylex());
+		if (token == Token::Newline || token == Token::Comment)
+		{
+			mLineNumber++;
+			mColNumber = 1;
+		}
+		else if (token == Token::Space || token == Token::Tab)
+		{
+			mColNumber++;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	mTokLine = mLineNumber;
+	mTokCol = mColNumber;
+
+	// Move past this token
+	mColNumber += mLexer->YYLeng();
+
+	return token;
+}
+
+const char* FlexScanner::getTokenTxt() const noexcept
+{
+	return mLexer->YYText();
+}
+
+size_t FlexScanner::getTokenLen() const noexcept
+{
+	return mLexer->YYLeng();
+}
@@ -0,0 +1,67 @@
+//
+//  FlexScanner.h
+//  uscc
+//
+//  Adapts the flex-generated yyFlexLexer to the Lexer
+//  interface. White space, newline and comment tokens are
+//  consumed here to keep track of the line/column.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#pragma once
+
+#include "Lexer.h"
+#include <istream>
+
+class yyFlexLexer;
+
+namespace uscc
+{
+namespace scan
+{
+
+class FlexScanner : public Lexer
+{
+public:
+	// The stream must outlive the scanner
+	FlexScanner(std::istream* input);
+	virtual ~FlexScanner();
+
+	virtual Token::Tokens nextToken() override;
+	virtual const char* getTokenTxt() const noexcept override;
+	virtual size_t getTokenLen() const noexcept override;
+
+	virtual unsigned int getLine() const noexcept override
+	{
+		return mTokLine;
+	}
+
+	virtual unsigned int getCol() const noexcept override
+	{
+		return mTokCol;
+	}
+private:
+	// Disallow copy/assignment
+	FlexScanner(const FlexScanner& copy);
+	FlexScanner& operator=(const FlexScanner& rhs);
+
+	// Flex wrapper class
+	yyFlexLexer* mLexer;
+
+	// Line/column of the next character flex will scan
+	unsigned int mLineNumber;
+	unsigned int mColNumber;
+
+	// Line/column of the current token
+	unsigned int mTokLine;
+	unsigned int mTokCol;
+};
+
+} // scan
+} // uscc
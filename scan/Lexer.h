@@ -0,0 +1,57 @@
+//
+//  Lexer.h
+//  uscc
+//
+//  Declares the scanner interface used by the parser.
+//
+//  There are two implementations: FlexScanner, which wraps the
+//  flex-generated yyFlexLexer, and FastLexer, which scans a
+//  memory-mapped copy of the file directly.
+//
+//  Unlike yylex(), nextToken() never returns whitespace,
+//  newlines or comments. The scanner tracks the line/column
+//  of every token so the parser doesn't have to.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#pragma once
+
+#include "Tokens.h"
+#include <cstddef>
+
+namespace uscc
+{
+namespace scan
+{
+
+class Lexer
+{
+public:
+	virtual ~Lexer() { }
+
+	// Scans the next significant token (skipping white space,
+	// newlines and comments) and returns it.
+	// Returns Token::EndOfFile once the input is exhausted.
+	virtual Token::Tokens nextToken() = 0;
+
+	// Returns the text of the most recently scanned token
+	// (null-terminated)
+	virtual const char* getTokenTxt() const noexcept = 0;
+
+	// Returns the length of the most recently scanned token
+	virtual size_t getTokenLen() const noexcept = 0;
+
+	// Returns the 1-based line/column where the most recently
+	// scanned token starts
+	virtual unsigned int getLine() const noexcept = 0;
+	virtual unsigned int getCol() const noexcept = 0;
+};
+
+} // scan
+} // uscc
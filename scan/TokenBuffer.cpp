@@ -0,0 +1,41 @@
+//
+//  TokenBuffer.cpp
+//  uscc
+//
+//  Implements the pre-tokenized token buffer.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#include "TokenBuffer.h"
+#include "Lexer.h"
+
+using namespace uscc::scan;
+
+// Scans every token from the lexer, up to and including
+// the EndOfFile token (which is always the last entry)
+void TokenBuffer::fill(Lexer& lexer)
+{
+	Token::Tokens token;
+	do
+	{
+		token = lexer.nextToken();
+		size_t len = lexer.getTokenLen();
+
+		mKinds.push_back(static_cast<uint8_t>(token));
+		mOffsets.push_back(static_cast<uint32_t>(mText.size()));
+		mLengths.push_back(static_cast<uint32_t>(len));
+		mLines.push_back(lexer.getLine());
+		mCols.push_back(lexer.getCol());
+
+		const char* txt = lexer.getTokenTxt();
+		mText.insert(mText.end(), txt, txt + len);
+		mText.push_back('\0');
+	}
+	while (token != Token::EndOfFile);
+}
@@ -0,0 +1,85 @@
+//
+//  TokenBuffer.h
+//  uscc
+//
+//  Declares TokenBuffer, which holds every token of a file
+//  as a structure of arrays (kind, offset, length, line,
+//  column). The file is scanned once up front, so the parser
+//  can index tokens directly and look ahead as far as it
+//  needs to.
+//
+//---------------------------------------------------------
+//  Copyright (c) 2014, Sanjay Madhav
+//  All rights reserved.
+//
+//  This file is distributed under the BSD license.
+//  See LICENSE.TXT for details.
+//---------------------------------------------------------
+
+#pragma once
+
+#include "Tokens.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace uscc
+{
+namespace scan
+{
+
+class Lexer;
+
+class TokenBuffer
+{
+public:
+	// Scans every token from the lexer, up to and including
+	// the EndOfFile token (which is always the last entry)
+	void fill(Lexer& lexer);
+
+	size_t size() const noexcept
+	{
+		return mKinds.size();
+	}
+
+	Token::Tokens getKind(size_t idx) const noexcept
+	{
+		return static_cast<Token::Tokens>(mKinds[idx]);
+	}
+
+	// Returns the null-terminated text of the token.
+	// Offsets index into the buffer's own text store, which
+	// holds only the significant tokens (white space and
+	// comments are dropped), each followed by a '\0'.
+	const char* getText(size_t idx) const noexcept
+	{
+		return &mText[mOffsets[idx]];
+	}
+
+	uint32_t getLength(size_t idx) const noexcept
+	{
+		return mLengths[idx];
+	}
+
+	uint32_t getLine(size_t idx) const noexcept
+	{
+		return mLines[idx];
+	}
+
+	uint32_t getCol(size_t idx) const noexcept
+	{
+		return mCols[idx];
+	}
+private:
+	std::vector<uint8_t> mKinds;
+	std::vector<uint32_t> mOffsets;
+	std::vector<uint32_t> mLengths;
+	std::vector<uint32_t> mLines;
+	std::vector<uint32_t> mCols;
+
+	// Token text store
+	std::vector<char> mText;
+};
+
+} // scan
+} // uscc
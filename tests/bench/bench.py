@@ -0,0 +1,71 @@
+#---------------------------------------------------------
+# Copyright (c) 2014, Sanjay Madhav
+# All rights reserved.
+#
+# This file is distributed under the BSD license.
+# See LICENSE.TXT for details.
+#---------------------------------------------------------
+# Times each benchmark compiled with -O, with and without the
+# loop vectorizer, both in lli and as a native executable
+# (uscc -c, linked with gcc). Checks the output of each run
+# against the expected output in the benchmark's header comment.
+import subprocess
+import glob
+import os
+import sys
+import time
+uscc = "../../bin/uscc"
+lli = "../../../bin/lli"
+cc = "gcc"
+runs = 5
+
+def expectedOutput(fileName):
+	lines = open(fileName, "r").read().splitlines()
+	start = lines.index("// Expected output:") + 1
+	expected = ""
+	for line in lines[start:]:
+		if line.startswith("//-"):
+			break
+		expected += line[3:] + "\n"
+	return expected
+
+# Returns the fastest of the runs, in ms
+def timeRuns(args, expected):
+	best = None
+	for i in range(runs):
+		start = time.time()
+		output = subprocess.check_output(args, stderr=subprocess.STDOUT)
+		elapsed = (time.time() - start) * 1000.0
+		if output.decode() != expected:
+			raise Exception(" ".join(args) + " output:\n" + output.decode())
+		if best is None or elapsed < best:
+			best = elapsed
+	return best
+
+# Non-PIE objects don't link on toolchains that default to PIE
+def linkNative(native, exe):
+	try:
+		subprocess.check_output([cc, native, "-o", exe], stderr=subprocess.STDOUT)
+	except subprocess.CalledProcessError:
+		subprocess.check_output([cc, "-no-pie", native, "-o", exe], stderr=subprocess.STDOUT)
+
+if not os.path.isfile(uscc):
+	sys.exit("Can't run without uscc")
+
+print("%-12s %-8s %12s %12s %8s" % ("benchmark", "", "scalar ms", "vector ms", "speedup"))
+for f in sorted(glob.iglob("bench*.usc")):
+	name = f.split(".")[0]
+	expected = expectedOutput(f)
+	times = { }
+	for kind, flags in [("scalar", ["--no-vectorize"]), ("vector", [])]:
+		subprocess.check_call([uscc, "-O"] + flags + ["-o", name + ".bc", f])
+		times[("lli", kind)] = timeRuns([lli, name + ".bc"], expected)
+		subprocess.check_call([uscc, "-O", "-c"] + flags + ["-o", name + ".o", f])
+		linkNative(name + ".o", name + ".exe")
+		times[("native", kind)] = timeRuns(["./" + name + ".exe"], expected)
+	for mode in ["lli", "native"]:
+		scalar = times[(mode, "scalar")]
+		vector = times[(mode, "vector")]
+		print("%-12s %-8s %12.1f %12.1f %7.2fx" % (name, mode, scalar, vector, scalar / vector))
+	for ext in [".bc", ".o", ".exe"]:
+		os.remove(name + ext)
@@ -42,6 +42,21 @@ class EmitTests(unittest.TestCase):
 		except subprocess.CalledProcessError as e:
 			self.fail("\n" + e.output)
 			
+	def checkInlining(self, fileName):
+		# read in the expected report
+		expectFile = open("expected/" + fileName + ".inlining", "r")
+		expectedStr = expectFile.read()
+		expectFile.close()
+		# compile with the report on, which also writes the .bc
+		try:
+			resultStr = subprocess.check_output([uscc, "-O", "--print-inlining", fileName + ".usc"], stderr=subprocess.STDOUT)
+			self.assertMultiLineEqual(expectedStr, resultStr)
+		except subprocess.CalledProcessError as e:
+			self.fail("\n" + e.output)
+
+		# and make sure the inlined code still runs the same
+		self.checkEmit(fileName)
+			
 	def test_Emit_emit02(self):
 		self.checkEmit("emit02")
 		
@@ -104,5 +119,32 @@ class EmitTests(unittest.TestCase):
 		
 	def test_Emit_opt07(self):
 		self.checkEmit("opt07")
+		
+	def test_Emit_opt08(self):
+		self.checkEmit("opt08")
+		
+	def test_Emit_opt09(self):
+		self.checkEmit("opt09")
+		
+	def test_Emit_opt10(self):
+		self.checkEmit("opt10")
+		
+	def test_Emit_opt11(self):
+		self.checkInlining("opt11")
+		
+	def test_Emit_opt12(self):
+		self.checkEmit("opt12")
+		
+	def test_Emit_opt13(self):
+		self.checkEmit("opt13")
+		
+	def test_Emit_opt14(self):
+		self.checkEmit("opt14")
+		
+	def test_Emit_opt15(self):
+		self.checkEmit("opt15")
+		
+	def test_Emit_opt16(self):
+		self.checkEmit("opt16")
 if __name__ == '__main__':
 	unittest.main(verbosity=2)
@@ -16,6 +16,15 @@ gcc = "gcc"
 
 __unittest = True
 
+# Links an object/assembly file from uscc into an executable. gcc builds
+# position independent executables by default on some systems, which
+# uscc's code can't be linked into, so try again with -no-pie.
+def linkNative(native, exe):
+	try:
+		subprocess.check_output([gcc, native, "-o", exe], stderr=subprocess.STDOUT)
+	except subprocess.CalledProcessError:
+		subprocess.check_output([gcc, "-no-pie", native, "-o", exe], stderr=subprocess.STDOUT)
+
 class AsmTests(unittest.TestCase):
 	
 	def setUp(self):
@@ -40,6 +49,39 @@ class AsmTests(unittest.TestCase):
 		# 	resultStr = subprocess.check_output(["./" + fileName + ".out"], stderr=subprocess.STDOUT)
 		# except subprocess.CalledProcessError as e:
 		# 	self.fail("\n" + e.output)
+
+	def checkRun(self, fileName, args, allocator, num=2, flag="-c", spills=False):
+		# read in expected
+		expectFile = open("expected/" + fileName + ".output", "r")
+		expectedStr = expectFile.read()
+		expectFile.close()
+		# compile to an object file (-c) or assembly (-s) via uscc, and
+		# make sure every function went through the expected allocator
+		native = fileName + (".o" if flag == "-c" else ".s")
+		try:
+			resultStr = subprocess.check_output([uscc, "--num-colors", "{}".format(num), "--time"] + args + [flag, fileName + ".usc"], stderr=subprocess.STDOUT)
+		except subprocess.CalledProcessError as e:
+			self.fail("\n" + e.output)
+		allocators = ["graph coloring", "linear scan", "SSA coloring"]
+		self.assertIn(allocator + " register allocation", resultStr)
+		for other in allocators:
+			if other != allocator:
+				self.assertNotIn(other + " register allocation", resultStr)
+		# with few enough colors, some function has to spill
+		if spills:
+			self.assertRegexpMatches(resultStr, r"[1-9][0-9]* spills")
+
+		# now link it with gcc, run it and compare the output
+		try:
+			linkNative(native, fileName + ".out")
+			resultStr = subprocess.check_output(["./" + fileName + ".out"], stderr=subprocess.STDOUT)
+			self.assertMultiLineEqual(expectedStr, resultStr)
+		except subprocess.CalledProcessError as e:
+			self.fail("\n" + e.output)
+		finally:
+			for f in [native, fileName + ".out"]:
+				if os.path.isfile(f):
+					os.remove(f)
 		
 	def test_Asm_emit05(self):
 		self.checkEmit("emit05")
@@ -85,5 +127,62 @@ class AsmTests(unittest.TestCase):
 		
 	def test_Asm_opt07(self):
 		self.checkEmit("opt07")
+
+	def test_Run_color_quicksort(self):
+		self.checkRun("quicksort", [], "graph coloring", 4)
+		
+	def test_Run_color_opt04(self):
+		self.checkRun("opt04", [], "graph coloring", 2, "-s")
+		
+	def test_Run_color_spill_quicksort(self):
+		self.checkRun("quicksort", [], "graph coloring", 2, "-c", True)
+		
+	def test_Run_color_opt07(self):
+		self.checkRun("opt07", ["-O"], "graph coloring")
+		
+	def test_Run_linear_emit11(self):
+		self.checkRun("emit11", ["--regalloc", "linear"], "linear scan")
+		
+	def test_Run_linear_emit12(self):
+		self.checkRun("emit12", ["--regalloc", "linear"], "linear scan", 2, "-s")
+		
+	def test_Run_linear_quicksort(self):
+		self.checkRun("quicksort", ["--regalloc", "linear"], "linear scan", 4)
+		
+	def test_Run_linear_015(self):
+		self.checkRun("test015", ["--regalloc", "linear"], "linear scan", 3)
+		
+	def test_Run_linear_opt07(self):
+		self.checkRun("opt07", ["-O", "--regalloc", "linear"], "linear scan")
+		
+	def test_Run_ssa_emit11(self):
+		self.checkRun("emit11", ["--regalloc", "ssa"], "SSA coloring")
+		
+	def test_Run_ssa_emit12(self):
+		self.checkRun("emit12", ["--regalloc", "ssa"], "SSA coloring", 2, "-s")
+		
+	def test_Run_ssa_quicksort(self):
+		self.checkRun("quicksort", ["--regalloc", "ssa"], "SSA coloring", 4)
+		
+	def test_Run_ssa_016(self):
+		self.checkRun("test016", ["--regalloc", "ssa"], "SSA coloring", 3)
+		
+	def test_Run_ssa_opt07(self):
+		self.checkRun("opt07", ["-O", "--regalloc", "ssa"], "SSA coloring")
+		
+	def test_Run_threshold0_quicksort(self):
+		# 0 turns linear scan off, however big the function is
+		self.checkRun("quicksort", ["--linear-scan-threshold", "0"], "graph coloring", 4)
+		
+	def test_Run_threshold1_quicksort(self):
+		# every function has more than one virtual register
+		self.checkRun("quicksort", ["--linear-scan-threshold", "1"], "linear scan", 4)
+		
+	def test_Run_threshold1_emit12(self):
+		self.checkRun("emit12", ["--linear-scan-threshold", "1"], "linear scan", 2, "-s")
+		
+	def test_Run_threshold1_ssa_emit11(self):
+		# the threshold only applies to graph coloring
+		self.checkRun("emit11", ["--regalloc", "ssa", "--linear-scan-threshold", "1"], "SSA coloring")
 if __name__ == '__main__':
 	unittest.main(verbosity=2)
@@ -8,6 +8,8 @@
 import subprocess
 import os
 import sys
+import shutil
+import tempfile
 
 import unittest
 uscc = "../bin/uscc"
@@ -38,6 +40,49 @@ class EmitTests(unittest.TestCase):
 		
 		# now run it in lli and compare the output
 			
+	# Reading a variable at the end of a long straight run of if statements
+	# searches back through a chain of depth blocks
+	def checkDeepChain(self, depth):
+		tempDir = tempfile.mkdtemp()
+		try:
+			fileName = os.path.join(tempDir, "chain")
+			source = open(fileName + ".usc", "w")
+			source.write("int main()\n{\n\tint x = 0;\n\tint y = 1;\n\tint z = 7;\n")
+			for i in range(depth):
+				source.write("\tif (y) x = x + 1;\n")
+			source.write("\tprintf(\"%d %d\\n\", x, z);\n\treturn 0;\n}\n")
+			source.close()
+			try:
+				subprocess.check_output([uscc, fileName + ".usc"], stderr=subprocess.STDOUT)
+				resultStr = subprocess.check_output([lli, fileName + ".bc"], stderr=subprocess.STDOUT)
+				self.assertMultiLineEqual("%d 7\n" % depth, resultStr)
+			except subprocess.CalledProcessError as e:
+				self.fail("\n" + e.output)
+		finally:
+			shutil.rmtree(tempDir)
+	
+	# The same chain in a function of its own, compiled with -O. y isn't
+	# a constant there, so the branches stay and the dominator tree is as
+	# deep as the chain. Only the compile is checked, since code this big
+	# takes too long to run in lli.
+	def checkDeepChainOpt(self, depth):
+		tempDir = tempfile.mkdtemp()
+		try:
+			fileName = os.path.join(tempDir, "chain")
+			source = open(fileName + ".usc", "w")
+			source.write("int count(int y)\n{\n\tint x = 0;\n")
+			for i in range(depth):
+				source.write("\tif (y) x = x + 1;\n")
+			source.write("\treturn x;\n}\n\nint main()\n{\n\tprintf(\"%d\\n\", count(1));\n\treturn 0;\n}\n")
+			source.close()
+			try:
+				subprocess.check_output([uscc, "-O", fileName + ".usc"], stderr=subprocess.STDOUT)
+				self.assertTrue(os.path.isfile(fileName + ".bc"))
+			except subprocess.CalledProcessError as e:
+				self.fail("\n" + e.output)
+		finally:
+			shutil.rmtree(tempDir)
+	
 	def test_Emit_emit02(self):
 		self.checkEmit("emit02")
 		
@@ -100,5 +145,11 @@ class EmitTests(unittest.TestCase):
 		
 	def test_Emit_opt07(self):
 		self.checkEmit("opt07")
+		
+	def test_SSA_deepChain(self):
+		self.checkDeepChain(100000)
+		
+	def test_SSA_deepChainOpt(self):
+		self.checkDeepChainOpt(100000)
 if __name__ == '__main__':
 	unittest.main(verbosity=2)
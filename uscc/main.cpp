@@ -17,7 +17,16 @@
 #include "../parse/Parse.h"
 #include "../parse/ParseExcept.h"
 #include "../parse/Emitter.h"
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
 #pragma clang diagnostic push
@@ -25,30 +34,211 @@
 #pragma clang diagnostic ignored "-Wunused"
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
 #include "ezOptionParser.hpp"
+#include <llvm/IR/LLVMContext.h>
 #pragma clang diagnostic pop
 #pragma GCC diagnostic pop
 
 using namespace uscc;
-extern bool enableLiveness;
+
+// Settings from the command line that apply to every input file
+struct CompileOptions
+{
+	bool mPrintAST;
+	bool mPrintSymbols;
+	bool mPrintBC;
+	bool mBitcode;
+	bool mAssembly;
+	bool mObject;
+	bool mOptimize;
+	bool mFlexScanner;
+	bool mLiveness;
+	bool mDCE;
+	bool mTime;
+	bool mPrintInlining;
+	bool mVectorize;
+	// Calls with an inline cost up to this are inlined by -O
+	int mInlineThreshold;
+	// Number of files written per input (bitcode, assembly and object)
+	int mNumOutputs;
+	// Empty unless -o was specified
+	std::string mOutputFile;
+};
+
+// What compiling one file printed, so it can be
+// output in input order no matter which worker ran it
+struct CompileResult
+{
+	CompileResult()
+	: mStatus(0)
+	, mDone(false)
+	{ }
+	
+	std::ostringstream mOut;
+	std::ostringstream mErr;
+	int mStatus;
+	bool mDone;
+};
+
+// Returns the file to write an output to, which is the -o file if this
+// is the only output. Otherwise, it's the input file with the extension replaced.
+static std::string getOutputFile(const char* fileName, const CompileOptions& options,
+								 const char* ext)
+{
+	if (!options.mOutputFile.empty() && options.mNumOutputs == 1)
+	{
+		return options.mOutputFile;
+	}
+	
+	std::string outFile = fileName;
+	size_t extLoc = outFile.find_last_of(".");
+	if (extLoc != std::string::npos)
+	{
+		// Strip the last extension
+		outFile = outFile.substr(0, extLoc);
+	}
+	outFile += ext;
+	return outFile;
+}
+
+// Compiles a single file in the given LLVM context, writing anything
+// it prints to out and err. Returns the exit status.
+static int compileFile(const char* fileName, const CompileOptions& options,
+					   llvm::LLVMContext& context, std::ostream& out, std::ostream& err)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::ostream* astStream = nullptr;
+	if (options.mPrintAST)
+	{
+		astStream = &out;
+	}
+	
+	try
+	{
+		parse::Parser parser(fileName, &err, astStream, options.mPrintSymbols,
+							 options.mFlexScanner);
+		
+		if (!parser.IsValid())
+		{
+			err << parser.GetNumErrors() << " Error(s)" << std::endl;
+			return 1;
+		}
+		
+		// If we set -a, we don't continue to later steps
+		if (options.mPrintAST &&
+			!options.mBitcode && !options.mAssembly && !options.mObject &&
+			!options.mPrintBC)
+		{
+			return 0;
+		}
+		
+		// Now emit LLVM bitcode
+		parse::Emitter emit(parser, context);
+
+        // Perform dead code elimination that calls liveness analysis.
+        if (options.mLiveness)
+        {
+            emit.doLiveness(out);
+            return 0;
+        }
+        else if (options.mDCE)
+        {
+            emit.doDCE();
+        }
+
+		// Check if we should run optimization passes
+		if (options.mOptimize)
+		{
+			emit.optimize(options.mInlineThreshold, options.mVectorize,
+						  options.mPrintInlining ? &out : nullptr);
+		}
+		
+		// Print the human readable bitcode
+		if (options.mPrintBC)
+		{
+			emit.print(out);
+		}
+		
+		// Before we write anything, verify the IR doesn't have major errors
+		if (!emit.verify())
+		{
+			err << std::endl;
+			err << "uscc: error: Emitted bad IR. Compilation halted." << std::endl;
+			return 1;
+		}
+		
+		// Write the bitcode file
+		if (options.mBitcode || (!options.mAssembly && !options.mObject))
+		{
+			emit.writeBitcode(getOutputFile(fileName, options, ".bc").c_str());
+		}
+		
+		auto codegenStart = std::chrono::steady_clock::now();
+		
+		// Write the assembly file
+		if (options.mAssembly)
+		{
+			std::string asmFile = getOutputFile(fileName, options, ".s");
+			if (!emit.writeAsm(asmFile.c_str(), out,
+							   options.mTime ? &err : nullptr))
+			{
+				err << "uscc: error: Unable to emit assembly. Compilation halted." << std::endl;
+				return 1;
+			}
+		}
+		
+		// Write the object file
+		if (options.mObject)
+		{
+			std::string objFile = getOutputFile(fileName, options, ".o");
+			if (!emit.writeObj(objFile.c_str(), out,
+							   options.mTime ? &err : nullptr))
+			{
+				err << "uscc: error: Unable to emit object file. Compilation halted." << std::endl;
+				return 1;
+			}
+		}
+		
+		if (options.mTime)
+		{
+			auto end = std::chrono::steady_clock::now();
+			err << fileName << ": compile "
+				<< std::chrono::duration<double, std::milli>(codegenStart - start).count()
+				<< " ms, codegen "
+				<< std::chrono::duration<double, std::milli>(end - codegenStart).count()
+				<< " ms" << std::endl;
+		}
+	}
+	catch (parse::FileNotFound& fe)
+	{
+		err << "uscc: error: Input file " << fileName << " not found." << std::endl;
+	}
+	catch (parse::ParseExcept& e)
+	{
+		err << "uscc: error: Critical error. Compilation halted." << std::endl;
+		return 1;
+	}
+	
+	return 0;
+}
 
 int main(int argc, const char * argv[])
 {
 	ez::ezOptionParser opt;
 	opt.doublespace = 1;
 	opt.overview = "University Simple C Compiler v0.5";
-	opt.syntax = "uscc [OPTIONS] <input>";
+	opt.syntax = "uscc [OPTIONS] <input> [<input> ...]";
 	
 	opt.add("", false, 0, 0,
 			"Display this message.",
 			"-h", "--help");
 	opt.add("", false, 0, 0,
 			"Output parse AST to stdout, and do not proceed to further compilation steps. "
-			"(Unless -b or -s is also specified.)",
+			"(Unless -b, -s or -c is also specified.)",
 			"-a", "--print-ast");
 	opt.add("", false, 0, 0,
 			"(DEFAULT) Generates LLVM bitcode file."
 			" This is done by default if"
-			" -a or -s is not specified.\n\nTo force bitcode to be written even if -a or -s are"
+			" -a, -s or -c is not specified.\n\nTo force bitcode to be written even if -a, -s or -c are"
 			" set, you can specify -b, as well.",
 			"-b", "--bitcode");
 	opt.add("", false, 0, 0,
@@ -61,15 +251,53 @@ int main(int argc, const char * argv[])
 			"Enable optimization passes.",
 			"-O");
 	opt.add("", false, 0, 0,
-			"Generate an x86 assembly file from the LLVM IR generated by uscc."
-			" No optimization is performed."
+			"Generate an assembly file for the host from the LLVM IR generated by uscc."
+			" If -O is specified, the optimized IR is used."
 			"\n\nThis is provided for convenience in case LLVM developer tools (specifically llc)"
 			" are not installed. GCC or clang can turn this assembly file into an executable.",
 			"-s", "--assembly");
+	opt.add("", false, 0, 0,
+			"Generate an object file for the host, the same way as -s.",
+			"-c", "--object");
 	opt.add("4", false, 1, 0, "Specify number of colors for register graph coloring", "--num-colors");
+	opt.add("color", false, 1, 0,
+			"Register allocator to use for -s/-c: color (graph coloring), linear"
+			" (linear scan) or ssa (spill first, then color in dominance order).",
+			"--regalloc");
+	opt.add("2000", false, 1, 0,
+			"Use linear scan instead of graph coloring for functions with more than"
+			" this many virtual registers. (0 to always color.)",
+			"--linear-scan-threshold");
+	opt.add("25", false, 1, 0,
+			"Inline calls during -O when the callee's size, less the call overhead"
+			" saved and a bonus for constant arguments, is at most this."
+			" (Recursive callees have a penalty added.)",
+			"--inline-threshold");
+	opt.add("", false, 0, 0,
+			"Output each call site considered for inlining by -O, and its cost, to stdout.",
+			"--print-inlining");
+	opt.add("", false, 0, 0,
+			"Don't vectorize loops during -O.",
+			"--no-vectorize");
 	opt.add("", false, 1, 0,
-			"Specify output file. This is ignored if -b and -s are specified simultaneously.",
+			"Specify output file. This is ignored if more than one of -b, -s and -c are specified."
+			" Only allowed with a single input file.",
 			"-o", "--output");
+	opt.add("0", false, 1, 0,
+			"Number of input files to compile in parallel."
+			" (Default is one per hardware thread.)",
+			"-j", "--jobs");
+	opt.add("", false, 0, 0,
+			"Report the time spent generating native code (-s/-c) separately"
+			" from the rest of the compile, for each input file, along with the"
+			" register allocator's time, spill count and copies removed for"
+			" each function.",
+			"--time");
+
+	opt.add("", false, 0, 0,
+			"Scan the input with the flex-generated scanner instead of the"
+			" default memory-mapped scanner.",
+			"--flex-scanner");
 
     opt.add("", false, 0, 0, "Enable liveness analysis",
             "-liveness");
@@ -90,150 +318,133 @@ int main(int argc, const char * argv[])
 		std::cerr << "uscc: error: No input file specified." << std::endl;
 		return 1;
 	}
-	if (opt.lastArgs.size() > 1)
+	if (opt.lastArgs.size() > 1 && opt.isSet("-o"))
 	{
-		std::cerr << "uscc: error: Only a single input file is supported." << std::endl;
+		std::cerr << "uscc: error: -o is not allowed with multiple input files." << std::endl;
 		return 1;
 	}
 	
-	const char* fileName = opt.lastArgs[0]->c_str();
-	std::ostream* astStream = nullptr;
-	bool outputSymbols = false;
-	if (opt.isSet("-a"))
+	CompileOptions options;
+	options.mPrintAST = opt.isSet("-a");
+	options.mPrintSymbols = opt.isSet("-l");
+	options.mPrintBC = opt.isSet("-p");
+	options.mBitcode = opt.isSet("-b");
+	options.mAssembly = opt.isSet("-s");
+	options.mObject = opt.isSet("-c");
+	options.mOptimize = opt.isSet("-O");
+	options.mFlexScanner = opt.isSet("--flex-scanner");
+	options.mLiveness = opt.isSet("-liveness");
+	options.mDCE = opt.isSet("-dce");
+	options.mTime = opt.isSet("--time");
+	options.mPrintInlining = opt.isSet("--print-inlining");
+	options.mVectorize = !opt.isSet("--no-vectorize");
+	options.mInlineThreshold = 25;
+	opt.get("--inline-threshold")->getInt(options.mInlineThreshold);
+	options.mNumOutputs = (options.mAssembly ? 1 : 0) + (options.mObject ? 1 : 0);
+	if (options.mBitcode || options.mNumOutputs == 0)
 	{
-		astStream = &std::cout;
+		options.mNumOutputs++;
 	}
-
-	if (opt.isSet("-l"))
+	if (opt.isSet("-o"))
 	{
-		outputSymbols = true;
+		opt.get("-o")->getString(options.mOutputFile);
 	}
 	
-	try
+	// The target and pass registries are shared, so set them up
+	// before any workers start
+	if (options.mAssembly || options.mObject)
 	{
-		parse::Parser parser(fileName, &std::cerr, astStream, outputSymbols);
-		
-		if (!parser.IsValid())
+		int numColors = 4;
+		opt.get("--num-colors")->getInt(numColors);
+		if (numColors < 1)
 		{
-			std::cerr << parser.GetNumErrors() << " Error(s)" << std::endl;
+			std::cerr << "uscc: error: --num-colors must be at least 1." << std::endl;
 			return 1;
 		}
-		
-		// If we set -a, we don't continue to later steps
-		if (opt.isSet("-a") &&
-			!opt.isSet("-b") && !opt.isSet("-s") && !opt.isSet("-p"))
-		{
-			return 0;
-		}
-		
-		// Now emit LLVM bitcode
-		parse::Emitter emit(parser);
-
-        // Perform dead code elimination that calls liveness analysis.
-        enableLiveness = opt.isSet("-liveness");
-        if (enableLiveness)
-        {
-            emit.doLiveness();
-            return 0;
-        }
-        else if (opt.isSet("-dce"))
-        {
-            emit.registerAnalysis();
-            emit.doDCE();
-        }
-
-		// Check if we should run optimization passes
-		if (opt.isSet("-O"))
+		int threshold = 0;
+		opt.get("--linear-scan-threshold")->getInt(threshold);
+		std::string allocator;
+		opt.get("--regalloc")->getString(allocator);
+		if (!parse::Emitter::setRegAlloc(allocator, static_cast<unsigned>(numColors),
+										 static_cast<unsigned>(std::max(threshold, 0))))
 		{
-			emit.optimize();
+			std::cerr << "uscc: error: Unknown register allocator '" << allocator << "'." << std::endl;
+			return 1;
 		}
-		
-		bool shouldEmitBC = true;
-		if (opt.isSet("-s") && !opt.isSet("-b"))
+		parse::Emitter::initNativeTarget();
+	}
+	if (options.mDCE && !options.mLiveness)
+	{
+		parse::Emitter::registerAnalysis();
+	}
+	
+	size_t numFiles = opt.lastArgs.size();
+	int jobs = 0;
+	opt.get("-j")->getInt(jobs);
+	size_t numWorkers = jobs > 0 ? static_cast<size_t>(jobs) : std::thread::hardware_concurrency();
+	if (numWorkers == 0)
+	{
+		numWorkers = 1;
+	}
+	if (numWorkers > numFiles)
+	{
+		numWorkers = numFiles;
+	}
+	
+	std::vector<CompileResult> results(numFiles);
+	std::mutex resultMutex;
+	std::condition_variable resultDone;
+	std::atomic<size_t> nextFile(0);
+	
+	// Each worker gets its own LLVM context, and takes the
+	// next file that hasn't been started until there are none left
+	auto worker = [&]()
+	{
+		llvm::LLVMContext context;
+		for (size_t i = nextFile++; i < numFiles; i = nextFile++)
 		{
-			shouldEmitBC = false;
+			CompileResult& result = results[i];
+			result.mStatus = compileFile(opt.lastArgs[i]->c_str(), options, context,
+										 result.mOut, result.mErr);
+			std::lock_guard<std::mutex> lock(resultMutex);
+			result.mDone = true;
+			resultDone.notify_all();
 		}
-		
-		// Print the human readable bitcode to stdout
-		if (opt.isSet("-p"))
+	};
+	
+	std::vector<std::thread> threads;
+	if (numWorkers == 1)
+	{
+		worker();
+	}
+	else
+	{
+		for (size_t i = 0; i < numWorkers; i++)
 		{
-			emit.print();
+			threads.push_back(std::thread(worker));
 		}
-		
-		// Before we write anything, verify the IR doesn't have major errors
-		if (!emit.verify())
+	}
+	
+	// Output the results in input order, as soon as each one is done
+	int status = 0;
+	for (auto& result : results)
+	{
 		{
-			std::cerr << std::endl;
-			std::cerr << "uscc: error: Emitted bad IR. Compilation halted." << std::endl;
-			return 1;
+			std::unique_lock<std::mutex> lock(resultMutex);
+			resultDone.wait(lock, [&result]() { return result.mDone; });
 		}
-		
-		// Write the bitcode file
-		if (shouldEmitBC)
+		std::cout << result.mOut.str() << std::flush;
+		std::cerr << result.mErr.str() << std::flush;
+		if (result.mStatus != 0)
 		{
-			std::string bcFile;
-			// If output file not specified, default is
-			// input file with the extension replaced with .bc
-			if (!opt.isSet("-o") || opt.isSet("-s"))
-			{
-				bcFile = fileName;
-				size_t extLoc = bcFile.find_last_of(".");
-				if (extLoc != std::string::npos)
-				{
-					// Strip the last extension
-					bcFile = bcFile.substr(0, extLoc);
-				}
-				bcFile += ".bc";
-			}
-			else
-			{
-				ez::OptionGroup* params = opt.get("-o");
-				params->getString(bcFile);
-			}
-			
-			emit.writeBitcode(bcFile.c_str());
+			status = result.mStatus;
 		}
-		
-		// Functionality removed because it doesn't work with LLVM 3.5.0
-		// Write the assembly file
-		/*if (opt.isSet("-s"))
-		{
-			std::string asmFile;
-			// If output file not specified, default is
-			// input file with the extension replaced with .bc
-			if (!opt.isSet("-o") || opt.isSet("-b"))
-			{
-				asmFile = fileName;
-				size_t extLoc = asmFile.find_last_of(".");
-				if (extLoc != std::string::npos)
-				{
-					// Strip the last extension
-					asmFile = asmFile.substr(0, extLoc);
-				}
-				asmFile += ".s";
-			}
-			else
-			{
-				ez::OptionGroup* params = opt.get("-o");
-				params->getString(asmFile);
-			}
-			
-			if (!emit.writeAsm(asmFile.c_str()))
-			{
-				std::cerr << "uscc: error: Unable to emit assembly. Compilation halted." << std::endl;
-			}
-		}*/
-	}
-	catch (parse::FileNotFound& fe)
-	{
-		std::cerr << "uscc: error: Input file " << fileName << " not found." << std::endl;
 	}
-	catch (parse::ParseExcept& e)
+	
+	for (auto& thread : threads)
 	{
-		std::cerr << "uscc: error: Critical error. Compilation halted." << std::endl;
-		return 1;
+		thread.join();
 	}
 	
-	return 0;
+	return status;
 }
-